@@ -33,6 +33,9 @@ struct apply_and_return< policies<Policies...>, RT, Func, std::tuple<Args...>> {
   static gctools::return_type go( Func&& fn, tuple_type&& tuple) {
     RT ret0 = clbind::apply(std::forward<Func>(fn),std::forward<tuple_type>(tuple));
     core::T_sp tret0 = translate::to_object<RT,typename AdoptPointer<policies<Policies...>,result>::type >::convert(ret0);
+    if constexpr (no_out_values<sizeof...(Args),policies<Policies...>>::value) {
+      return gctools::return_type(tret0.raw_(),1);
+    }
     core::MultipleValues& returnValues = core::lisp_multipleValues();
     size_t num_returns = 1 + clbind::return_multiple_values<1,policies<Policies...>,decltype(tuple),std::index_sequence_for<Args...>,Args...>::go(std::forward<tuple_type>(tuple),returnValues.returnValues(0));
 //    printf("%s:%d  RT apply_and_return  returning %lu multiple values\n", __FILE__, __LINE__, num_returns );
@@ -46,6 +49,9 @@ struct apply_and_return< policies<Policies...>, void, Func, std::tuple<Args...>>
   using tuple_type = std::tuple<Args...>;
   static gctools::return_type go( Func&& fn, tuple_type&& tuple) {
     clbind::apply(std::forward<Func>(fn),std::forward<tuple_type>(tuple));
+    if constexpr (no_out_values<sizeof...(Args),policies<Policies...>>::value) {
+      return gctools::return_type(nil<core::T_O>().raw_(),0);
+    }
     core::MultipleValues& returnValues = core::lisp_multipleValues();
     size_t num_returns = clbind::return_multiple_values<0,policies<Policies...>,decltype(tuple),std::index_sequence_for<Args...>,Args...>::go(std::forward<tuple_type>(tuple),returnValues.returnValues(0));
 //    printf("%s:%d  void apply_and_return  returning %lu multiple values\n", __FILE__, __LINE__, num_returns );
@@ -227,6 +233,9 @@ struct external_method_apply_and_return<Policies,void,MethodType,OTExternal,std:
   using tuple_type = std::tuple<Args...>;
   static gc::return_type go( MethodType&& mptr, OTExternal* objectP, tuple_type&& tuple) {
     clbind::external_method_apply(std::forward<MethodType>(mptr), objectP, std::forward<tuple_type>(tuple) );
+    if constexpr (no_out_values<sizeof...(Args),Policies>::value) {
+      return gctools::return_type(nil<core::T_O>().raw_(),0);
+    }
     // Pass -1 as first template argument - it means that first out value will write to multiple value return vector at position 0
     core::MultipleValues& returnValues = core::lisp_multipleValues();
     size_t num_returns = clbind::return_multiple_values<0,Policies,decltype(tuple),std::index_sequence_for<Args...>,Args...>::go(std::forward<tuple_type>(tuple),returnValues.returnValues(0));
@@ -244,6 +253,9 @@ struct external_method_apply_and_return<Policies,RT,MethodType,OTExternal,std::t
   static gc::return_type go( MethodType&& mptr, OTExternal* objectP, tuple_type&& tuple) {
     RT ret0 = clbind::external_method_apply(std::forward<MethodType>(mptr),objectP, std::forward<tuple_type>(tuple) );
     core::T_sp tret0 = translate::to_object<RT,typename clbind::AdoptPointer<Policies,result>::type>::convert(ret0);
+    if constexpr (no_out_values<sizeof...(Args),Policies>::value) {
+      return gctools::return_type(tret0.raw_(),1);
+    }
 //    printf("%s:%d Returning first return value: %p\n", __FILE__, __LINE__, tret0.raw_()) ;
     // Pass 0 as first template argument - it means that first out value will write to multiple value return vector at position 1
     core::MultipleValues& returnValues = core::lisp_multipleValues();
@@ -269,6 +281,9 @@ struct clbind_external_method_apply_and_return<Policies,void,MethodType,OT,std::
   using tuple_type = std::tuple<Args...>;
   static gc::return_type go( MethodType&& mptr, OT objectP, tuple_type&& tuple) {
     clbind::clbind_external_method_apply(std::forward<MethodType>(mptr), objectP, std::forward<tuple_type>(tuple) );
+    if constexpr (no_out_values<sizeof...(Args),Policies>::value) {
+      return gctools::return_type(nil<core::T_O>().raw_(),0);
+    }
     // Pass -1 as first template argument - it means that first out value will write to multiple value return vector at position 0
     core::MultipleValues& returnValues = core::lisp_multipleValues();
     size_t num_returns = clbind::return_multiple_values<0,Policies,decltype(tuple),std::index_sequence_for<Args...>,Args...>::go(std::forward<tuple_type>(tuple),returnValues.returnValues(0));
@@ -286,6 +301,9 @@ struct clbind_external_method_apply_and_return<Policies,RT,MethodType,OT,std::tu
   static gc::return_type go( MethodType&& mptr, OT objectP, tuple_type&& tuple) {
     RT ret0 = clbind::clbind_external_method_apply(std::forward<MethodType>(mptr),objectP, std::forward<tuple_type>(tuple) );
     core::T_sp tret0 = translate::to_object<RT,typename clbind::AdoptPointer<Policies,result>::type>::convert(ret0);
+    if constexpr (no_out_values<sizeof...(Args),Policies>::value) {
+      return gctools::return_type(tret0.raw_(),1);
+    }
 //    printf("%s:%d Returning first return value: %p\n", __FILE__, __LINE__, tret0.raw_()) ;
     // Pass 0 as first template argument - it means that first out value will write to multiple value return vector at position 1
     core::MultipleValues& returnValues = core::lisp_multipleValues();
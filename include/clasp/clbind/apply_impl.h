@@ -417,6 +417,13 @@ struct outValueIndexMuple {
   using type = typename muple_runsum<Start,MaskMuple>::type;
 };
 
+// True if none of the Num arguments is an outValue or pureOutValue, in
+// which case a call returns just its primary value.
+template <int Num, typename Policies>
+struct no_out_values {
+  static constexpr bool value = SumMuple<typename outValueMaskMuple<Num,Policies>::type>::value == 0;
+};
+
 };
 
 
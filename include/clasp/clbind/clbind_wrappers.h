@@ -268,15 +268,38 @@ bool validp() const { return RawGetter<HolderType>::get_pointer(this->p_gc_ignor
     return clbind::support_instanceSet<ExternalType>(idx, val, RawGetter<HolderType>::get_pointer(this->p_gc_ignore));
   }
 
+  /*! Remembers the last successful cast made from this wrapper type on this thread */
+  struct LastCast {
+    class_id target = ~(class_id)0;
+    class_id dynamic_id = ~(class_id)0;
+    std::ptrdiff_t object_offset = 0;
+    std::ptrdiff_t offset = 0;
+  };
+
   virtual void *castTo(class_id cid) const {
     this->throwIfInvalid();
-    std::pair<void *, int> res = globalCastGraph->cast(const_cast<typename std::remove_const<OT>::type *>(RawGetter<HolderType>::get_pointer(
-                                                                                                              this->p_gc_ignore)) // ptr
+    void* ptr = (void*)const_cast<typename std::remove_const<OT>::type *>(RawGetter<HolderType>::get_pointer(this->p_gc_ignore));
+    // A method of the wrapped class itself needs no cast at all.
+    if (cid == reg::registered_class<OT>::id) return ptr;
+    // Calls of a base class method tend to repeat the same cast, so check the
+    // last one before searching the cast graph and its cache.
+    static thread_local LastCast last;
+    std::ptrdiff_t object_offset = (char*)this->dynamic_ptr - (char*)ptr;
+    if (last.target == cid && last.dynamic_id == this->dynamic_id && last.object_offset == object_offset) {
+      return (char*)ptr + last.offset;
+    }
+    std::pair<void *, int> res = globalCastGraph->cast(ptr // ptr
                                                        , reg::registered_class<OT>::id // src
                                                        , cid // target
                                                        , this->dynamic_id
                                                        , this->dynamic_ptr
                                                        );
+    if (res.first) {
+      last.target = cid;
+      last.dynamic_id = this->dynamic_id;
+      last.object_offset = object_offset;
+      last.offset = (char*)res.first - (char*)ptr;
+    }
     return res.first;
   }
 
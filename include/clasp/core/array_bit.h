@@ -150,6 +150,8 @@ namespace core {
   size_t SimpleBitVector_lowestIndex(SimpleBitVector_sp x);
   bool SimpleBitVector_isZero(SimpleBitVector_sp x);
   SimpleBitVector_sp SimpleBitVector_copy(SimpleBitVector_sp orig_sbv);
+  void SimpleBitVector_copyRange(SimpleBitVector_sp dest, size_t dstart, SimpleBitVector_sp source, size_t sstart,
+                                 size_t length);
 }
 
 #endif
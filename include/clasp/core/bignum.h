@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include <clasp/core/object.h>
 #include <clasp/core/numbers.h>
 #include <clasp/core/bignum.fwd.h>
+#include <memory>
 
 namespace core {
 class Bignum_O;
@@ -168,6 +169,26 @@ public: // Functions here
     (NLIMBS)--;\
   }
 
+/*! Temporary limbs (or digits) for a bignum operation. Ordinary sizes live
+    on the stack; huge operands go to the heap instead of a VLA that could
+    overflow the stack. Converts to a plain pointer for the mpn_ functions. */
+template <typename T, size_t StackCount = 256>
+class BignumScratch {
+  T _Stack[StackCount];
+  std::unique_ptr<T[]> _Heap;
+  T* _Data;
+public:
+  explicit BignumScratch(size_t count) : _Data(_Stack) {
+    if (count > StackCount) {
+      _Heap.reset(new T[count]);
+      _Data = _Heap.get();
+    }
+  }
+  BignumScratch(const BignumScratch&) = delete;
+  BignumScratch& operator=(const BignumScratch&) = delete;
+  operator T*() { return _Data; }
+};
+
 Bignum_sp core__next_from_fixnum(Fixnum);
 Integer_sp bignum_result(mp_size_t, const mp_limb_t*);
 Integer_sp core__next_fmul(Bignum_sp, Fixnum);
@@ -208,6 +208,15 @@ namespace clasp_ffi {
   DOCGROUP(clasp)
     CL_DEFUN core::T_sp PERCENTforeign_data_pointerp( core::T_sp obj );
 
+  // ---------------------------------------------------------------------------
+  // BULK COPY BETWEEN SPECIALIZED ARRAYS AND FOREIGN MEMORY
+  // Elements START below END of the array are copied with a single memcpy
+  // to or from the foreign memory OFFSET bytes after the pointer.
+  DOCGROUP(clasp)
+    CL_DEFUN ForeignData_sp PERCENTcopy_to_foreign( core::Array_sp source, size_t start, size_t end, ForeignData_sp dest, size_t offset );
+  DOCGROUP(clasp)
+    CL_DEFUN core::Array_sp PERCENTcopy_from_foreign( ForeignData_sp source, size_t offset, core::Array_sp dest, size_t start, size_t end );
+
   // ---------------------------------------------------------------------------
   // FOREIGN TYPE SIZE - Only needed in C++ land. For Lisp, there is
   // %foreign-type-size implemented in Lisp
@@ -35,6 +35,16 @@ namespace core {
 T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position,
                           T_sp relativep);
 
+/*! Large enough for the shortest digits of any single or double float */
+#define CLASP_FLOAT_DIGITS_MAX 32
+
+/*! Write the shortest digit string that reads back as NUMBER into DIGITS
+    and set K so that |NUMBER| = 0.DIGITS * 10^K.  This is the fixed cost
+    (Ryu) alternative to the Dragon4 loop in core__float_to_digits.
+    Returns the number of digits, or 0 if NUMBER must take the exact path
+    (long floats, infinities and NaNs, or no floating point to_chars). */
+size_t clasp_float_shortest_digits(Float_sp number, char *digits, gc::Fixnum &k);
+
 };
 
 #endif
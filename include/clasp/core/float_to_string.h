@@ -4,5 +4,7 @@
 namespace core {
 T_sp
 core_float_to_string_free(Float_sp number, Number_sp e_min, Number_sp e_max);
+size_t
+clasp_float_to_string_free(char *out, size_t size, Float_sp number, gc::Fixnum e_min, gc::Fixnum e_max);
 };
 #endif
@@ -33,8 +33,23 @@ THE SOFTWARE.
 
 namespace core {
 
+// Instruction set extensions that C++ kernels may dispatch on at runtime.
+// Everything is false on targets where we don't probe.
+struct CpuFeatures {
+  bool popcnt = false;
+  bool avx2 = false;
+  bool fma = false;
+  bool avx512f = false;
+  bool avx512bw = false;
+  bool avx512vpopcntdq = false;
+};
+
+const CpuFeatures& cpu_features();
+
 T_sp core__num_logical_processors();
 SYMBOL_EXPORT_SC_(CorePkg, num_logical_processors);
+List_sp core__cpu_features();
+SYMBOL_EXPORT_SC_(CorePkg, cpu_features);
 
 }
 
@@ -38,232 +38,6 @@ THE SOFTWARE.
 PACKAGE_USE("COMMON-LISP");
 NAMESPACE_PACKAGE_ASSOCIATION(mp, MpPkg, "MP")
 
-
-
-namespace sf {
-
-//
-// From https://www.codeproject.com/Articles/1183423/We-Make-a-std-shared-mutex-10-Times-Faster
-//
-//
-
-// contention free shared mutex (same-lock-type is recursive for X->X, X->S or S->S locks), but (S->X - is UB)
-template<unsigned contention_free_count = 36, bool shared_flag = false>
-class contention_free_shared_mutex {
-  std::atomic<bool> want_x_lock;
-  //struct cont_free_flag_t { alignas(std::hardware_destructive_interference_size) std::atomic<int> value; cont_free_flag_t() { value = 0; } }; // C++17
-  struct cont_free_flag_t { char tmp[60]; std::atomic<int> value; cont_free_flag_t() { value = 0; } };   // tmp[] to avoid false sharing
-  typedef std::array<cont_free_flag_t, contention_free_count> array_slock_t;
-        
-  const std::shared_ptr<array_slock_t> shared_locks_array_ptr;  // 0 - unregistred, 1 registred & free, 2... - busy
-  char avoid_falsesharing_1[64];
-
-  array_slock_t &shared_locks_array;
-  char avoid_falsesharing_2[64];
-
-  int recursive_xlock_count;
-
-
-  enum index_op_t { unregister_thread_op, get_index_op, register_thread_op };
-
-#if (_WIN32 && _MSC_VER < 1900) // only for MSVS 2013
-  typedef int64_t thread_id_t;
-  std::atomic<thread_id_t> owner_thread_id;
-  std::array<int64_t, contention_free_count> register_thread_array;
-  int64_t get_fast_this_thread_id() {
-    static __declspec(thread) int64_t fast_this_thread_id = 0;  // MSVS 2013 thread_local partially supported - only POD
-    if (fast_this_thread_id == 0) {
-      std::stringstream ss;
-      ss << std::this_thread::get_id();   // https://connect.microsoft.com/VisualStudio/feedback/details/1558211
-      fast_this_thread_id = std::stoll(ss.str());
-    }
-    return fast_this_thread_id;
-  }
-
-  int get_or_set_index(index_op_t index_op = get_index_op, int set_index = -1) {
-    if (index_op == get_index_op) {  // get index
-      auto const thread_id = get_fast_this_thread_id();
-
-      for (size_t i = 0; i < register_thread_array.size(); ++i) {
-        if (register_thread_array[i] == thread_id) {
-          set_index = i;   // thread already registred                
-          break;
-        }
-      }
-    }
-    else if (index_op == register_thread_op) {  // register thread
-      register_thread_array[set_index] = get_fast_this_thread_id();
-    }
-    return set_index;
-  }
-
-#else
-  typedef std::thread::id thread_id_t;
-  std::atomic<std::thread::id> owner_thread_id;
-  std::thread::id get_fast_this_thread_id() { return std::this_thread::get_id(); }
-
-  struct unregister_t {
-    int thread_index;
-    std::shared_ptr<array_slock_t> array_slock_ptr;
-    unregister_t(int index, std::shared_ptr<array_slock_t> const& ptr) : thread_index(index), array_slock_ptr(ptr) {}
-    unregister_t(unregister_t &&src) : thread_index(src.thread_index), array_slock_ptr(std::move(src.array_slock_ptr)) {}
-    ~unregister_t() { if (array_slock_ptr.use_count() > 0) (*array_slock_ptr)[thread_index].value--; }
-  };
-
-  int get_or_set_index(index_op_t index_op = get_index_op, int set_index = -1) {
-    thread_local static std::unordered_map<void *, unregister_t> thread_local_index_hashmap;
-    // get thread index - in any cases
-    auto it = thread_local_index_hashmap.find(this);
-    if (it != thread_local_index_hashmap.cend())
-      set_index = it->second.thread_index;
-
-    if (index_op == unregister_thread_op) {  // unregister thread
-      if (shared_locks_array[set_index].value == 1) // if isn't shared_lock now
-        thread_local_index_hashmap.erase(this);
-      else
-        return -1;
-    }
-    else if (index_op == register_thread_op) {  // register thread
-      thread_local_index_hashmap.emplace(this, unregister_t(set_index, shared_locks_array_ptr));
-
-      // remove info about deleted contfree-mutexes
-      for (auto it = thread_local_index_hashmap.begin(), ite = thread_local_index_hashmap.end(); it != ite;) {
-        if (it->second.array_slock_ptr->at(it->second.thread_index).value < 0)    // if contfree-mtx was deleted
-          it = thread_local_index_hashmap.erase(it);
-        else
-          ++it;
-      }
-    }
-    return set_index;
-  }
-
-#endif
-
-public:
-  contention_free_shared_mutex() :
-      shared_locks_array_ptr(std::make_shared<array_slock_t>()), shared_locks_array(*shared_locks_array_ptr), want_x_lock(false), recursive_xlock_count(0),
-      owner_thread_id(thread_id_t()) {}
-
-  ~contention_free_shared_mutex() {
-    for (auto &i : shared_locks_array) i.value = -1;
-  }
-
-
-  bool unregister_thread() { return get_or_set_index(unregister_thread_op) >= 0; }
-
-  int register_thread() {
-    int cur_index = get_or_set_index();
-
-    if (cur_index == -1) {
-      if (shared_locks_array_ptr.use_count() <= (int)shared_locks_array.size())  // try once to register thread
-      {
-        for (size_t i = 0; i < shared_locks_array.size(); ++i) {
-          int unregistred_value = 0;
-          if (shared_locks_array[i].value == 0)
-            if (shared_locks_array[i].value.compare_exchange_strong(unregistred_value, 1)) {
-              cur_index = i;
-              get_or_set_index(register_thread_op, cur_index);   // thread registred success
-              break;
-            }
-        }
-          //std::cout << "\n thread_id = " << std::this_thread::get_id() << ", register_thread_index = " << cur_index <<
-          //    ", shared_locks_array[cur_index].value = " << shared_locks_array[cur_index].value << std::endl;
-      }
-    }
-    return cur_index;
-  }
-
-  void lock_shared() {
-    int const register_index = register_thread();
-
-    if (register_index >= 0) {
-      int recursion_depth = shared_locks_array[register_index].value.load(std::memory_order_acquire);
-      assert(recursion_depth >= 1);
-
-      if (recursion_depth > 1)
-        shared_locks_array[register_index].value.store(recursion_depth + 1, std::memory_order_release); // if recursive -> release
-      else {
-        shared_locks_array[register_index].value.store(recursion_depth + 1, std::memory_order_seq_cst); // if first -> sequential
-        while (want_x_lock.load(std::memory_order_seq_cst)) {
-          shared_locks_array[register_index].value.store(recursion_depth, std::memory_order_seq_cst);
-          for ( size_t i = 0; want_x_lock.load(std::memory_order_seq_cst); ++i) 
-            if (i % 100000 == 0) std::this_thread::yield();
-          shared_locks_array[register_index].value.store(recursion_depth + 1, std::memory_order_seq_cst);
-        }
-      }
-      // (shared_locks_array[register_index] == 2 && want_x_lock == false) ||     // first shared lock
-      // (shared_locks_array[register_index] > 2)                                 // recursive shared lock
-    }
-    else {
-      if (owner_thread_id.load(std::memory_order_acquire) != get_fast_this_thread_id()) {
-        size_t i = 0;
-        for (bool flag = false; !want_x_lock.compare_exchange_weak(flag, true, std::memory_order_seq_cst); flag = false)
-          if (++i % 100000 == 0) std::this_thread::yield();
-        owner_thread_id.store(get_fast_this_thread_id(), std::memory_order_release);
-      }
-      ++recursive_xlock_count;
-    }
-  }
-
-  void unlock_shared() {
-    int const register_index = get_or_set_index();
-
-    if (register_index >= 0) {
-      int const recursion_depth = shared_locks_array[register_index].value.load(std::memory_order_acquire);
-      assert(recursion_depth > 1);
-
-      shared_locks_array[register_index].value.store(recursion_depth - 1, std::memory_order_release);
-    }
-    else {
-      if (--recursive_xlock_count == 0) {
-        owner_thread_id.store(decltype(owner_thread_id)(), std::memory_order_release);
-        want_x_lock.store(false, std::memory_order_release);
-      }
-    }
-  }
-
-  void lock() {
-    // forbidden upgrade S-lock to X-lock - this is an excellent opportunity to get deadlock
-    int const register_index = get_or_set_index();
-    if (register_index >= 0)
-      assert(shared_locks_array[register_index].value.load(std::memory_order_acquire) == 1);
-
-    if (owner_thread_id.load(std::memory_order_acquire) != get_fast_this_thread_id()) {
-      size_t i = 0;
-      for (bool flag = false; !want_x_lock.compare_exchange_weak(flag, true, std::memory_order_seq_cst); flag = false)
-        if (++i % 1000000 == 0) std::this_thread::yield();
-
-      owner_thread_id.store(get_fast_this_thread_id(), std::memory_order_release);
-
-      for (auto &i : shared_locks_array)
-        while (i.value.load(std::memory_order_seq_cst) > 1);
-    }
-
-    ++recursive_xlock_count;
-  }
-
-  void unlock() {
-    assert(recursive_xlock_count > 0);
-    if (--recursive_xlock_count == 0) {
-      owner_thread_id.store(decltype(owner_thread_id)(), std::memory_order_release);
-      want_x_lock.store(false, std::memory_order_release);
-    }
-  }
-};
-
-template<typename mutex_t>
-struct shared_lock_guard {
-  mutex_t &ref_mtx;
-  shared_lock_guard(mutex_t &mtx) : ref_mtx(mtx) { ref_mtx.lock_shared(); }
-  ~shared_lock_guard() { ref_mtx.unlock_shared(); }
-};
-
-using default_contention_free_shared_mutex = contention_free_shared_mutex<>;
-// ---------------------------------------------------------------
-
-}   // namespace sf;
-
-
 namespace mp {
   class Process_O;
   typedef gctools::smart_ptr<Process_O> Process_sp;
@@ -299,6 +73,26 @@ namespace mp {
       _SpinLock.unlock();
     }
   };
+
+  // Hint to the CPU that we are busy-waiting.
+  inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Block while WORD still holds EXPECTED, for at most TIMEOUT seconds
+  // (indefinitely if TIMEOUT is negative). May return spuriously, so callers
+  // must recheck their condition. Uses futex(2) on Linux and short sleeps
+  // elsewhere.
+  void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, double timeout);
+  // Wake one (or all) of the threads blocked in futex_wait on WORD.
+  void futex_wake(std::atomic<uint32_t>& word, bool all = false);
+
+  // Record that a lock with this name had to wait; see LOCK-CONTENTION-STATISTICS.
+  void note_lock_contention(uint64_t nameword);
     
 
 extern "C" void mutex_lock_enter(char* nameword);
@@ -341,14 +135,19 @@ void debug_mutex_unlock(Mutex* m);
 #define SUSPBARR_NAMEWORD 0x0052424250535553
 #define DISSASSM_NAMEWORD 0x0053534153534944
 #define JITGDBIF_NAMEWORD 0x004942444754494a
+#define JITOBJCA_NAMEWORD 0x00434a424f54494a
 #define MPSMESSG_NAMEWORD 0x005353454d53504d     // MPSMESSG
 
+// Times a waiting lock retries before blocking in the kernel.
+#define MUTEX_SPIN_COUNT 100
+
 struct Mutex {
   uint64_t _NameWord;
   pthread_mutex_t _Mutex;
   gctools::Fixnum _Counter;
+  size_t _Contentions; // acquisitions that had to block
   bool _Recursive;
-  Mutex(uint64_t nameword, bool recursive=false) : _NameWord(nameword), _Counter(0), _Recursive(recursive) {
+  Mutex(uint64_t nameword, bool recursive=false) : _NameWord(nameword), _Counter(0), _Contentions(0), _Recursive(recursive) {
     if (!recursive) {
       pthread_mutex_init(&this->_Mutex,NULL);
     } else {
@@ -359,7 +158,7 @@ struct Mutex {
       pthread_mutexattr_destroy(&Attr);
     }
   };
-  Mutex() : _NameWord(DEFAULT__NAMEWORD), _Counter(0), _Recursive(false) {
+  Mutex() : _NameWord(DEFAULT__NAMEWORD), _Counter(0), _Contentions(0), _Recursive(false) {
     pthread_mutex_init(&this->_Mutex,NULL);
   };
   bool lock(bool waitp=true) {
@@ -370,12 +169,15 @@ struct Mutex {
 #ifdef DEBUG_DTRACE_LOCK_PROBE
       DtraceLockProbe _guard((char*)&this->_NameWord);
 #endif
-      bool result = (pthread_mutex_lock(&this->_Mutex)==0);
+      bool result = (pthread_mutex_trylock(&this->_Mutex)==0) || this->lock_slow();
       ++this->_Counter;
       return result;
     }
     return pthread_mutex_trylock(&this->_Mutex)==0;
   };
+  // Spin for a while before blocking, since most critical sections are
+  // shorter than a round trip through the kernel.
+  bool lock_slow();
   void unlock() {
 #ifdef DEBUG_THREADS
     debug_mutex_unlock(this);
@@ -386,6 +188,9 @@ struct Mutex {
   size_t counter() const {
     return this->_Counter;
   }
+  size_t contentions() const {
+    return __atomic_load_n(&this->_Contentions, __ATOMIC_RELAXED);
+  }
   ~Mutex() {
     pthread_mutex_destroy(&this->_Mutex);
   };
@@ -419,10 +224,101 @@ struct SharedMutex {
   }
 };
 #else
-struct SharedMutex : public sf::contention_free_shared_mutex<> {
+// Every package and shared mutex embeds a lock, at 64 bytes a stripe, so
+// keep this small; threads beyond it share stripes.
+#define BIG_READER_STRIPES 8
+#define BIG_READER_STRIPE_BYTES 64
+#define BIG_READER_HELD 8
+
+// Per-thread state for BigReaderMutex: which reader stripe this thread uses,
+// and which big reader locks it holds for reading, so that a recursive read
+// lock isn't turned away by a waiting writer.
+struct BigReaderThread {
+  int _Stripe; // -1 until the thread first takes a read lock
+  uint32_t _Count;
+  uint32_t _Overflow; // read locks held beyond what _Held can record, kept in tl_BigReaderOverflow
+  const void* _Held[BIG_READER_HELD];
+};
+extern thread_local BigReaderThread tl_BigReaderThread;
+void big_reader_assign_stripe();
+
+// A reader-writer lock for read-mostly data like package tables.
+// A reader only touches its own stripe of the reader count, so readers on
+// different threads don't fight over a cache line. A writer claims _Writer,
+// which turns new readers away, and waits for every stripe to drain.
+// Stripes are handed to threads round robin rather than indexed by CPU,
+// since a thread may migrate between taking and releasing a read lock.
+// Write locks are recursive and a writer may take read locks, but upgrading
+// a read lock to a write lock deadlocks.
+struct BigReaderMutex {
+  // Padded rather than alignas'd: the lock lives in GC objects, which are
+  // only CLASP_ALIGNMENT aligned. Stripes 64 bytes apart never share a
+  // cache line, wherever the array starts.
+  struct Stripe {
+    std::atomic<uint32_t> _Readers;
+    char _Pad[BIG_READER_STRIPE_BYTES - sizeof(std::atomic<uint32_t>)];
+  };
+  uint64_t _NameWord;
+  Stripe _Stripes[BIG_READER_STRIPES];
+  // 0 when free, 1 when write locked, 2 when write locked with waiters.
+  std::atomic<uint32_t> _Writer;
+  // Bumped by readers leaving while a writer is waiting for them.
+  std::atomic<uint32_t> _ReaderExits;
+  std::atomic<const void*> _Owner;
+  uint32_t _WriteDepth;
+  BigReaderMutex(uint64_t nameword = DEFAULT__NAMEWORD)
+      : _NameWord(nameword), _Writer(0), _ReaderExits(0), _Owner(NULL), _WriteDepth(0) {
+    for (auto& stripe : this->_Stripes)
+      stripe._Readers.store(0, std::memory_order_relaxed);
+  }
+  bool owned() const { return this->_Owner.load(std::memory_order_relaxed) == &tl_BigReaderThread; }
+  void lock_shared() {
+    if (this->owned()) {
+      ++this->_WriteDepth;
+      return;
+    }
+    BigReaderThread& self = tl_BigReaderThread;
+    if (self._Stripe < 0)
+      big_reader_assign_stripe();
+    std::atomic<uint32_t>& readers = this->_Stripes[self._Stripe]._Readers;
+    readers.fetch_add(1, std::memory_order_seq_cst);
+    if (this->_Writer.load(std::memory_order_seq_cst) != 0)
+      this->lock_shared_slow(readers);
+    if (self._Count < BIG_READER_HELD)
+      self._Held[self._Count++] = this;
+    else
+      this->hold_overflow();
+  }
+  void unlock_shared() {
+    if (this->owned()) {
+      --this->_WriteDepth;
+      return;
+    }
+    BigReaderThread& self = tl_BigReaderThread;
+    if (self._Count > 0 && self._Held[self._Count - 1] == this)
+      --self._Count;
+    else
+      this->forget_held();
+    this->_Stripes[self._Stripe]._Readers.fetch_sub(1, std::memory_order_seq_cst);
+    if (this->_Writer.load(std::memory_order_seq_cst) != 0)
+      this->reader_exited();
+  }
+  void lock();
+  void unlock();
+
+private:
+  void lock_shared_slow(std::atomic<uint32_t>& readers);
+  void hold_overflow();
+  bool held_for_reading() const;
+  void forget_held();
+  void reader_exited();
+  void wait_for_writer();
+  void wait_for_readers();
+};
+
+struct SharedMutex : public BigReaderMutex {
   SharedMutex() {};
-  uint64_t _r;
-  SharedMutex(uint64_t nameword) : _r(nameword) {};
+  SharedMutex(uint64_t nameword) : BigReaderMutex(nameword) {};
   // shared access
   void shared_lock() {
     this->lock_shared();
@@ -446,21 +342,23 @@ struct SharedMutex : public sf::contention_free_shared_mutex<> {
     bool    mReadsBlocked;
     uint     mMaxReaders;
     uint     mReaders;
+    uint     mWaiters = 0;
+    // Bumped whenever a reader leaves or a writer unlocks; waiters park on it.
+    std::atomic<uint32_t> mChanged{0};
   public:
     UpgradableSharedMutex(uint64_t nameword, uint maxReaders = 64, uint64_t writenameword=0 ) :
       mReadMutex(nameword),
       mWriteMutex(writenameword ? writenameword : nameword),
       mReadsBlocked( false ), mMaxReaders( maxReaders ), mReaders( 0 ) {};
     void readLock() {
-      while ( 1 ) {
+      for ( size_t spins = 0; ; ++spins ) {
         mReadMutex._value.lock();
         if (( !mReadsBlocked ) && ( mReaders < mMaxReaders )) {
           mReaders++; 
           mReadMutex._value.unlock();
           return;
         }
-        mReadMutex._value.unlock();
-        muSleep( 0 );
+        waitChanged( spins );
       }
       assert( 0 );
     };
@@ -468,6 +366,7 @@ struct SharedMutex : public sf::contention_free_shared_mutex<> {
       mReadMutex._value.lock(); 
       assert( mReaders );
       mReaders--; 
+      notifyChanged();
       mReadMutex._value.unlock(); 
     };
 
@@ -495,6 +394,7 @@ struct SharedMutex : public sf::contention_free_shared_mutex<> {
           mReaders--; 
       }
       mReadsBlocked = false;
+      notifyChanged();
       mReadMutex._value.unlock();
       mWriteMutex._value.unlock(); 
     }
@@ -505,18 +405,42 @@ struct SharedMutex : public sf::contention_free_shared_mutex<> {
       mReadsBlocked = true;
       mReadMutex._value.unlock();  
    // wait for current readers to finish
-      while ( 1 ) {
+      for ( size_t spins = 0; ; ++spins ) {
         mReadMutex._value.lock();
         if ( mReaders == numReaders )
         {
           mReadMutex._value.unlock();  
           break;
         }
-        mReadMutex._value.unlock();  
-        muSleep( 0 );
+        waitChanged( spins );
       }
       assert( mReaders == numReaders );
     }
+    /* Call with mReadMutex held; releases it. Spin a while, then park until
+       notifyChanged. Reading mChanged under the lock means no wakeup is lost. */
+    void waitChanged(size_t spins) {
+      if ( spins < MUTEX_SPIN_COUNT ) {
+        mReadMutex._value.unlock();
+        cpu_relax();
+        return;
+      }
+      if ( spins == MUTEX_SPIN_COUNT )
+        note_lock_contention( mReadMutex._value._NameWord );
+      uint32_t seen = mChanged.load( std::memory_order_relaxed );
+      mWaiters++;
+      mReadMutex._value.unlock();
+      futex_wait( mChanged, seen, -1.0 );
+      mReadMutex._value.lock();
+      mWaiters--;
+      mReadMutex._value.unlock();
+    }
+    /* Call with mReadMutex held. */
+    void notifyChanged() {
+      if ( mWaiters ) {
+        mChanged.fetch_add( 1, std::memory_order_relaxed );
+        futex_wake( mChanged, true );
+      }
+    }
   };
 
 
@@ -29,6 +29,7 @@ THE SOFTWARE.
 #define _clasp_mpPackage_H
 #include <clasp/core/mpPackage.fwd.h>
 #include <clasp/core/sequence.h> // cl__reverse
+#include <clasp/core/array.fwd.h>
 
 namespace mp {
 FORWARD(Process);
@@ -36,6 +37,7 @@ FORWARD(Mutex);
 FORWARD(SharedMutex);
 FORWARD(RecursiveMutex);
 FORWARD(ConditionVariable);
+FORWARD(Channel);
 }; // namespace mp
 
 namespace mp {
@@ -325,6 +327,61 @@ public:
   CL_DEFMETHOD core::T_sp condition_variable_name() { return _Name; }
   string __repr__() const override;
 };
+}; // namespace mp
+
+template <> struct gctools::GCInfo<mp::Channel_O> {
+  static bool constexpr NeedsInitialization = false;
+  static bool constexpr NeedsFinalization = false;
+  static GCInfo_policy constexpr Policy = normal;
+};
+
+namespace mp {
+
+/*! A multi-producer, multi-consumer FIFO channel.
+    Bounded channels are Vyukov's ring buffer: each cell has a sequence
+    number that says whether it is ready to be written or read, and
+    producers and consumers claim cells by CAS on their own position.
+    Unbounded channels are a Michael-Scott queue of conses.
+    Neither takes a lock; threads only park (on a futex word) when the
+    channel is empty, or full if bounded. */
+FORWARD(Channel);
+class Channel_O : public core::CxxObject_O {
+  LISP_CLASS(mp, MpPkg, Channel_O, "Channel", core::CxxObject_O);
+
+public:
+  static Channel_sp make_channel(core::T_sp name, size_t capacity);
+
+public:
+  core::T_sp _Name;
+  //! Zero for an unbounded channel.
+  size_t _Capacity;
+  // Bounded channels
+  core::SimpleVector_sp _Slots;
+  core::SimpleVector_size_t_sp _Sequences;
+  std::atomic<size_t> _EnqueuePos;
+  std::atomic<size_t> _DequeuePos;
+  // Unbounded channels. _Head is a dummy cons whose successors hold the values.
+  std::atomic<core::T_sp> _Head;
+  std::atomic<core::T_sp> _Tail;
+  // Futex words, bumped whenever a waiter might be able to proceed.
+  std::atomic<uint32_t> _NotEmpty;
+  std::atomic<uint32_t> _NotFull;
+  std::atomic<uint32_t> _ReceiversWaiting;
+  std::atomic<uint32_t> _SendersWaiting;
+
+  Channel_O(core::T_sp name, size_t capacity)
+      : _Name(name), _Capacity(capacity), _EnqueuePos(0),
+        _DequeuePos(0), _Head(nil<core::T_O>()), _Tail(nil<core::T_O>()), _NotEmpty(0), _NotFull(0), _ReceiversWaiting(0),
+        _SendersWaiting(0){};
+  bool try_send(core::T_sp value);
+  bool try_receive(core::T_sp &value);
+  //! TIMEOUT in seconds; negative means wait indefinitely. Returns false on timeout.
+  bool send(core::T_sp value, double timeout);
+  bool receive(core::T_sp &value, double timeout);
+  size_t count() const;
+  string __repr__() const override;
+};
+
 void mp__interrupt_process(Process_sp process, core::T_sp func);
 }; // namespace mp
 
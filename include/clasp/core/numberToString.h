@@ -33,5 +33,16 @@ namespace core {
 StrNs_sp core__integer_to_string(StrNs_sp buffer, Integer_sp integer,
                                  Fixnum_sp base, bool radix=false, bool decimalp=false);
 
+/*! Room for a fixnum in base 2 with sign, radix prefix and trailing point */
+#define CLASP_FIXNUM_CHARS_MAX 80
+
+/*! Write FN in BASE (2..36) to BUF, which must hold CLASP_FIXNUM_CHARS_MAX
+    characters, returning the number of characters written.  RADIX and
+    DECIMALP have the meaning they have for core__integer_to_string. */
+size_t clasp_fixnum_to_chars(char *buf, gc::Fixnum fn, int base, bool radix, bool decimalp);
+
+/*! Print INTEGER directly into STREAM without consing an intermediate string */
+void clasp_write_integer(Integer_sp integer, int base, bool radix, bool decimalp, T_sp stream);
+
 };
 #endif
@@ -221,7 +221,8 @@ template <>
     typedef float DeclareType;
 
     DeclareType _v;
-    from_object( core::T_sp o ) : _v( core::clasp_to_float( gc::As<core::Number_sp>(o) ) ) {};
+    from_object( core::T_sp o ) : _v( o.single_floatp() ? o.unsafe_single_float()
+                                      : core::clasp_to_float( gc::As<core::Number_sp>(o) ) ) {};
   };
 
   template <>
@@ -230,7 +231,10 @@ template <>
     typedef double DeclareType;
 
     DeclareType _v;
-    from_object( core::T_sp o ) : _v( core::clasp_to_double( gc::As<core::Number_sp>(o) ) ) {};
+    // Double floats are checked first, inline, since they are what most
+    // callers of a function taking a double pass.
+    from_object( core::T_sp o ) : _v( gc::IsA<core::DoubleFloat_sp>(o) ? gc::As_unsafe<core::DoubleFloat_sp>(o)->get()
+                                      : core::clasp_to_double( gc::As<core::Number_sp>(o) ) ) {};
   };
 
   template <>
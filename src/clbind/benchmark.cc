@@ -0,0 +1,83 @@
+/*
+    File: benchmark.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+// Small C++ classes and functions for measuring the cost of calling
+// through clbind. They are only exposed, in the package CLBIND-BENCHMARK,
+// when clbind:expose-call-benchmark is called - see
+// tools/clbind-call-benchmark.lisp.
+
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/clbind/clbind.h>
+#include <clasp/core/wrappers.h>
+
+namespace clbind {
+
+struct BenchmarkVector {
+  double x, y, z;
+  BenchmarkVector(double x, double y, double z) : x(x), y(y), z(z){};
+  virtual ~BenchmarkVector(){};
+  double dot(const BenchmarkVector& other) const { return x * other.x + y * other.y + z * other.z; };
+  void scale(double factor) {
+    x *= factor;
+    y *= factor;
+    z *= factor;
+  };
+  double getX() const { return x; };
+};
+
+// A subclass, so method calls on it go through a base class cast.
+struct BenchmarkParticle : public BenchmarkVector {
+  double mass;
+  BenchmarkParticle(double x, double y, double z, double mass) : BenchmarkVector(x, y, z), mass(mass){};
+  double momentum() const { return mass * x; };
+};
+
+double benchmark_add_doubles(double a, double b) { return a + b; }
+int64_t benchmark_add_fixnums(int64_t a, int64_t b) { return a + b; }
+
+CL_DOCSTRING(R"dx(Expose the clbind call benchmark classes and functions in the package CLBIND-BENCHMARK.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void clbind__expose_call_benchmark() {
+  if (_lisp->findPackage("CLBIND-BENCHMARK").notnilp())
+    return;
+  package_ pkg("CLBIND-BENCHMARK", {}, {});
+  scope_& m = pkg.scope();
+  m.def("add-doubles", &benchmark_add_doubles);
+  m.def("add-fixnums", &benchmark_add_fixnums);
+  class_<BenchmarkVector>(m, "BenchmarkVector")
+      .def_constructor("make-benchmark-vector", constructor<double, double, double>())
+      .def("dot", &BenchmarkVector::dot)
+      .def("scale", &BenchmarkVector::scale)
+      .def("get-x", &BenchmarkVector::getX);
+  class_<BenchmarkParticle, BenchmarkVector>(m, "BenchmarkParticle")
+      .def_constructor("make-benchmark-particle", constructor<double, double, double, double>())
+      .def("momentum", &BenchmarkParticle::momentum);
+}
+
+}; // namespace clbind
@@ -9,4 +9,5 @@
            #~"clbind.cc"
            #~"clbindPackage.cc"
            #~"class.cc"
-           #~"derivable_class.cc")
+           #~"derivable_class.cc"
+           #~"benchmark.cc")
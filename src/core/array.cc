@@ -625,6 +625,18 @@ void core__copy_subarray(Array_sp dest, Fixnum_sp destStart, Array_sp orig, Fixn
   size_t iOrigStart = unbox_fixnum(origStart);
   if ((iLen + iDestStart) >= dest->arrayTotalSize()) iLen = dest->arrayTotalSize()-iDestStart;
   if ((iLen + iOrigStart) >= orig->arrayTotalSize()) iLen = orig->arrayTotalSize()-iOrigStart;
+  {
+    // Bit vectors are copied a word at a time, whatever the alignment of either range.
+    AbstractSimpleVector_sp destData, origData;
+    size_t destOffset, origOffset, ignore;
+    dest->asAbstractSimpleVectorRange(destData, destOffset, ignore);
+    orig->asAbstractSimpleVectorRange(origData, origOffset, ignore);
+    if (gc::IsA<SimpleBitVector_sp>(destData) && gc::IsA<SimpleBitVector_sp>(origData)) {
+      SimpleBitVector_copyRange(gc::As_unsafe<SimpleBitVector_sp>(destData), destOffset + iDestStart,
+                                gc::As_unsafe<SimpleBitVector_sp>(origData), origOffset + iOrigStart, iLen);
+      return;
+    }
+  }
   if (iDestStart < iOrigStart) {
     for (size_t i = 0; i < iLen; ++i) {
       dest->rowMajorAset(iDestStart, orig->rowMajorAref(iOrigStart));
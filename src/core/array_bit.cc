@@ -5,8 +5,13 @@
 // Functions specific to bit arrays.
 // NOTE: creation through make-array is still in array.cc.
 
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/array.h>
+#include <clasp/core/hwinfo.h>
 
 namespace core {
 void bitVectorDoesntSupportError() {
@@ -54,100 +59,510 @@ bool SimpleBitVector_O::equal(T_sp other) const {
   return false;
 }
 
+/* Word kernels.
+ * Bit I of a simple bit vector lives in word I/BIT_ARRAY_WORD_BITS, and bits are stored most
+ * significant first, so the bits starting at an arbitrary index are obtained by shifting the
+ * containing word left and filling in from the next word.
+ * Each kernel is written once against a "word block" type, which is either a single
+ * bit_array_word or a GCC vector of them, and is then instantiated for the portable case
+ * and for AVX2 and AVX-512 through target attributes. The variant to use is picked from
+ * cpu_features() the first time a kernel runs, so the binary itself needs no -march flags.
+ */
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#define CLASP_BIT_KERNELS_X86 1
+#endif
+
+namespace bitkernel {
+
+enum class BitOp { And, Ior, Xor, Nand, Nor, Eqv, Andc1, Andc2, Orc1, Orc2, Not, Copy };
+
+typedef bit_array_word words4 __attribute__((vector_size(4 * sizeof(bit_array_word))));
+typedef bit_array_word words8 __attribute__((vector_size(8 * sizeof(bit_array_word))));
+
+static constexpr bit_array_word all_ones = ~bit_array_word(0);
+
+template <BitOp Op, typename W>
+[[gnu::always_inline]] inline W apply(W a, W b) {
+  if constexpr (Op == BitOp::And) return a & b;
+  else if constexpr (Op == BitOp::Ior) return a | b;
+  else if constexpr (Op == BitOp::Xor) return a ^ b;
+  else if constexpr (Op == BitOp::Nand) return ~(a & b);
+  else if constexpr (Op == BitOp::Nor) return ~(a | b);
+  else if constexpr (Op == BitOp::Eqv) return ~(a ^ b);
+  else if constexpr (Op == BitOp::Andc1) return ~a & b;
+  else if constexpr (Op == BitOp::Andc2) return a & ~b;
+  else if constexpr (Op == BitOp::Orc1) return ~a | b;
+  else if constexpr (Op == BitOp::Orc2) return a | ~b;
+  else if constexpr (Op == BitOp::Not) return ~a;
+  else return a;
+}
+
+template <typename W>
+[[gnu::always_inline]] inline W load(const bit_array_word* p) {
+  W w;
+  memcpy(&w, p, sizeof(W));
+  return w;
+}
+
+template <typename W>
+[[gnu::always_inline]] inline void store(bit_array_word* p, W w) { memcpy(p, &w, sizeof(W)); }
+
+// The sizeof(W)*CHAR_BIT bits starting SHIFT bits into P[0]. Reads P[n] when SHIFT is
+// nonzero, so the caller must know the bits extend into it.
+template <typename W>
+[[gnu::always_inline]] inline W load_shifted(const bit_array_word* p, unsigned shift) {
+  if (shift == 0) return load<W>(p);
+  return (load<W>(p) << shift) | (load<W>(p + 1) >> (BIT_ARRAY_WORD_BITS - shift));
+}
+
+// N (1 to BIT_ARRAY_WORD_BITS) bits starting at bit POS, in the high bits of the result.
+// Only words containing some of those bits are read. The low bits are garbage.
+inline bit_array_word fetch_bits(const bit_array_word* d, size_t pos, size_t n) {
+  const bit_array_word* p = d + pos / BIT_ARRAY_WORD_BITS;
+  unsigned shift = pos % BIT_ARRAY_WORD_BITS;
+  bit_array_word x = p[0] << shift;
+  if (shift != 0 && shift + n > BIT_ARRAY_WORD_BITS)
+    x |= p[1] >> (BIT_ARRAY_WORD_BITS - shift);
+  return x;
+}
+
+// Mask of bits [start, end) of a word, counting from the most significant bit.
+inline bit_array_word range_mask(unsigned start, unsigned end) {
+  bit_array_word head = all_ones >> start;
+  return (end == BIT_ARRAY_WORD_BITS) ? head : head & ~(all_ones >> end);
+}
+
+inline void merge_word(bit_array_word* r, bit_array_word value, bit_array_word mask) {
+  *r = (*r & ~mask) | (value & mask);
+}
+
+/* R[rstart, rstart+length) = A[astart, ...) op B[bstart, ...), where none of the vectors
+ * need agree on alignment. The partial words at either end of the result are merged in;
+ * the words in between are produced a block at a time from shifted loads. */
+template <BitOp Op, typename V>
+[[gnu::always_inline]] inline void op_range(const bit_array_word* a, size_t astart,
+                                            const bit_array_word* b, size_t bstart,
+                                            bit_array_word* r, size_t rstart, size_t length) {
+  constexpr size_t lanes = sizeof(V) / sizeof(bit_array_word);
+  size_t done = 0;
+  unsigned rshift = rstart % BIT_ARRAY_WORD_BITS;
+  if (length == 0) return;
+  if (rshift != 0 || length < BIT_ARRAY_WORD_BITS) {
+    size_t n = std::min<size_t>(BIT_ARRAY_WORD_BITS - rshift, length);
+    bit_array_word x = apply<Op>(fetch_bits(a, astart, n), fetch_bits(b, bstart, n));
+    merge_word(r + rstart / BIT_ARRAY_WORD_BITS, x >> rshift, range_mask(rshift, rshift + n));
+    done = n;
+  }
+  size_t full = (length - done) / BIT_ARRAY_WORD_BITS;
+  bit_array_word* rw = r + (rstart + done) / BIT_ARRAY_WORD_BITS;
+  const bit_array_word* aw = a + (astart + done) / BIT_ARRAY_WORD_BITS;
+  const bit_array_word* bw = b + (bstart + done) / BIT_ARRAY_WORD_BITS;
+  unsigned ashift = (astart + done) % BIT_ARRAY_WORD_BITS;
+  unsigned bshift = (bstart + done) % BIT_ARRAY_WORD_BITS;
+  size_t i = 0;
+  // Every bit of a full result word comes from within the source ranges, so the
+  // shifted loads never read past the words holding the sources' last bits.
+  for (; i + lanes <= full; i += lanes)
+    store<V>(rw + i, apply<Op>(load_shifted<V>(aw + i, ashift), load_shifted<V>(bw + i, bshift)));
+  for (; i < full; ++i)
+    rw[i] = apply<Op>(load_shifted<bit_array_word>(aw + i, ashift),
+                      load_shifted<bit_array_word>(bw + i, bshift));
+  done += full * BIT_ARRAY_WORD_BITS;
+  if (done < length) {
+    size_t n = length - done;
+    bit_array_word x = apply<Op>(fetch_bits(a, astart + done, n), fetch_bits(b, bstart + done, n));
+    merge_word(rw + full, x, range_mask(0, n));
+  }
+}
+
+// Index of the first word of D[0, nwords) that is not SKIP, or nwords.
+template <typename V>
+[[gnu::always_inline]] inline size_t find_word(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  constexpr size_t lanes = sizeof(V) / sizeof(bit_array_word);
+  V vskip = V{} + skip;
+  size_t i = 0;
+  for (; i + lanes <= nwords; i += lanes) {
+    V x = load<V>(d + i) ^ vskip;
+    bit_array_word any = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) any |= x[lane];
+    if (any != 0) break;
+  }
+  for (; i < nwords; ++i)
+    if (d[i] != skip) return i;
+  return nwords;
+}
+
+// Index of the last word of D[0, nwords) that is not SKIP, or nwords.
+template <typename V>
+[[gnu::always_inline]] inline size_t find_word_from_end(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  constexpr size_t lanes = sizeof(V) / sizeof(bit_array_word);
+  V vskip = V{} + skip;
+  size_t i = nwords;
+  for (; i >= lanes; i -= lanes) {
+    V x = load<V>(d + i - lanes) ^ vskip;
+    bit_array_word any = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) any |= x[lane];
+    if (any != 0) break;
+  }
+  while (i > 0)
+    if (d[--i] != skip) return i;
+  return nwords;
+}
+
+template <>
+[[gnu::always_inline]] inline size_t find_word<bit_array_word>(const bit_array_word* d, size_t nwords,
+                                                               bit_array_word skip) {
+  for (size_t i = 0; i < nwords; ++i)
+    if (d[i] != skip) return i;
+  return nwords;
+}
+
+template <>
+[[gnu::always_inline]] inline size_t find_word_from_end<bit_array_word>(const bit_array_word* d, size_t nwords,
+                                                                        bit_array_word skip) {
+  for (size_t i = nwords; i > 0;)
+    if (d[--i] != skip) return i;
+  return nwords;
+}
+
+typedef void (*op_range_fn)(const bit_array_word*, size_t, const bit_array_word*, size_t, bit_array_word*,
+                            size_t, size_t);
+typedef size_t (*popcount_fn)(const bit_array_word*, size_t);
+typedef size_t (*find_word_fn)(const bit_array_word*, size_t, bit_array_word);
+
+#define BIT_KERNEL_OP_RANGE_ARGS                                                                       \
+  const bit_array_word *a, size_t astart, const bit_array_word *b, size_t bstart, bit_array_word *r, \
+      size_t rstart, size_t length
+#define BIT_KERNEL_OP_RANGE_PARAMS a, astart, b, bstart, r, rstart, length
+
+template <BitOp Op> struct OpRange {
+  static void generic(BIT_KERNEL_OP_RANGE_ARGS) {
+    op_range<Op, bit_array_word>(BIT_KERNEL_OP_RANGE_PARAMS);
+  }
+#ifdef CLASP_BIT_KERNELS_X86
+  __attribute__((target("avx2"))) static void avx2(BIT_KERNEL_OP_RANGE_ARGS) {
+    op_range<Op, words4>(BIT_KERNEL_OP_RANGE_PARAMS);
+  }
+  __attribute__((target("avx512f"))) static void avx512(BIT_KERNEL_OP_RANGE_ARGS) {
+    op_range<Op, words8>(BIT_KERNEL_OP_RANGE_PARAMS);
+  }
+#endif
+  static op_range_fn select() {
+#ifdef CLASP_BIT_KERNELS_X86
+    if (cpu_features().avx512f) return avx512;
+    if (cpu_features().avx2) return avx2;
+#endif
+    return generic;
+  }
+  static void run(BIT_KERNEL_OP_RANGE_ARGS) {
+    static const op_range_fn fn = select();
+    fn(BIT_KERNEL_OP_RANGE_PARAMS);
+  }
+};
+
+static size_t popcount_generic(const bit_array_word* d, size_t nwords) {
+  size_t count = 0;
+  for (size_t i = 0; i < nwords; ++i) count += bit_array_word_popcount(d[i]);
+  return count;
+}
+
+static size_t find_word_generic(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  return find_word<bit_array_word>(d, nwords, skip);
+}
+static size_t find_word_from_end_generic(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  return find_word_from_end<bit_array_word>(d, nwords, skip);
+}
+
+#ifdef CLASP_BIT_KERNELS_X86
+__attribute__((target("popcnt"))) static size_t popcount_popcnt(const bit_array_word* d, size_t nwords) {
+  size_t count = 0;
+  for (size_t i = 0; i < nwords; ++i) count += bit_array_word_popcount(d[i]);
+  return count;
+}
+
+// Mula's nibble lookup: PSHUFB counts each nibble, PSADBW sums the bytes of each lane.
+__attribute__((target("avx2,popcnt"))) static size_t popcount_avx2(const bit_array_word* d, size_t nwords) {
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= nwords; i += 4) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + i));
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low_nibbles));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles));
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  size_t count = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+                 _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+  for (; i < nwords; ++i) count += bit_array_word_popcount(d[i]);
+  return count;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt"))) static size_t popcount_avx512(const bit_array_word* d,
+                                                                                          size_t nwords) {
+  __m512i total = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= nwords; i += 8)
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(_mm512_loadu_si512(d + i)));
+  size_t count = _mm512_reduce_add_epi64(total);
+  for (; i < nwords; ++i) count += bit_array_word_popcount(d[i]);
+  return count;
+}
+
+__attribute__((target("avx2"))) static size_t find_word_avx2(const bit_array_word* d, size_t nwords,
+                                                             bit_array_word skip) {
+  return find_word<words4>(d, nwords, skip);
+}
+__attribute__((target("avx2"))) static size_t find_word_from_end_avx2(const bit_array_word* d, size_t nwords,
+                                                                      bit_array_word skip) {
+  return find_word_from_end<words4>(d, nwords, skip);
+}
+__attribute__((target("avx512f"))) static size_t find_word_avx512(const bit_array_word* d, size_t nwords,
+                                                                  bit_array_word skip) {
+  return find_word<words8>(d, nwords, skip);
+}
+__attribute__((target("avx512f"))) static size_t find_word_from_end_avx512(const bit_array_word* d,
+                                                                           size_t nwords, bit_array_word skip) {
+  return find_word_from_end<words8>(d, nwords, skip);
+}
+#endif
+
+size_t popcount_words(const bit_array_word* d, size_t nwords) {
+  static const popcount_fn fn = []() -> popcount_fn {
+#ifdef CLASP_BIT_KERNELS_X86
+    const CpuFeatures& features = cpu_features();
+    if (features.avx512f && features.avx512vpopcntdq && features.popcnt) return popcount_avx512;
+    if (features.avx2 && features.popcnt) return popcount_avx2;
+    if (features.popcnt) return popcount_popcnt;
+#endif
+    return popcount_generic;
+  }();
+  return fn(d, nwords);
+}
+
+size_t find_word_not(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  static const find_word_fn fn = []() -> find_word_fn {
+#ifdef CLASP_BIT_KERNELS_X86
+    if (cpu_features().avx512f) return find_word_avx512;
+    if (cpu_features().avx2) return find_word_avx2;
+#endif
+    return find_word_generic;
+  }();
+  return fn(d, nwords, skip);
+}
+
+size_t find_word_not_from_end(const bit_array_word* d, size_t nwords, bit_array_word skip) {
+  static const find_word_fn fn = []() -> find_word_fn {
+#ifdef CLASP_BIT_KERNELS_X86
+    if (cpu_features().avx512f) return find_word_from_end_avx512;
+    if (cpu_features().avx2) return find_word_from_end_avx2;
+#endif
+    return find_word_from_end_generic;
+  }();
+  return fn(d, nwords, skip);
+}
+
+// Number of one bits in D[start, end).
+size_t count_ones(const bit_array_word* d, size_t start, size_t end) {
+  if (start >= end) return 0;
+  size_t w0 = start / BIT_ARRAY_WORD_BITS, w1 = (end - 1) / BIT_ARRAY_WORD_BITS;
+  unsigned s = start % BIT_ARRAY_WORD_BITS, e = (end - 1) % BIT_ARRAY_WORD_BITS + 1;
+  if (w0 == w1) return bit_array_word_popcount(d[w0] & range_mask(s, e));
+  return bit_array_word_popcount(d[w0] & range_mask(s, BIT_ARRAY_WORD_BITS)) +
+         popcount_words(d + w0 + 1, w1 - w0 - 1) + bit_array_word_popcount(d[w1] & range_mask(0, e));
+}
+
+// Index of the first (or last) bit equal to BIT in D[start, end), or -1.
+ptrdiff_t position(bool bit, const bit_array_word* d, size_t start, size_t end, bool from_end) {
+  if (start >= end) return -1;
+  bit_array_word skip = bit ? 0 : all_ones;
+  size_t w0 = start / BIT_ARRAY_WORD_BITS, w1 = (end - 1) / BIT_ARRAY_WORD_BITS;
+  unsigned s = start % BIT_ARRAY_WORD_BITS, e = (end - 1) % BIT_ARRAY_WORD_BITS + 1;
+  auto first = [](size_t w, bit_array_word x) { return ptrdiff_t(w * BIT_ARRAY_WORD_BITS + bit_array_word_clz(x)); };
+  auto last = [](size_t w, bit_array_word x) {
+    return ptrdiff_t(w * BIT_ARRAY_WORD_BITS + BIT_ARRAY_WORD_BITS - 1 - __builtin_ctzll(x));
+  };
+  if (w0 == w1) {
+    bit_array_word x = (d[w0] ^ skip) & range_mask(s, e);
+    if (x == 0) return -1;
+    return from_end ? last(w0, x) : first(w0, x);
+  }
+  bit_array_word head = (d[w0] ^ skip) & range_mask(s, BIT_ARRAY_WORD_BITS);
+  bit_array_word tail = (d[w1] ^ skip) & range_mask(0, e);
+  size_t nmiddle = w1 - w0 - 1;
+  if (!from_end) {
+    if (head != 0) return first(w0, head);
+    size_t k = find_word_not(d + w0 + 1, nmiddle, skip);
+    if (k < nmiddle) return first(w0 + 1 + k, d[w0 + 1 + k] ^ skip);
+    return (tail != 0) ? first(w1, tail) : -1;
+  } else {
+    if (tail != 0) return last(w1, tail);
+    size_t k = find_word_not_from_end(d + w0 + 1, nmiddle, skip);
+    if (k < nmiddle) return last(w0 + 1 + k, d[w0 + 1 + k] ^ skip);
+    return (head != 0) ? last(w0, head) : -1;
+  }
+}
+
+}; // namespace bitkernel
+
+/* Apply OP to bit ranges of simple bit vectors. The kernels write the result a word at a
+ * time from low indices up, so a source that shares storage with the result at a different
+ * offset is copied out first. */
+template <bitkernel::BitOp Op>
+static SimpleBitVector_sp sbv_bit_op_range(SimpleBitVector_sp a, size_t astart, SimpleBitVector_sp b, size_t bstart,
+                                           SimpleBitVector_sp r, size_t rstart, size_t length) {
+  if (astart + length > a->length() || bstart + length > b->length() || rstart + length > r->length())
+    SIMPLE_ERROR("Bit vector range of length {} starting at {}, {} and {} is out of bounds", length, astart, bstart,
+                 rstart);
+  if (a == r && astart != rstart) {
+    a = sbv_bit_op_range<bitkernel::BitOp::Copy>(a, astart, a, astart, SimpleBitVector_O::make(length), 0, length);
+    astart = 0;
+  }
+  if (b == r && bstart != rstart) {
+    b = sbv_bit_op_range<bitkernel::BitOp::Copy>(b, bstart, b, bstart, SimpleBitVector_O::make(length), 0, length);
+    bstart = 0;
+  }
+  bitkernel::OpRange<Op>::run(a->bytes(), astart, b->bytes(), bstart, r->bytes(), rstart, length);
+  return r;
+}
+
+// Whole-word operations over the first LENGTH bits, used when no offsets are involved.
 // The division is length/BIT_ARRAY_WORD_BITS, but rounding up.
-#define DEF_SBV_BIT_OP(name, form)\
-CL_DEFUN SimpleBitVector_sp core__sbv_bit_##name(SimpleBitVector_sp a, SimpleBitVector_sp b,\
-                                                   SimpleBitVector_sp r, size_t length) { \
-    bit_array_word *ab, *bb, *rb;\
-    ab = a->bytes(); bb = b->bytes(); rb = r->bytes();\
-    size_t nwords = length/BIT_ARRAY_WORD_BITS + ((length % BIT_ARRAY_WORD_BITS == 0) ? 0 : 1);\
-    for (size_t i = 0; i < nwords; ++i) rb[i] = form;\
-    return r;\
+#define DEF_SBV_BIT_OP(name, op)                                                                                    \
+  CL_DEFUN SimpleBitVector_sp core__sbv_bit_##name(SimpleBitVector_sp a, SimpleBitVector_sp b, SimpleBitVector_sp r, \
+                                                   size_t length) {                                                \
+    size_t nwords = length / BIT_ARRAY_WORD_BITS + ((length % BIT_ARRAY_WORD_BITS == 0) ? 0 : 1);                   \
+    bitkernel::OpRange<op>::run(a->bytes(), 0, b->bytes(), 0, r->bytes(), 0, nwords * BIT_ARRAY_WORD_BITS);        \
+    return r;                                                                                                       \
   }
+
+// Operations on LENGTH bits starting at arbitrary indices of each vector, as needed for
+// displaced bit arrays.
+#define DEF_SBV_BIT_OP_RANGE(name, op)                                                                       \
+  CL_DEFUN SimpleBitVector_sp core__sbv_bit_##name##_range(SimpleBitVector_sp a, size_t astart,              \
+                                                           SimpleBitVector_sp b, size_t bstart,              \
+                                                           SimpleBitVector_sp r, size_t rstart, size_t length) { \
+    return sbv_bit_op_range<op>(a, astart, b, bstart, r, rstart, length);                                    \
+  }
+
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(and, ab[i] & bb[i])
+DEF_SBV_BIT_OP(and, bitkernel::BitOp::And)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(ior, ab[i] | bb[i])
+DEF_SBV_BIT_OP(ior, bitkernel::BitOp::Ior)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(xor, ab[i] ^ bb[i])
+DEF_SBV_BIT_OP(xor, bitkernel::BitOp::Xor)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(nand, ~(ab[i] & bb[i]))
+DEF_SBV_BIT_OP(nand, bitkernel::BitOp::Nand)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(nor, ~(ab[i] | bb[i]))
+DEF_SBV_BIT_OP(nor, bitkernel::BitOp::Nor)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(eqv, ~(ab[i] ^ bb[i]))
+DEF_SBV_BIT_OP(eqv, bitkernel::BitOp::Eqv)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(andc1, ~(ab[i]) & bb[i])
+DEF_SBV_BIT_OP(andc1, bitkernel::BitOp::Andc1)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(andc2, ab[i] & ~(bb[i]))
+DEF_SBV_BIT_OP(andc2, bitkernel::BitOp::Andc2)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(orc1, ~(ab[i]) | bb[i])
+DEF_SBV_BIT_OP(orc1, bitkernel::BitOp::Orc1)
 
 DOCGROUP(clasp);
-DEF_SBV_BIT_OP(orc2, ab[i] | ~(bb[i]))
+DEF_SBV_BIT_OP(orc2, bitkernel::BitOp::Orc2)
 
 DOCGROUP(clasp);
 CL_DEFUN SimpleBitVector_sp core__sbv_bit_not(SimpleBitVector_sp vec, SimpleBitVector_sp res,
                                               size_t length) {
-  bit_array_word *vecb, *resb;
-  vecb = vec->bytes(); resb = res->bytes();
   size_t nwords = length/BIT_ARRAY_WORD_BITS + ((length % BIT_ARRAY_WORD_BITS == 0) ? 0 : 1);
-  for (size_t i = 0; i < nwords; ++i) resb[i] = ~(vecb[i]);
+  bitkernel::OpRange<bitkernel::BitOp::Not>::run(vec->bytes(), 0, vec->bytes(), 0, res->bytes(), 0,
+                                                 nwords * BIT_ARRAY_WORD_BITS);
   return res;
 }
 
-/* This macro handles iterating over a single bit vector efficiently.
- * The first argument is a SimpleBitVector_sp. The second and third are variables, and
- * the fourth is zero or more statements. The statements will be executed in such that
- * the first variable is bound to the successive bit_array_words of the bit vector, and
- * the second is bound to the index of the word in the bit vector's words.
- */
-#define DO_BIT_ARRAY_WORDS(vec, word, i, statement)                                    \
-  do {                                                                                 \
-    bit_array_word* bytes = vec->bytes();                                              \
-    bit_array_word word;                                                               \
-    size_t len = vec->length();                                                        \
-    size_t nwords = len / BIT_ARRAY_WORD_BITS;                                         \
-    size_t leftover = len % BIT_ARRAY_WORD_BITS;                                       \
-    size_t i;                                                                          \
-    for (i = 0; i < nwords; ++i) { word = bytes[i]; statement}                         \
-    i = nwords;                                                                        \
-    if (leftover != 0) {                                                               \
-      bit_array_word mask = ((1 << leftover) - 1) << (BIT_ARRAY_WORD_BITS - leftover); \
-      word = bytes[i] & mask;                                                          \
-      statement}                                                                       \
-  } while (0);
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(and, bitkernel::BitOp::And)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(ior, bitkernel::BitOp::Ior)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(xor, bitkernel::BitOp::Xor)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(nand, bitkernel::BitOp::Nand)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(nor, bitkernel::BitOp::Nor)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(eqv, bitkernel::BitOp::Eqv)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(andc1, bitkernel::BitOp::Andc1)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(andc2, bitkernel::BitOp::Andc2)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(orc1, bitkernel::BitOp::Orc1)
+
+DOCGROUP(clasp);
+DEF_SBV_BIT_OP_RANGE(orc2, bitkernel::BitOp::Orc2)
+
+DOCGROUP(clasp);
+CL_DEFUN SimpleBitVector_sp core__sbv_bit_not_range(SimpleBitVector_sp vec, size_t vstart,
+                                                    SimpleBitVector_sp res, size_t rstart, size_t length) {
+  return sbv_bit_op_range<bitkernel::BitOp::Not>(vec, vstart, vec, vstart, res, rstart, length);
+}
+
+// Copy LENGTH bits from SOURCE starting at SSTART into DEST starting at DSTART.
+void SimpleBitVector_copyRange(SimpleBitVector_sp dest, size_t dstart, SimpleBitVector_sp source, size_t sstart,
+                               size_t length) {
+  sbv_bit_op_range<bitkernel::BitOp::Copy>(source, sstart, source, sstart, dest, dstart, length);
+}
+
+// Number of ones in the bit vector between START and END.
+DOCGROUP(clasp);
+CL_DEFUN Integer_sp core__sbv_count_ones(SimpleBitVector_sp vec, size_t start, size_t end) {
+  if (start > end || end > vec->length())
+    SIMPLE_ERROR("Invalid bit vector range {} to {} for length {}", start, end, vec->length());
+  return make_fixnum(bitkernel::count_ones(vec->bytes(), start, end));
+}
+
+// Index of the first (or with FROM-END, last) BIT in the bit vector between START and END, or NIL.
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__sbv_position(Fixnum_sp bit, SimpleBitVector_sp vec, size_t start, size_t end, T_sp from_end) {
+  if (start > end || end > vec->length())
+    SIMPLE_ERROR("Invalid bit vector range {} to {} for length {}", start, end, vec->length());
+  ptrdiff_t pos = bitkernel::position(unbox_fixnum(bit) != 0, vec->bytes(), start, end, from_end.notnilp());
+  if (pos < 0) return nil<T_O>();
+  return make_fixnum(pos);
+}
 
 // Population count for simple bit vector.
 DOCGROUP(clasp);
 CL_DEFUN Integer_sp core__sbv_popcnt(SimpleBitVector_sp vec) {
-  ASSERT(sizeof(bit_array_word) == sizeof(unsigned long long)); // for popcount. FIXME
-  gctools::Fixnum result = 0;
-  DO_BIT_ARRAY_WORDS(vec, word, i, result += bit_array_word_popcount(word););
-  return make_fixnum(result);
+  return make_fixnum(bitkernel::count_ones(vec->bytes(), 0, vec->length()));
 }
 
 DOCGROUP(clasp);
 CL_DEFUN bool core__sbv_zerop(SimpleBitVector_sp vec) {
-  DO_BIT_ARRAY_WORDS(vec, word, i, if (word != 0) return false;);
-  return true;
+  return bitkernel::position(true, vec->bytes(), 0, vec->length(), false) < 0;
 }
 
 // Returns the index of the first 1 in the bit vector, or NIL.
 DOCGROUP(clasp);
 CL_DEFUN T_sp core__sbv_position_one(SimpleBitVector_sp v) {
-  DO_BIT_ARRAY_WORDS(v, w, i,
-                     if (w != 0)
-                       return make_fixnum(i*BIT_ARRAY_WORD_BITS + bit_array_word_clz(w)););
-  return nil<T_O>();
+  ptrdiff_t pos = bitkernel::position(true, v->bytes(), 0, v->length(), false);
+  if (pos < 0) return nil<T_O>();
+  return make_fixnum(pos);
 }
 
 // The following SimpleBitVector_ functions are used in Cando.
@@ -0,0 +1,352 @@
+/*
+    File: asyncIO.cc
+
+    Low level support for asynchronous file I/O (see lsp/async-io.lisp).
+
+    On Linux this drives an io_uring directly through its system calls, so
+    there is no dependency on liburing.  The ring is shared by every thread:
+    submitters serialize on a lock held by the Lisp side while they fill
+    submission entries, and a single completion process waits for and reaps
+    completion entries.  The two halves of the ring are independent, so
+    submitting never waits for the reaper.  Only operations from the first
+    io_uring kernels (5.1) are used, READV/WRITEV and their FIXED forms, so
+    any kernel that can set up a ring can run them.
+
+    core:io-pread and core:io-pwrite are the blocking equivalents, used by
+    the thread pool that stands in when io_uring is unavailable.
+*/
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/array.h>
+#include <clasp/core/fli.h>
+#include <clasp/core/lispList.h>
+#include <clasp/core/ql.h>
+#include <clasp/core/wrappers.h>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define CLASP_IO_URING 1
+#endif
+#endif
+
+namespace core {
+
+/* Return the address of BUFFER's element START after checking that
+   [START, END) is a valid range of octets in it. */
+static unsigned char* octet_buffer_address(Array_sp buffer, size_t start, size_t end) {
+  if (buffer->rank() != 1 || buffer->element_type() != ext::_sym_byte8)
+    TYPE_ERROR(buffer, Cons_O::createList(cl::_sym_vector, ext::_sym_byte8));
+  if (start > end || end > buffer->arrayTotalSize())
+    SIMPLE_ERROR("Bad range [{}, {}) for a buffer of length {}", start, end, buffer->arrayTotalSize());
+  return (unsigned char*)buffer->rowMajorAddressOfElement_(0) + start;
+}
+
+CL_LAMBDA(errno);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return the system's description of the error number ERRNO.)dx");
+DOCGROUP(clasp);
+CL_DEFUN SimpleBaseString_sp core__strerror(int errnum) {
+  return SimpleBaseString_O::make(strerror(errnum));
+}
+
+CL_LAMBDA(fd buffer start end offset);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Read into BUFFER[START, END) from FD at file position OFFSET, without moving
+the file pointer. Return the number of octets read and NIL, or NIL and the errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv core__io_pread(int fd, Array_sp buffer, size_t start, size_t end, size_t offset) {
+  unsigned char* data = octet_buffer_address(buffer, start, end);
+  ssize_t count;
+  do {
+    count = pread(fd, data, end - start, (off_t)offset);
+  } while (count < 0 && errno == EINTR);
+  if (count < 0)
+    return Values(nil<T_O>(), make_fixnum(errno));
+  return Values(make_fixnum(count), nil<T_O>());
+}
+
+CL_LAMBDA(fd buffer start end offset);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Write BUFFER[START, END) to FD at file position OFFSET, without moving the
+file pointer. Return the number of octets written and NIL, or NIL and the errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv core__io_pwrite(int fd, Array_sp buffer, size_t start, size_t end, size_t offset) {
+  unsigned char* data = octet_buffer_address(buffer, start, end);
+  ssize_t count;
+  do {
+    count = pwrite(fd, data, end - start, (off_t)offset);
+  } while (count < 0 && errno == EINTR);
+  if (count < 0)
+    return Values(nil<T_O>(), make_fixnum(errno));
+  return Values(make_fixnum(count), nil<T_O>());
+}
+
+#ifdef CLASP_IO_URING
+
+#define IO_RING_OP_READ 0
+#define IO_RING_OP_WRITE 1
+
+struct IoRing {
+  int fd;
+  void* sq_map;
+  size_t sq_map_size;
+  void* cq_map;
+  size_t cq_map_size;
+  struct io_uring_sqe* sqes;
+  size_t sqes_size;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_cqe* cqes;
+  unsigned sq_entries;
+  // Entries filled in since the last submit.
+  unsigned pending;
+  bool buffers_registered;
+  // The iovec of each READV/WRITEV in flight, by user data. Kernels before
+  // 5.5 may read it again after submission, when the operation is handed to
+  // a worker, so it has to live until the completion is reaped. Elements of
+  // an unordered_map don't move when it grows.
+  std::mutex iovecs_lock;
+  std::unordered_map<uint64_t, struct iovec> iovecs;
+};
+
+static IoRing* io_ring(clasp_ffi::ForeignData_sp ring) {
+  IoRing* r = ring->data<IoRing*>();
+  if (r->fd < 0)
+    SIMPLE_ERROR("The io_uring {} has been closed", _rep_(ring));
+  return r;
+}
+
+static void io_ring_unmap(IoRing* r) {
+  if (r->sqes && r->sqes != MAP_FAILED)
+    munmap(r->sqes, r->sqes_size);
+  if (r->cq_map && r->cq_map != MAP_FAILED && r->cq_map != r->sq_map)
+    munmap(r->cq_map, r->cq_map_size);
+  if (r->sq_map && r->sq_map != MAP_FAILED)
+    munmap(r->sq_map, r->sq_map_size);
+  close(r->fd);
+}
+
+CL_LAMBDA(entries);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Create an io_uring with room for ENTRIES submissions. Return it, or NIL
+and the errno if the kernel does not provide io_uring.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv core__io_ring_create(size_t entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = syscall(__NR_io_uring_setup, (unsigned)entries, &params);
+  if (fd < 0)
+    return Values(nil<T_O>(), make_fixnum(errno));
+  IoRing* r = new IoRing();
+  r->fd = fd;
+  r->sq_entries = params.sq_entries;
+  r->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  r->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#else
+  bool single_mmap = false; // headers older than 5.4
+#endif
+  if (single_mmap)
+    r->sq_map_size = r->cq_map_size = std::max(r->sq_map_size, r->cq_map_size);
+  r->sq_map = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (r->sq_map != MAP_FAILED) {
+    r->cq_map = single_mmap
+                    ? r->sq_map
+                    : mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    r->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                         IORING_OFF_SQES);
+  }
+  if (r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED || r->sqes == MAP_FAILED) {
+    int err = errno;
+    io_ring_unmap(r);
+    delete r;
+    return Values(nil<T_O>(), make_fixnum(err));
+  }
+  char* sq = (char*)r->sq_map;
+  char* cq = (char*)r->cq_map;
+  r->sq_head = (unsigned*)(sq + params.sq_off.head);
+  r->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  r->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+  r->sq_array = (unsigned*)(sq + params.sq_off.array);
+  r->cq_head = (unsigned*)(cq + params.cq_off.head);
+  r->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+  r->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  return Values(clasp_ffi::ForeignData_O::create((void*)r), nil<T_O>());
+}
+
+CL_LAMBDA(ring);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Close RING. Operations still in flight are cancelled by the kernel.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void core__io_ring_close(clasp_ffi::ForeignData_sp ring) {
+  IoRing* r = io_ring(ring);
+  io_ring_unmap(r);
+  // Keep the (small) IoRing so that later use of RING is caught.
+  r->fd = -1;
+}
+
+CL_LAMBDA(ring opcode fd buffer start end offset user-data buffer-index);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Fill in a submission entry on RING without submitting it.)dx");
+CL_DOCSTRING_LONG(R"dx(OPCODE is 0 to read into BUFFER[START, END) from FD at OFFSET, or 1 to
+write it. USER-DATA is a fixnum returned with the completion. BUFFER-INDEX,
+if not NIL, is the index of BUFFER among the registered buffers. Return
+NIL if the submission queue is full. The caller must serialize this with
+other submissions on the same ring and keep BUFFER alive and in place
+until it completes.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__io_ring_prepare(clasp_ffi::ForeignData_sp ring, int opcode, int fd, Array_sp buffer, size_t start, size_t end,
+                                    size_t offset, Fixnum user_data, T_sp buffer_index) {
+  IoRing* r = io_ring(ring);
+  unsigned tail = *r->sq_tail;
+  if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries)
+    return false;
+  unsigned index = tail & *r->sq_mask;
+  struct io_uring_sqe* sqe = &r->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uint64_t)user_data;
+  unsigned char* data = octet_buffer_address(buffer, start, end);
+  bool fixed = buffer_index.fixnump();
+  if (opcode == IO_RING_OP_READ)
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READV;
+  else if (opcode == IO_RING_OP_WRITE)
+    sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITEV;
+  else
+    SIMPLE_ERROR("Unknown io_uring opcode {}", opcode);
+  sqe->fd = fd;
+  sqe->off = (uint64_t)offset;
+  if (fixed) {
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = (unsigned)(end - start);
+    sqe->buf_index = (uint16_t)buffer_index.unsafe_fixnum();
+  } else {
+    struct iovec* iov;
+    {
+      std::lock_guard<std::mutex> guard(r->iovecs_lock);
+      iov = &r->iovecs[(uint64_t)user_data];
+    }
+    iov->iov_base = data;
+    iov->iov_len = end - start;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = 1;
+  }
+  r->sq_array[index] = index;
+  __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  r->pending++;
+  return true;
+}
+
+CL_LAMBDA(ring);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Submit the entries prepared on RING in one system call. Return the number
+submitted and NIL, or NIL and the errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv core__io_ring_submit(clasp_ffi::ForeignData_sp ring) {
+  IoRing* r = io_ring(ring);
+  int submitted = 0;
+  while (r->pending > 0) {
+    int result = syscall(__NR_io_uring_enter, r->fd, r->pending, 0, 0, NULL, 0);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return Values(nil<T_O>(), make_fixnum(errno));
+    }
+    r->pending -= result;
+    submitted += result;
+  }
+  return Values(make_fixnum(submitted), nil<T_O>());
+}
+
+CL_LAMBDA(ring);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Wait until RING has at least one completion. Return NIL, or the errno if the
+wait failed or was interrupted.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__io_ring_wait(clasp_ffi::ForeignData_sp ring) {
+  IoRing* r = io_ring(ring);
+  if (__atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE) != *r->cq_head)
+    return nil<T_O>();
+  if (syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+    return make_fixnum(errno);
+  return nil<T_O>();
+}
+
+CL_LAMBDA(ring);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Consume RING's available completions and return them as a list of
+(USER-DATA . RESULT). RESULT is the octet count, or minus the errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN List_sp core__io_ring_completions(clasp_ffi::ForeignData_sp ring) {
+  IoRing* r = io_ring(ring);
+  ql::list completions;
+  unsigned head = *r->cq_head;
+  unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+  {
+    std::lock_guard<std::mutex> guard(r->iovecs_lock);
+    for (; head != tail; ++head) {
+      struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+      r->iovecs.erase(cqe->user_data);
+      completions << Cons_O::create(make_fixnum((Fixnum)cqe->user_data), make_fixnum(cqe->res));
+    }
+  }
+  __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+  return completions.cons();
+}
+
+CL_LAMBDA(ring buffers);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Register the octet vectors in the list BUFFERS with RING, replacing any
+registered before. Return NIL, or the errno.)dx");
+CL_DOCSTRING_LONG(R"dx(The kernel pins registered buffers once instead of on every operation.
+The vectors must not move while registered, so they should be static vectors.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__io_ring_register_buffers(clasp_ffi::ForeignData_sp ring, List_sp buffers) {
+  IoRing* r = io_ring(ring);
+  if (r->buffers_registered) {
+    syscall(__NR_io_uring_register, r->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    r->buffers_registered = false;
+  }
+  std::vector<struct iovec> iovecs;
+  for (auto cur : buffers) {
+    Array_sp buffer = gc::As<Array_sp>(CONS_CAR(cur));
+    size_t length = buffer->arrayTotalSize();
+    iovecs.push_back({octet_buffer_address(buffer, 0, length), length});
+  }
+  if (iovecs.empty())
+    return nil<T_O>();
+  if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, iovecs.data(), (unsigned)iovecs.size()) < 0)
+    return make_fixnum(errno);
+  r->buffers_registered = true;
+  return nil<T_O>();
+}
+
+#else // CLASP_IO_URING
+
+CL_LAMBDA(entries);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Create an io_uring. This system has none, so return NIL and ENOSYS.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv core__io_ring_create(size_t entries) {
+  return Values(nil<T_O>(), make_fixnum(ENOSYS));
+}
+
+#endif // CLASP_IO_URING
+
+}; // namespace core
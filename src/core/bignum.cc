@@ -33,7 +33,12 @@ THE SOFTWARE.
 #include <clasp/core/evaluator.h>
 #include <clasp/core/hashTable.h>
 #include <clasp/core/bignum.h>
+#include <clasp/core/array.h>
 #include <clasp/core/wrappers.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace core {
 
@@ -48,7 +53,7 @@ Bignum_sp Bignum_O::create(const mpz_class& c) {
   // copied from gmp docs
   size_t numb = 8*limbsize - nails;
   size_t count = (mpz_sizeinbase(c.get_mpz_t(), 2) + numb - 1) / numb;
-  mp_limb_t dest[count];
+  BignumScratch<mp_limb_t> dest(count);
   // These parameters are chosen in order to hopefully
   // just let GMP copy its limbs directly.
   mpz_export(dest, &count, -1, limbsize, 0, nails, c.get_mpz_t());
@@ -99,10 +104,10 @@ string Bignum_O::__repr__() const {
   mp_size_t len = this->length();
   mp_size_t size = std::abs(len);
   const mp_limb_t *limbs = this->limbs();
-  mp_limb_t copylimbs[size];
+  BignumScratch<mp_limb_t> copylimbs(size);
   for (mp_size_t i = 0; i < size; ++i) copylimbs[i] = limbs[i];
   size_t prestrsize = mpn_sizeinbase(limbs, size, 10);
-  unsigned char raw[prestrsize+1];
+  BignumScratch<unsigned char> raw(prestrsize+1);
   mp_size_t strsize = mpn_get_str(raw, 10, copylimbs, size);
   // Now write
   if (len < 0) ss << '-';
@@ -120,13 +125,13 @@ Bignum_sp Bignum_O::make(const string& str) {
     --strsize;
     cstr = &(cstr[1]);
   }
-  unsigned char s[strsize];
+  BignumScratch<unsigned char> s(strsize);
   for (size_t i = 0; i < strsize; ++i) s[i] = cstr[i] - '0';
   // Number of GMP limbs per decimal digit, approximately.
   // i.e. (/ (log 10 2) (log (expt 2 bits-per-limb) 2))
   double convert = log2(10) / mp_bits_per_limb;
   mp_size_t nlimbs = std::ceil(strsize*convert) + 2;
-  mp_limb_t limbs[nlimbs];
+  BignumScratch<mp_limb_t> limbs(nlimbs);
   nlimbs = mpn_set_str(limbs, s, strsize, 10);
   return Bignum_O::create_from_limbs(negative ? -nlimbs : nlimbs, 0, false,
                                             nlimbs, limbs);
@@ -190,7 +195,7 @@ gc::Fixnum Bignum_O::popcount() const {
     // (= (logcount x) (logcount (- (+ x 1)))) implies
     // (= (logcount (- y)) (logcount (- y 1))).
     mp_size_t size = -length;
-    mp_limb_t sublimbs[size];
+    BignumScratch<mp_limb_t> sublimbs(size);
     mpn_sub_1(sublimbs, limbs, size, (mp_limb_t)1); // sublimbs = (-this)-1
     // The most significant limb may be zero, but that won't affect
     // the popcount obviously. Borrow is zero since -this > 0.
@@ -209,7 +214,7 @@ gc::Fixnum Bignum_O::bit_length_() const {
     // facts that (integer-length (lognot x)) = (integer-length x)
     // and (lognot x) = (- (+ x 1)).
     mp_size_t size = -length;
-    mp_limb_t sublimbs[size];
+    BignumScratch<mp_limb_t> sublimbs(size);
     mpn_sub_1(sublimbs, limbs, size, (mp_limb_t)1);
     // mpn_sizeinbase does require the msl is not zero though.
     if (sublimbs[size-1] == 0) --size;
@@ -235,7 +240,7 @@ CL_DEFUN Integer_sp core__next_fmul(Bignum_sp left, Fixnum right) {
   mp_size_t size = std::abs(llen);
   const mp_limb_t *llimbs = left->limbs();
   mp_size_t result_len;
-  mp_limb_t result_limbs[size+1];
+  BignumScratch<mp_limb_t> result_limbs(size+1);
   mp_limb_t carry;
   // NOTE that std::abs will be undefined if the result isn't representable,
   // which will happen if right is INT_MIN or whatever. So this will break if
@@ -264,7 +269,7 @@ CL_DEFUN Bignum_sp core__next_lshift(Bignum_sp num, Fixnum shift) {
   unsigned int nlimbs = shift / mp_bits_per_limb;
   unsigned int nbits = shift % mp_bits_per_limb;
   size_t result_size = size + nlimbs + 1;
-  mp_limb_t result_limbs[result_size];
+  BignumScratch<mp_limb_t> result_limbs(result_size);
   mp_limb_t carry;
   // mpn shifts don't work when shift = 0, so we special case that.
   if (nbits == 0) {
@@ -295,8 +300,8 @@ CL_DEFUN Integer_sp core__next_rshift(Bignum_sp num, Fixnum shift) {
     // -(-x >> a) = -(~(x-1) >> a) = ~(~(x-1) >> a) + 1 = ((x-1) >> a) + 1 i think.
     if (nlimbs >= size) return clasp_make_fixnum(-1);
     mp_size_t result_size = size - nlimbs;
-    mp_limb_t result_limbs[result_size];
-    mp_limb_t copy[size];
+    BignumScratch<mp_limb_t> result_limbs(result_size);
+    BignumScratch<mp_limb_t> copy(size);
     mpn_sub_1(copy, limbs, size, 1);
     if (nbits == 0) {
       // FIXME: memcpy? std::copy?
@@ -312,7 +317,7 @@ CL_DEFUN Integer_sp core__next_rshift(Bignum_sp num, Fixnum shift) {
   } else {
     if (nlimbs >= size) return clasp_make_fixnum(0);
     size_t result_size = size - nlimbs;
-    mp_limb_t result_limbs[result_size];
+    BignumScratch<mp_limb_t> result_limbs(result_size);
     if (nbits == 0) {
       // FIXME: memcpy? std::copy?
       for (size_t i = 0; i < result_size; ++i) result_limbs[i] = limbs[nlimbs+i];
@@ -335,6 +340,113 @@ Integer_sp Bignum_O::shift_right(Fixnum shift) const {
   else return this->asSmartPtr();
 }
 
+// Products where both operands have at least this many limbs (about
+// 160000 decimal digits) are split across threads.
+#define BIGNUM_PARALLEL_MUL_LIMBS 8192
+
+// The most threads one product uses; 0 means one per hardware thread, up to 16.
+static std::atomic<size_t> global_bignum_mul_threads(0);
+
+static size_t bignum_mul_threads() {
+  size_t threads = global_bignum_mul_threads.load(std::memory_order_relaxed);
+  if (threads == 0)
+    threads = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), 16);
+  return threads;
+}
+
+CL_LAMBDA(threads);
+CL_DOCSTRING(R"dx(Set the most threads a product of two huge bignums may use, and return the
+previous setting. 1 multiplies on the calling thread only; 0 uses one
+thread per processor, up to 16.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t core__set_bignum_multiply_threads(size_t threads) {
+  return global_bignum_mul_threads.exchange(threads);
+}
+
+// Joins the threads however the scope is left, so that an exception
+// (std::bad_alloc, say) never destroys a joinable std::thread.
+struct JoinThreads {
+  std::vector<std::thread>& _Threads;
+  ~JoinThreads() {
+    for (auto& thread : _Threads)
+      if (thread.joinable())
+        thread.join();
+  }
+};
+
+/*! {rp, un+vn} = {up,un} * {vp,vn}, where un >= vn >= 1, using up to
+    NTHREADS threads. The split never adds much work over a serial mpn_mul:
+    - When U is at least twice as long as V, U is cut into pieces no
+      shorter than V, which is how GMP itself multiplies unbalanced
+      operands, and the pieces are multiplied by V in parallel.
+    - Otherwise one level of Karatsuba: with U = a1*B^h + a0 and
+      V = b1*B^h + b0, the three half size products a0*b0, a1*b1 and
+      (a0+a1)*(b0+b1) run in parallel, each recursively with a third of
+      the threads - about 1.5x the work of the whole product with FFT, in
+      a third of the time.
+    The operands must not be Lisp objects, which could move while the
+    workers run - the caller passes malloc'd copies. */
+static void parallel_mpn_mul(mp_limb_t* rp, const mp_limb_t* up, mp_size_t un,
+                             const mp_limb_t* vp, mp_size_t vn, size_t nthreads) {
+  if (nthreads < 2 || vn < BIGNUM_PARALLEL_MUL_LIMBS) {
+    mpn_mul(rp, up, un, vp, vn);
+    return;
+  }
+  mp_size_t h = (un + 1) / 2;
+  std::vector<std::thread> workers;
+  if (2 * vn <= un || vn <= h) {
+    mp_size_t piece = std::max<mp_size_t>(vn, (un + nthreads - 1) / nthreads);
+    std::vector<std::unique_ptr<mp_limb_t[]>> partials;
+    for (mp_size_t start = 0; start < un; start += piece)
+      partials.emplace_back(new mp_limb_t[std::min(piece, un - start) + vn]);
+    {
+      JoinThreads join{workers};
+      size_t index = 0;
+      for (mp_size_t start = 0; start < un; start += piece, ++index) {
+        mp_size_t n = std::min(piece, un - start);
+        mp_limb_t* pp = partials[index].get();
+        const mp_limb_t* upiece = up + start;
+        workers.emplace_back([pp, upiece, n, vp, vn]() {
+          if (n >= vn)
+            mpn_mul(pp, upiece, n, vp, vn);
+          else
+            mpn_mul(pp, vp, vn, upiece, n);
+        });
+      }
+    }
+    std::fill(rp, rp + un + vn, 0);
+    size_t index = 0;
+    for (mp_size_t start = 0; start < un; start += piece, ++index) {
+      mp_size_t n = std::min(piece, un - start);
+      // The sum is the full product, so nothing carries out of the top.
+      mpn_add(rp + start, rp + start, un + vn - start, partials[index].get(), n + vn);
+    }
+    return;
+  }
+  // Karatsuba. h >= un - h >= vn - h >= 1 here.
+  const mp_limb_t *a0 = up, *a1 = up + h, *b0 = vp, *b1 = vp + h;
+  mp_size_t la1 = un - h, lb1 = vn - h;
+  std::unique_ptr<mp_limb_t[]> sum_a(new mp_limb_t[h + 1]);
+  std::unique_ptr<mp_limb_t[]> sum_b(new mp_limb_t[h + 1]);
+  std::unique_ptr<mp_limb_t[]> middle(new mp_limb_t[2 * h + 2]);
+  sum_a[h] = mpn_add(sum_a.get(), a0, h, a1, la1);
+  sum_b[h] = mpn_add(sum_b.get(), b0, h, b1, lb1);
+  size_t share = std::max<size_t>(1, nthreads / 3);
+  {
+    JoinThreads join{workers};
+    // a0*b0 goes to the low 2h limbs of the result and a1*b1 to the rest.
+    workers.emplace_back([=]() { parallel_mpn_mul(rp, a0, h, b0, h, share); });
+    workers.emplace_back([=]() { parallel_mpn_mul(rp + 2 * h, a1, la1, b1, lb1, share); });
+    parallel_mpn_mul(middle.get(), sum_a.get(), h + 1, sum_b.get(), h + 1, share);
+  }
+  // middle = (a0+a1)(b0+b1) - a0*b0 - a1*b1 = a0*b1 + a1*b0, which is less
+  // than B^(un+vn-h), so its limbs above that are zero.
+  mpn_sub(middle.get(), middle.get(), 2 * h + 2, rp, 2 * h);
+  mpn_sub(middle.get(), middle.get(), 2 * h + 2, rp + 2 * h, un + vn - 2 * h);
+  mp_size_t middle_size = std::min<mp_size_t>(2 * h + 2, un + vn - h);
+  mpn_add(rp + h, rp + h, un + vn - h, middle.get(), middle_size);
+}
+
 DOCGROUP(clasp);
 CL_DEFUN Bignum_sp core__next_mul(Bignum_sp left, Bignum_sp right) {
   // NOTE: The mpz_ functions detect when left = right (analogously) and use
@@ -343,10 +455,23 @@ CL_DEFUN Bignum_sp core__next_mul(Bignum_sp left, Bignum_sp right) {
   mp_size_t lsize = std::abs(llen), rsize = std::abs(rlen);
   const mp_limb_t *llimbs = left->limbs(), *rlimbs = right->limbs();
   mp_size_t result_size = lsize + rsize;
-  mp_limb_t result_limbs[result_size];
+  BignumScratch<mp_limb_t> result_limbs(result_size);
   mp_limb_t msl;
+  size_t nthreads = bignum_mul_threads();
+  // A square stays serial, where mpn_mul recognizes it and uses mpn_sqr.
+  if (nthreads > 1 && llimbs != rlimbs && std::min(lsize, rsize) >= BIGNUM_PARALLEL_MUL_LIMBS) {
+    // The workers get copies, since a collection may move the bignums.
+    std::unique_ptr<mp_limb_t[]> lcopy(new mp_limb_t[lsize]);
+    std::unique_ptr<mp_limb_t[]> rcopy(new mp_limb_t[rsize]);
+    std::copy(llimbs, llimbs + lsize, lcopy.get());
+    std::copy(rlimbs, rlimbs + rsize, rcopy.get());
+    if (rsize > lsize)
+      parallel_mpn_mul(result_limbs, rcopy.get(), rsize, lcopy.get(), lsize, nthreads);
+    else parallel_mpn_mul(result_limbs, lcopy.get(), lsize, rcopy.get(), rsize, nthreads);
+    msl = result_limbs[result_size - 1];
+  }
   // "This function requires that s1n is greater than or equal to s2n."
-  if (rsize > lsize)
+  else if (rsize > lsize)
     msl = mpn_mul(result_limbs, rlimbs, rsize, llimbs, lsize);
   else msl = mpn_mul(result_limbs, llimbs, lsize, rlimbs, rsize);
   if (msl == 0) --result_size;
@@ -395,8 +520,8 @@ CL_DEFUN T_mv core__next_truncate(Bignum_sp dividend,
   const mp_limb_t *divisor_limbs = divisor->limbs();
   mp_size_t quotient_size = dividend_size - divisor_size + 1;
   mp_size_t remainder_size = divisor_size;
-  mp_limb_t quotient_limbs[quotient_size];
-  mp_limb_t remainder_limbs[remainder_size];
+  BignumScratch<mp_limb_t> quotient_limbs(quotient_size);
+  BignumScratch<mp_limb_t> remainder_limbs(remainder_size);
   mpn_tdiv_qr(quotient_limbs, remainder_limbs, 0L,
               dividend_limbs, dividend_size,
               divisor_limbs, divisor_size);
@@ -427,7 +552,7 @@ CL_DEFUN T_mv core__next_ftruncate(Bignum_sp dividend,
   mp_size_t size = std::abs(len);
   const mp_limb_t* limbs = dividend->limbs();
   mp_size_t quotient_size = size;
-  mp_limb_t quotient_limbs[quotient_size];
+  BignumScratch<mp_limb_t> quotient_limbs(quotient_size);
   // GMP docs don't mark the third argument const but it seems to be.
   mp_limb_t remainder = mpn_divrem_1(quotient_limbs, (mp_size_t)0,
                                      limbs, size, positive_divisor);
@@ -473,7 +598,7 @@ Integer_sp next_gcd(const mp_limb_t* llimbs, mp_size_t lsize,
   }
   // NOTE: We assume mp_limb_t = long long. Unfortunate.
   n_left_zero_bits = __builtin_ctzll(llimbs[0]);
-  mp_limb_t llimbs_copy[lsize];
+  BignumScratch<mp_limb_t> llimbs_copy(lsize);
   if (n_left_zero_bits == 0) {
     // FIXME: Could memcpy/whatever.
     for (mp_size_t i = 0; i < lsize; ++i) llimbs_copy[i] = llimbs[i];
@@ -489,7 +614,7 @@ Integer_sp next_gcd(const mp_limb_t* llimbs, mp_size_t lsize,
     ++rlimbs;
   }
   n_right_zero_bits = __builtin_ctzll(rlimbs[0]);
-  mp_limb_t rlimbs_copy[rsize];
+  BignumScratch<mp_limb_t> rlimbs_copy(rsize);
   if (n_right_zero_bits == 0) {
     for (mp_size_t i = 0; i < rsize; ++i) rlimbs_copy[i] = rlimbs[i];
   } else {
@@ -529,7 +654,7 @@ Integer_sp next_gcd(const mp_limb_t* llimbs, mp_size_t lsize,
   // Now we need to shift the shared bits back in to the result
   // and otherwise construct it.
   mp_limb_t result_size = gcd_size + n_result_zero_limbs;
-  mp_limb_t result_limbs[result_size+1]; // +1 for space to shift into.
+  BignumScratch<mp_limb_t> result_limbs(result_size+1); // +1 for space to shift into.
   for (mp_size_t i = 0; i < n_result_zero_limbs; ++i)
     result_limbs[i] = 0;
   if (n_result_zero_bits == 0) {
@@ -556,6 +681,19 @@ CL_DEFUN Integer_sp core__next_gcd(Bignum_sp left, Bignum_sp right) {
                   right->limbs(), std::abs(right->length()));
 }
 
+CL_LAMBDA(bignum);
+CL_DOCSTRING(R"dx(Return the integer square root of a positive bignum, computed with mpn_sqrtrem.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Integer_sp core__next_isqrt(Bignum_sp num) {
+  mp_size_t len = num->length();
+  if (len < 0) TYPE_ERROR(num, cl::_sym_UnsignedByte);
+  mp_size_t root_size = (len + 1) / 2;
+  BignumScratch<mp_limb_t> root_limbs(root_size);
+  // NULL remainder pointer: only the root is wanted
+  mpn_sqrtrem(root_limbs, NULL, num->limbs(), len);
+  return bignum_result(root_size, root_limbs);
+}
+
 DOCGROUP(clasp);
 CL_DEFUN Integer_sp core__next_fgcd(Bignum_sp big, Fixnum small) {
   if (small == 0) return big;
@@ -578,7 +716,7 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
     Fixnum result_sign = ((len < 0) ^ (fdivisor < 0)) ? -1 : 1;
     Fixnum adivisor = std::abs(fdivisor);
     mp_limb_t gcd = mpn_gcd_1(limbs, size, adivisor);
-    mp_limb_t num[size];
+    BignumScratch<mp_limb_t> num(size);
     mpn_divexact_1(num, limbs, size, gcd);
     // quick normalize
     mp_limb_t num_length;
@@ -620,7 +758,7 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
       // Nope, have to do some divisions.
       // Compute the numerator
       mp_limb_t numsize = size;
-      mp_limb_t numlimbs[numsize];
+      BignumScratch<mp_limb_t> numlimbs(numsize);
       mpn_divexact_1(numlimbs, limbs, size, fgcd);
       if (numlimbs[numsize-1] == 0) --numsize;
       Integer_sp numerator = bignum_result(result_sign * numsize,
@@ -628,7 +766,7 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
 
       // Compute the denominator
       mp_limb_t densize = divsize;
-      mp_limb_t denlimbs[densize];
+      BignumScratch<mp_limb_t> denlimbs(densize);
       mpn_divexact_1(denlimbs, divlimbs, divsize, fgcd);
       if (denlimbs[densize-1] == 0) --densize;
       // If the denominator is 1, return the numerator
@@ -651,11 +789,11 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
       mp_size_t gcd_size = bgcd->length(); // necessarily positive
       const mp_limb_t* gcd_limbs = bgcd->limbs();
       
-      mp_limb_t remainder_limbs[gcd_size];
+      BignumScratch<mp_limb_t> remainder_limbs(gcd_size);
 
       // Compute the numerator
       mp_size_t numsize = size - gcd_size + 1;
-      mp_limb_t numlimbs[numsize];
+      BignumScratch<mp_limb_t> numlimbs(numsize);
       mpn_tdiv_qr(numlimbs, remainder_limbs, (mp_size_t)0,
                   limbs, size, gcd_limbs, gcd_size);
       // Numerator MSL may be zero
@@ -664,7 +802,7 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
 
       // Compute the denominator
       mp_size_t densize = divsize - gcd_size + 1;
-      mp_limb_t denlimbs[densize];
+      BignumScratch<mp_limb_t> denlimbs(densize);
       mpn_tdiv_qr(denlimbs, remainder_limbs, (mp_size_t)0,
                   divlimbs, divsize, gcd_limbs, gcd_size);
       // Denominator MSL may be zero
@@ -694,7 +832,7 @@ Integer_sp next_add(const mp_limb_t *llimbs, mp_size_t llen,
   }
 
   mp_size_t result_len;
-  mp_limb_t result_limbs[1+absllen];
+  BignumScratch<mp_limb_t> result_limbs(1+absllen);
   
   if ((llen ^ rlen) < 0) {
     // the lengths (and therefore the numbers) have different sign.
@@ -749,7 +887,7 @@ Integer_sp next_fadd(const mp_limb_t* limbs, mp_size_t len,
   mp_size_t size = std::abs(len);
 
   mp_size_t result_len = size;
-  mp_limb_t result_limbs[size+1];
+  BignumScratch<mp_limb_t> result_limbs(size+1);
 
   if ((len < 0) ^ (right < 0)) {
     // Different signs - subtract
@@ -22,6 +22,10 @@
            #~"bytecode.cc"
            #~"bytecode_compiler.cc"
            #~"loadltv.cc"
+           #~"serializeObject.cc"
+           #~"asyncIO.cc"
+           #~"vectorSort.cc"
+           #~"numericVector.cc"
            #~"debug_unixes.cc"
            #~"debug_macosx.cc"
            #~"smallMap.cc"
@@ -76,6 +76,7 @@ THE SOFTWARE.
 #include <type_traits>
 #include <cstdint>
 #include <algorithm>
+#include <cstring>
 
 #include <dlfcn.h>
 #include <arpa/inet.h> // for htonl
@@ -665,6 +666,73 @@ core::T_sp PERCENTnull_pointer_p( core::T_sp obj )
   TYPE_ERROR( obj, ForeignData_O::static_classSymbol() );
 }
 
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+// Returns the address of element START of ARRAY and sets NBYTES to the size
+// of the elements START below END. Only arrays whose elements are stored
+// unboxed in whole bytes can be copied to foreign memory.
+static void * array_element_bytes( core::Array_sp array, size_t start, size_t end, size_t & nbytes )
+{
+  if ( array->element_type() == cl::_sym_T_O )
+  {
+    SIMPLE_ERROR("Cannot copy the elements of {} to or from foreign memory - it is not specialized", _rep_(array));
+  }
+  if ( start > end || end > array->arrayTotalSize() )
+  {
+    SIMPLE_ERROR("Invalid range [{}, {}) for {}", start, end, _rep_(array));
+  }
+  nbytes = ( end - start ) * array->elementSizeInBytes();
+  return array->rowMajorAddressOfElement_( start );
+}
+
+// Signals an error if NBYTES at OFFSET run past the end of DATA. Foreign data
+// of unknown size, such as a pointer returned by C code, has a size of 0 and
+// is not checked.
+static void check_foreign_range( ForeignData_sp data, size_t offset, size_t nbytes )
+{
+  size_t size = data->foreign_data_size();
+  if ( size > 0 && ( offset > size || nbytes > size - offset ) )
+  {
+    SIMPLE_ERROR("Copying {} bytes at offset {} overruns the {} bytes of {}", nbytes, offset, size, _rep_(data));
+  }
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+ForeignData_sp PERCENTcopy_to_foreign( core::Array_sp source, size_t start, size_t end, ForeignData_sp dest, size_t offset )
+{
+  size_t nbytes;
+  void * p_source = array_element_bytes( source, start, end, nbytes );
+  if ( dest->null_pointer_p() )
+  {
+    SIMPLE_ERROR("Cannot copy to a null foreign pointer");
+  }
+  check_foreign_range( dest, offset, nbytes );
+  if ( nbytes > 0 )
+  {
+    memcpy( (char *) dest->raw_data() + offset, p_source, nbytes );
+  }
+  return dest;
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+core::Array_sp PERCENTcopy_from_foreign( ForeignData_sp source, size_t offset, core::Array_sp dest, size_t start, size_t end )
+{
+  size_t nbytes;
+  void * p_dest = array_element_bytes( dest, start, end, nbytes );
+  if ( source->null_pointer_p() )
+  {
+    SIMPLE_ERROR("Cannot copy from a null foreign pointer");
+  }
+  check_foreign_range( source, offset, nbytes );
+  if ( nbytes > 0 )
+  {
+    memcpy( p_dest, (char *) source->raw_data() + offset, nbytes );
+  }
+  return dest;
+}
+
 // ---------------------------------------------------------------------------
 // ---------------------------------------------------------------------------
 ForeignData_sp ForeignData_O::PERCENTinc_pointer_in_place( core::Integer_sp offset )
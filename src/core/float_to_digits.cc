@@ -37,6 +37,7 @@ THE SOFTWARE.
     See file '../../Copyright' for full details.
 */
 
+#include <charconv>
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/numbers.h>
@@ -45,8 +46,15 @@ THE SOFTWARE.
 #include <clasp/core/symbolTable.h>
 #include <clasp/core/array.h>
 #include <clasp/core/bignum.h>
+#include <clasp/core/float_to_digits.h>
 #include <clasp/core/wrappers.h>
 
+// libstdc++ and libc++ only define __cpp_lib_to_chars once floating point
+// to_chars (which is Ryu underneath) is available.
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+#define CLASP_SHORTEST_FLOAT_DIGITS 1
+#endif
+
 namespace core {
 
 #define PRINT_BASE clasp_make_fixnum(10)
@@ -229,6 +237,69 @@ change_precision(float_approx *approx, T_sp tposition, T_sp relativep) {
   }
 }
 
+/*! Shortest round trip digits of the finite, positive X.
+    std::to_chars in scientific format with no precision gives the shortest
+    digit string that reads back as X, ties broken towards the closest value,
+    which is the same free format output that Steele-White produces. */
+template <typename Float>
+static size_t shortest_digits(Float x, char *digits, gc::Fixnum &k) {
+#ifdef CLASP_SHORTEST_FLOAT_DIGITS
+  char buf[CLASP_FLOAT_DIGITS_MAX];
+  auto res = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::scientific);
+  if (res.ec != std::errc())
+    return 0;
+  // buf holds d[.ddd]e[+-]xx
+  size_t ndigits = 0;
+  const char *cur = buf;
+  for (; cur < res.ptr && *cur != 'e'; ++cur) {
+    if (*cur != '.')
+      digits[ndigits++] = *cur;
+  }
+  if (cur == res.ptr)
+    return 0;
+  ++cur;
+  if (*cur == '+')
+    ++cur; // from_chars does not accept a leading plus sign
+  int exponent;
+  if (std::from_chars(cur, res.ptr, exponent).ec != std::errc())
+    return 0;
+  k = exponent + 1;
+  return ndigits;
+#else
+  return 0;
+#endif
+}
+
+size_t clasp_float_shortest_digits(Float_sp number, char *digits, gc::Fixnum &k) {
+  switch (clasp_t_of(number)) {
+  case number_SingleFloat: {
+    float f = std::fabs(unbox_single_float(gc::As_unsafe<SingleFloat_sp>(number)));
+    if (!std::isfinite(f))
+      return 0;
+    if (f == 0.0f) {
+      // Same result as the Dragon4 loop below
+      digits[0] = '0';
+      k = 0;
+      return 1;
+    }
+    return shortest_digits(f, digits, k);
+  }
+  case number_DoubleFloat: {
+    double d = std::fabs(gc::As_unsafe<DoubleFloat_sp>(number)->get());
+    if (!std::isfinite(d))
+      return 0;
+    if (d == 0.0) {
+      digits[0] = '0';
+      k = 0;
+      return 1;
+    }
+    return shortest_digits(d, digits, k);
+  }
+  default:
+    return 0;
+  }
+}
+
 CL_LAMBDA(digits number position relativep);
 CL_DECLARE();
 CL_DOCSTRING(R"dx(float_to_digits)dx");
@@ -236,10 +307,6 @@ DOCGROUP(clasp);
 CL_DEFUN T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position, T_sp relativep) {
   ASSERT(tdigits.nilp()||gc::IsA<Str8Ns_sp>(tdigits));
   gctools::Fixnum k;
-  float_approx approx[1];
-  setup(number, approx);
-  change_precision(approx, position, relativep);
-  k = scale(approx);
   StrNs_sp digits;
   if (tdigits.nilp()) {
     digits = gc::As<StrNs_sp>(core__make_vector(cl::_sym_base_char,
@@ -249,6 +316,21 @@ CL_DEFUN T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position
   } else {
     digits = gc::As<StrNs_sp>(tdigits);
   }
+  // Free format output has a fixed cost path; a requested position needs the
+  // exact rounding that only the bignum arithmetic below provides.
+  if (position.nilp()) {
+    char shortest[CLASP_FLOAT_DIGITS_MAX];
+    size_t ndigits = clasp_float_shortest_digits(number, shortest, k);
+    if (ndigits) {
+      for (size_t i = 0; i < ndigits; ++i)
+        digits->vectorPushExtend(clasp_make_character(shortest[i]));
+      return Values(clasp_make_fixnum(k), digits);
+    }
+  }
+  float_approx approx[1];
+  setup(number, approx);
+  change_precision(approx, position, relativep);
+  k = scale(approx);
   generate(digits, approx);
   return Values(clasp_make_fixnum(k), digits);
 }
@@ -12,6 +12,7 @@
 
 #define ECL_INCLUDE_MATH_H
 #include <float.h>
+#include <charconv>
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/character.h>
@@ -58,32 +59,31 @@ insert_char(StrNs_sp buffer, cl_index where, gc::Fixnum c) {
      * FREE FORMAT (FIXED OR EXPONENT) OF FLOATS
      */
 
-static void
-print_float_exponent(T_sp buffer, T_sp number, gc::Fixnum exp) {
+static gc::Fixnum
+float_exponent_marker(Float_sp number) {
   T_sp r = cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue();
-  gc::Fixnum e;
-  switch (clasp_t_of(gc::As<Number_sp>(number))) {
+  switch (clasp_t_of(number)) {
   case number_SingleFloat:
-    e = (r == cl::_sym_single_float || r == cl::_sym_ShortFloat_O) ? 'e' : 'f';
-    break;
+    return (r == cl::_sym_single_float || r == cl::_sym_ShortFloat_O) ? 'e' : 'f';
   case number_ShortFloat:
-    e = (r == cl::_sym_single_float || r == cl::_sym_ShortFloat_O) ? 'e' : 'f';
-    break;
+    return (r == cl::_sym_single_float || r == cl::_sym_ShortFloat_O) ? 'e' : 'f';
 #ifdef ECL_LONG_FLOAT
   case number_LongFloat:
-    e = (r == @'long-float') ? 'e' : 'l';
-    break;
+    return (r == @'long-float') ? 'e' : 'l';
   case number_DoubleFloat:
-    e = (r == @'double-float') ? 'e' : 'd';
-    break;
+    return (r == @'double-float') ? 'e' : 'd';
 #else
   case number_DoubleFloat:
-    e = (r == cl::_sym_DoubleFloat_O || r == cl::_sym_LongFloat_O) ? 'e' : 'd';
-    break;
+    return (r == cl::_sym_DoubleFloat_O || r == cl::_sym_LongFloat_O) ? 'e' : 'd';
 #endif
   default:
-                  SIMPLE_ERROR("Handle additional enumeration values value={} t_of={}", _rep_(number).c_str() , clasp_t_of(gc::As<Number_sp>(number)));
+                  SIMPLE_ERROR("Handle additional enumeration values value={} t_of={}", _rep_(number).c_str() , clasp_t_of(number));
   }
+}
+
+static void
+print_float_exponent(T_sp buffer, T_sp number, gc::Fixnum exp) {
+  gc::Fixnum e = float_exponent_marker(gc::As<Float_sp>(number));
   if (e != 'e' || exp != 0) {
     StrNs_sp sbuffer = gc::As<StrNs_sp>(buffer);
     sbuffer->vectorPushExtend(clasp_make_character(e));
@@ -92,6 +92,55 @@ print_float_exponent(T_sp buffer, T_sp number, gc::Fixnum exp) {
   }
 }
 
+/*! The layout of core_float_to_string_free, done in OUT from the shortest
+    digits without consing.  Returns the length written, or 0 if NUMBER has to
+    go through core_float_to_string_free (NaNs, infinities, long floats, or
+    output that would not fit in SIZE characters). */
+size_t
+clasp_float_to_string_free(char *out, size_t size, Float_sp number, gc::Fixnum e_min, gc::Fixnum e_max) {
+  char digits[CLASP_FLOAT_DIGITS_MAX];
+  gc::Fixnum k;
+  size_t ndigits = clasp_float_shortest_digits(number, digits, k);
+  if (ndigits == 0)
+    return 0;
+  // sign, "0.", padding zeros, digits, marker and exponent
+  gc::Fixnum padding = (k < 0) ? -k : k;
+  if ((size_t)padding + ndigits + 32 > size)
+    return 0;
+  gc::Fixnum marker = float_exponent_marker(number);
+  gc::Fixnum exp = 0;
+  char *cur = out;
+  if (clasp_signbit(number))
+    *cur++ = '-';
+  if (k <= e_min || e_max <= k) {
+    *cur++ = digits[0];
+    *cur++ = '.';
+    memcpy(cur, digits + 1, ndigits - 1);
+    cur += ndigits - 1;
+    exp = k - 1;
+  } else if (k > 0) {
+    // Digits padded with zeros to at least k+1 places, point after the k'th
+    gc::Fixnum len = std::max((gc::Fixnum)ndigits, k + 1);
+    for (gc::Fixnum i = 0; i < len; ++i) {
+      if (i == k)
+        *cur++ = '.';
+      *cur++ = (i < (gc::Fixnum)ndigits) ? digits[i] : '0';
+    }
+  } else {
+    *cur++ = '0';
+    *cur++ = '.';
+    for (gc::Fixnum e = -k; e; e--)
+      *cur++ = '0';
+    memcpy(cur, digits, ndigits);
+    cur += ndigits;
+  }
+  if (marker != 'e' || exp != 0) {
+    *cur++ = marker;
+    cur = std::to_chars(cur, out + size, exp).ptr;
+  }
+  return cur - out;
+}
+
 T_sp core_float_to_string_free(Float_sp number, Number_sp e_min, Number_sp e_max) {
   gc::Fixnum base = 0, e;
   if (clasp_float_nan_p(number)) {
@@ -99,6 +148,16 @@ T_sp core_float_to_string_free(Float_sp number, Number_sp e_min, Number_sp e_max
   } else if (clasp_float_infinity_p(number)) {
     return eval::funcall(ext::_sym_float_infinity_string, number);
   }
+  if (e_min.fixnump() && e_max.fixnump()) {
+    char text[128];
+    size_t len = clasp_float_to_string_free(text, sizeof(text), number,
+                                            e_min.unsafe_fixnum(), e_max.unsafe_fixnum());
+    if (len) {
+      Str8Ns_sp result = Str8Ns_O::make(len, ' ', true, clasp_make_fixnum(len));
+      memcpy(&(*result)[0], text, len);
+      return result;
+    }
+  }
   T_mv mv_exp = core__float_to_digits(nil<T_O>(), number, nil<T_O>(), nil<T_O>());
   Fixnum_sp exp = gc::As_unsafe<Fixnum_sp>(mv_exp);
   MultipleValues& mv = core::lisp_multipleValues();
@@ -26,6 +26,7 @@ THE SOFTWARE.
 /* -^- */
 #include <clasp/core/foundation.h>
 #include <clasp/core/hwinfo.h>
+#include <clasp/core/ql.h>
 #include <clasp/core/wrappers.h>
 
 #if defined( _WIN32 ) || defined( _TARGET_OS_WIN )
@@ -62,4 +63,38 @@ CL_DEFUN T_sp core__num_logical_processors() {
 #endif
 };
 
+static CpuFeatures detect_cpu_features() {
+  CpuFeatures features;
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+  __builtin_cpu_init();
+  features.popcnt = __builtin_cpu_supports("popcnt");
+  features.avx2 = __builtin_cpu_supports("avx2");
+  features.fma = __builtin_cpu_supports("fma");
+  features.avx512f = __builtin_cpu_supports("avx512f");
+  features.avx512bw = __builtin_cpu_supports("avx512bw");
+  features.avx512vpopcntdq = __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+  return features;
+}
+
+const CpuFeatures& cpu_features() {
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
+
+CL_DOCSTRING(R"dx(Returns a list of keywords naming the instruction set extensions that
+the runtime detected on this processor and may use for specialized kernels.)dx");
+DOCGROUP(clasp);
+CL_DEFUN List_sp core__cpu_features() {
+  const CpuFeatures& features = cpu_features();
+  ql::list result;
+  if (features.popcnt) result << INTERN_(kw, popcnt);
+  if (features.avx2) result << INTERN_(kw, avx2);
+  if (features.fma) result << INTERN_(kw, fma);
+  if (features.avx512f) result << INTERN_(kw, avx512f);
+  if (features.avx512bw) result << INTERN_(kw, avx512bw);
+  if (features.avx512vpopcntdq) result << INTERN_(kw, avx512vpopcntdq);
+  return result.cons();
+}
+
 } // namespace
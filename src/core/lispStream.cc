@@ -1596,6 +1596,28 @@ static claspCharacter str_out_write_char(T_sp strm, claspCharacter c) {
   return c;
 }
 
+/*! Append a run of characters with at most one resize, instead of a
+    vectorPushExtend per character. */
+static void str_out_write_characters(T_sp strm, const char *buf, cl_index n) {
+  String_sp string = StringOutputStreamOutputString(strm);
+  Str8Ns_sp string8 = string.asOrNull<Str8Ns_O>();
+  if (!string8) {
+    for (cl_index i = 0; i < n; ++i)
+      str_out_write_char(strm, buf[i]);
+    return;
+  }
+  cl_index fillp = string8->fillPointer();
+  // Grow geometrically, as vectorPushExtend does, so that many short
+  // writes still cost amortized constant time per character.
+  if (fillp + n > string8->arrayTotalSize())
+    string8->ensureSpaceAfterFillPointer(clasp_make_character('\0'),
+                                         n + calculate_extension(string8->arrayTotalSize()));
+  memcpy(&(*string8)[fillp], buf, n);
+  string8->fillPointerSet(fillp + n);
+  for (cl_index i = 0; i < n; ++i)
+    write_char_increment_column(strm, buf[i]);
+}
+
 static T_sp str_out_element_type(T_sp strm) {
   T_sp tstring = StringOutputStreamOutputString(strm);
   ASSERT(cl__stringp(tstring));
@@ -5365,6 +5387,10 @@ namespace core {
 void clasp_write_characters(const char *buf, int sz, T_sp strm) {
   claspCharacter (*write_char)(T_sp, claspCharacter);
   write_char = stream_dispatch_table(strm).write_char;
+  if (write_char == str_out_write_char) {
+    str_out_write_characters(strm, buf, sz);
+    return;
+  }
   for (int i(0); i < sz; ++i) {
     write_char(strm, buf[i]);
   }
@@ -27,6 +27,14 @@ THE SOFTWARE.
 
 #include <sched.h>
 #include <sys/types.h>
+#include <chrono>
+#include <climits>
+#include <vector>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/lisp.h>
@@ -43,6 +51,7 @@ THE SOFTWARE.
 #include <clasp/gctools/interrupt.h>
 #include <clasp/core/evaluator.h>
 #include <clasp/core/unwind.h>
+#include <clasp/core/array.h>
 
 
 extern "C" {
@@ -819,5 +828,545 @@ CL_DEFUN void mp__fence(core::T_sp order) {
   std::atomic_thread_fence(std::memory_order_seq_cst);
 }
 
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, double timeout) {
+#ifdef __linux__
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+  struct timespec ts;
+  struct timespec* tsp = NULL;
+  if (timeout >= 0.0) {
+    ts.tv_sec = (time_t)timeout;
+    ts.tv_nsec = (long)((timeout - (double)ts.tv_sec) * 1000000000.0);
+    tsp = &ts;
+  }
+  syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT_PRIVATE, expected, tsp, NULL, 0);
+#else
+  // No futex: poll. Sleep briefly, so wakeups are at most a millisecond late.
+  if (word.load(std::memory_order_acquire) == expected)
+    core::clasp_musleep((timeout >= 0.0 && timeout < 0.001) ? timeout : 0.001, false);
+#endif
+}
+
+void futex_wake(std::atomic<uint32_t>& word, bool all) {
+#ifdef __linux__
+  syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, NULL, NULL, 0);
+#else
+  (void)word;
+  (void)all;
+#endif
+}
+
+// ------------------------------------------------------------
+//
+// Lock contention
+//
+
+// Contended acquisitions, tallied by lock name. Locks with the same name
+// share a row. Rows are claimed with a CAS and never freed, so this is
+// lock-free; once the table fills up, further names are not counted.
+#define LOCK_CONTENTION_ROWS 256
+
+struct LockContention {
+  std::atomic<uint64_t> _NameWord;
+  std::atomic<uint64_t> _Count;
+};
+
+static LockContention global_LockContention[LOCK_CONTENTION_ROWS];
+
+void note_lock_contention(uint64_t nameword) {
+  size_t index = (nameword * 0x9E3779B97F4A7C15ULL) >> 56;
+  for (size_t probe = 0; probe < LOCK_CONTENTION_ROWS; ++probe) {
+    LockContention& row = global_LockContention[(index + probe) % LOCK_CONTENTION_ROWS];
+    uint64_t current = row._NameWord.load(std::memory_order_acquire);
+    if (current == 0 && row._NameWord.compare_exchange_strong(current, nameword, std::memory_order_acq_rel))
+      current = nameword;
+    if (current == nameword) {
+      row._Count.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+bool Mutex::lock_slow() {
+  for (size_t spin = 0; spin < MUTEX_SPIN_COUNT; ++spin) {
+    cpu_relax();
+    if (pthread_mutex_trylock(&this->_Mutex) == 0)
+      return true;
+  }
+  __atomic_fetch_add(&this->_Contentions, 1, __ATOMIC_RELAXED);
+  note_lock_contention(this->_NameWord);
+  // pthread_mutex_lock parks on a futex.
+  return pthread_mutex_lock(&this->_Mutex) == 0;
+}
+
+thread_local BigReaderThread tl_BigReaderThread = {-1, 0, 0, {}};
+
+// The read locks a thread holds once _Held is full. Only touched when a
+// thread holds more than BIG_READER_HELD read locks at once.
+static thread_local std::vector<const void*> tl_BigReaderOverflow;
+
+void big_reader_assign_stripe() {
+  static std::atomic<uint32_t> next_stripe(0);
+  tl_BigReaderThread._Stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % BIG_READER_STRIPES;
+}
+
+void BigReaderMutex::lock_shared_slow(std::atomic<uint32_t>& readers) {
+  // A writer is waiting for us to leave if we already hold a read lock,
+  // so a recursive read lock must not back off.
+  if (this->held_for_reading())
+    return;
+  note_lock_contention(this->_NameWord);
+  do {
+    readers.fetch_sub(1, std::memory_order_seq_cst);
+    this->reader_exited();
+    this->wait_for_writer();
+    readers.fetch_add(1, std::memory_order_seq_cst);
+  } while (this->_Writer.load(std::memory_order_seq_cst) != 0);
+}
+
+void BigReaderMutex::hold_overflow() {
+  tl_BigReaderOverflow.push_back(this);
+  ++tl_BigReaderThread._Overflow;
+}
+
+bool BigReaderMutex::held_for_reading() const {
+  BigReaderThread& self = tl_BigReaderThread;
+  for (uint32_t i = 0; i < self._Count; ++i)
+    if (self._Held[i] == this)
+      return true;
+  if (self._Overflow > 0)
+    for (const void* held : tl_BigReaderOverflow)
+      if (held == this)
+        return true;
+  return false;
+}
+
+void BigReaderMutex::forget_held() {
+  BigReaderThread& self = tl_BigReaderThread;
+  for (uint32_t i = self._Count; i > 0; --i) {
+    if (self._Held[i - 1] == this) {
+      for (uint32_t j = i; j < self._Count; ++j)
+        self._Held[j - 1] = self._Held[j];
+      --self._Count;
+      return;
+    }
+  }
+  for (auto it = tl_BigReaderOverflow.end(); it != tl_BigReaderOverflow.begin();) {
+    --it;
+    if (*it == this) {
+      tl_BigReaderOverflow.erase(it);
+      --self._Overflow;
+      return;
+    }
+  }
+}
+
+void BigReaderMutex::reader_exited() {
+  this->_ReaderExits.fetch_add(1, std::memory_order_seq_cst);
+  futex_wake(this->_ReaderExits, true);
+}
+
+void BigReaderMutex::wait_for_writer() {
+  for (size_t spin = 0; spin < MUTEX_SPIN_COUNT; ++spin) {
+    if (this->_Writer.load(std::memory_order_acquire) == 0)
+      return;
+    cpu_relax();
+  }
+  uint32_t state = this->_Writer.load(std::memory_order_acquire);
+  while (state != 0) {
+    // Mark the lock as having waiters so that unlock wakes us.
+    if (state == 1 && !this->_Writer.compare_exchange_weak(state, 2, std::memory_order_acq_rel))
+      continue;
+    futex_wait(this->_Writer, 2, -1.0);
+    state = this->_Writer.load(std::memory_order_acquire);
+  }
+}
+
+void BigReaderMutex::wait_for_readers() {
+  for (size_t spin = 0;; ++spin) {
+    // Read the exit count first: a reader that leaves after we look at its
+    // stripe bumps it, and then futex_wait returns at once.
+    uint32_t exits = this->_ReaderExits.load(std::memory_order_seq_cst);
+    bool busy = false;
+    for (auto& stripe : this->_Stripes) {
+      if (stripe._Readers.load(std::memory_order_seq_cst) != 0) {
+        busy = true;
+        break;
+      }
+    }
+    if (!busy)
+      return;
+    if (spin < MUTEX_SPIN_COUNT)
+      cpu_relax();
+    else
+      futex_wait(this->_ReaderExits, exits, -1.0);
+  }
+}
+
+void BigReaderMutex::lock() {
+  if (this->owned()) {
+    ++this->_WriteDepth;
+    return;
+  }
+  uint32_t state = 0;
+  if (!this->_Writer.compare_exchange_strong(state, 1, std::memory_order_seq_cst)) {
+    bool acquired = false;
+    for (size_t spin = 0; spin < MUTEX_SPIN_COUNT && !acquired; ++spin) {
+      cpu_relax();
+      state = 0;
+      acquired = this->_Writer.compare_exchange_weak(state, 1, std::memory_order_seq_cst);
+    }
+    if (!acquired) {
+      note_lock_contention(this->_NameWord);
+      // Drepper, "Futexes Are Tricky": 2 means someone may be parked.
+      state = this->_Writer.exchange(2, std::memory_order_seq_cst);
+      while (state != 0) {
+        futex_wait(this->_Writer, 2, -1.0);
+        state = this->_Writer.exchange(2, std::memory_order_seq_cst);
+      }
+    }
+  }
+  this->_Owner.store(&tl_BigReaderThread, std::memory_order_relaxed);
+  this->_WriteDepth = 1;
+  this->wait_for_readers();
+}
+
+void BigReaderMutex::unlock() {
+  if (--this->_WriteDepth > 0)
+    return;
+  this->_Owner.store(NULL, std::memory_order_relaxed);
+  if (this->_Writer.exchange(0, std::memory_order_seq_cst) == 2)
+    futex_wake(this->_Writer, true);
+}
+
+CL_DOCSTRING(R"dx(Return the number of times a thread had to block to obtain the given mutex.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t mp__lock_contention_count(Mutex_sp m) {
+  return m->_Mutex._value.contentions();
+}
+
+CL_LAMBDA(&key reset);
+CL_DOCSTRING(R"dx(Return an alist of (name . count) for every lock name that has seen contention)dx");
+CL_DOCSTRING_LONG(R"dx(COUNT is the number of times a thread had to block to obtain a mutex, shared mutex or internal lock with that name, summed over all locks sharing the name. Names are truncated to their first seven characters. If RESET is true, the counts are zeroed after being read.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::List_sp mp__lock_contention_statistics(bool reset) {
+  ql::list result;
+  for (size_t i = 0; i < LOCK_CONTENTION_ROWS; ++i) {
+    LockContention& row = global_LockContention[i];
+    uint64_t nameword = row._NameWord.load(std::memory_order_acquire);
+    if (nameword == 0)
+      continue;
+    uint64_t count = reset ? row._Count.exchange(0, std::memory_order_relaxed) : row._Count.load(std::memory_order_relaxed);
+    char name[8];
+    memcpy(name, &nameword, sizeof(nameword));
+    size_t len = 0;
+    while (len < 7 && name[len] != '\0')
+      ++len;
+    // Names are padded with spaces to fill the word.
+    while (len > 0 && name[len - 1] == ' ')
+      --len;
+    result << core::Cons_O::create(core::SimpleBaseString_O::make(std::string(name, len)),
+                                   core::Integer_O::create(count));
+  }
+  return result.cons();
+}
+
+// ------------------------------------------------------------
+//
+// Channels
+//
+
+// Spins on an empty or full channel before parking.
+#define CHANNEL_SPIN_COUNT 64
+// Parked threads wake at least this often to run interrupts.
+#define CHANNEL_MAX_PARK_SECONDS 0.1
+
+// CHANNEL-SELECT waiters park on this word, which every send bumps, since a
+// thread can't wait on the futex words of several channels at once.
+static std::atomic<uint32_t> global_ChannelSent(0);
+static std::atomic<uint32_t> global_ChannelSelectWaiters(0);
+
+Channel_sp Channel_O::make_channel(core::T_sp name, size_t capacity) {
+  size_t size = 0;
+  if (capacity > 0) {
+    // The ring's size must be a power of two, and at least 2: with one
+    // slot a full ring and an empty one have the same sequence numbers.
+    size = 2;
+    while (size < capacity)
+      size <<= 1;
+  }
+  auto channel = gctools::GC<Channel_O>::allocate(name, size);
+  if (size > 0) {
+    channel->_Slots = core::SimpleVector_O::make(size);
+    channel->_Sequences = core::SimpleVector_size_t_O::make(size);
+    for (size_t i = 0; i < size; ++i)
+      (*channel->_Sequences)[i] = i;
+  } else {
+    core::T_sp dummy = core::Cons_O::create(nil<core::T_O>(), nil<core::T_O>());
+    channel->_Head.store(dummy);
+    channel->_Tail.store(dummy);
+  }
+  return channel;
+}
+
+bool Channel_O::try_send(core::T_sp value) {
+  if (this->_Capacity > 0) {
+    size_t mask = this->_Capacity - 1;
+    size_t* sequences = &(*this->_Sequences)[0];
+    size_t pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+      size_t seq = __atomic_load_n(&sequences[pos & mask], __ATOMIC_ACQUIRE);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (this->_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          (*this->_Slots)[pos & mask] = value;
+          __atomic_store_n(&sequences[pos & mask], pos + 1, __ATOMIC_RELEASE);
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  } else {
+    core::Cons_sp node = core::Cons_O::create(value, nil<core::T_O>());
+    while (true) {
+      core::Cons_sp tail = gc::As_unsafe<core::Cons_sp>(this->_Tail.load());
+      core::T_sp next = tail->cdrAtomic(std::memory_order_acquire);
+      if (tail.raw_() != this->_Tail.load().raw_())
+        continue;
+      if (next.nilp()) {
+        if (tail->cdrCAS(nil<core::T_O>(), node, std::memory_order_seq_cst).nilp()) {
+          core::T_sp expected_tail = tail;
+          this->_Tail.compare_exchange_strong(expected_tail, node);
+          break;
+        }
+      } else {
+        // Help a sender that linked its node but hasn't swung the tail yet.
+        core::T_sp expected_tail = tail;
+        this->_Tail.compare_exchange_strong(expected_tail, next);
+      }
+    }
+  }
+  // Publishing the value and then reading the waiter count pairs with
+  // channel_wait counting itself in and then re-checking the queue: without
+  // a full fence on both sides each can miss the other and a wakeup is lost.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->_ReceiversWaiting.load() > 0) {
+    this->_NotEmpty.fetch_add(1);
+    futex_wake(this->_NotEmpty);
+  }
+  if (global_ChannelSelectWaiters.load() > 0) {
+    global_ChannelSent.fetch_add(1);
+    futex_wake(global_ChannelSent, true);
+  }
+  return true;
+}
+
+bool Channel_O::try_receive(core::T_sp& value) {
+  if (this->_Capacity > 0) {
+    size_t mask = this->_Capacity - 1;
+    size_t* sequences = &(*this->_Sequences)[0];
+    size_t pos = this->_DequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      size_t seq = __atomic_load_n(&sequences[pos & mask], __ATOMIC_ACQUIRE);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (this->_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          value = (*this->_Slots)[pos & mask];
+          // Don't keep the value alive from the ring.
+          (*this->_Slots)[pos & mask] = nil<core::T_O>();
+          __atomic_store_n(&sequences[pos & mask], pos + mask + 1, __ATOMIC_RELEASE);
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = this->_DequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    // See try_send.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_SendersWaiting.load() > 0) {
+      this->_NotFull.fetch_add(1);
+      futex_wake(this->_NotFull);
+    }
+    return true;
+  }
+  while (true) {
+    core::T_sp head = this->_Head.load();
+    core::T_sp tail = this->_Tail.load();
+    core::T_sp next = gc::As_unsafe<core::Cons_sp>(head)->cdrAtomic(std::memory_order_acquire);
+    if (head.raw_() != this->_Head.load().raw_())
+      continue;
+    if (next.nilp())
+      return false; // empty
+    if (head.raw_() == tail.raw_()) {
+      core::T_sp expected_tail = tail;
+      this->_Tail.compare_exchange_strong(expected_tail, next);
+      continue;
+    }
+    core::T_sp result = gc::As_unsafe<core::Cons_sp>(next)->carAtomic(std::memory_order_acquire);
+    if (this->_Head.compare_exchange_strong(head, next)) {
+      // NEXT is the dummy node now; don't keep the value alive from it.
+      // Only the winner of the CAS gets here, and losers discard what
+      // they read.
+      gc::As_unsafe<core::Cons_sp>(next)->setCarAtomic(nil<core::T_O>(), std::memory_order_relaxed);
+      value = result;
+      return true;
+    }
+  }
+}
+
+// Wait until TRY succeeds, parking on WORD once spinning gives up.
+template <typename Try>
+static bool channel_wait(Try try_op, std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiters, double timeout) {
+  if (try_op())
+    return true;
+  for (int spin = 0; spin < CHANNEL_SPIN_COUNT; ++spin) {
+    cpu_relax();
+    if (try_op())
+      return true;
+  }
+  if (timeout == 0.0)
+    return false;
+  auto start = std::chrono::steady_clock::now();
+  while (true) {
+    uint32_t seen = word.load();
+    waiters.fetch_add(1);
+    // Pairs with the fence in try_send/try_receive between publishing and
+    // reading the waiter count.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool done = try_op();
+    double park = CHANNEL_MAX_PARK_SECONDS;
+    if (!done && timeout > 0.0) {
+      double remaining = timeout - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if (remaining <= 0.0) {
+        waiters.fetch_sub(1);
+        return false;
+      }
+      park = std::min(park, remaining);
+    }
+    if (!done)
+      futex_wait(word, seen, park);
+    waiters.fetch_sub(1);
+    if (done)
+      return true;
+    gctools::handle_all_queued_interrupts();
+  }
+}
+
+bool Channel_O::send(core::T_sp value, double timeout) {
+  return channel_wait([this, value]() { return this->try_send(value); }, this->_NotFull, this->_SendersWaiting, timeout);
+}
+
+bool Channel_O::receive(core::T_sp& value, double timeout) {
+  return channel_wait([this, &value]() { return this->try_receive(value); }, this->_NotEmpty, this->_ReceiversWaiting,
+                      timeout);
+}
+
+size_t Channel_O::count() const {
+  if (this->_Capacity > 0) {
+    size_t enq = this->_EnqueuePos.load();
+    size_t deq = this->_DequeuePos.load();
+    return enq > deq ? enq - deq : 0;
+  }
+  size_t n = 0;
+  core::T_sp cur = gc::As_unsafe<core::Cons_sp>(this->_Head.load())->cdrAtomic(std::memory_order_acquire);
+  while (cur.consp()) {
+    ++n;
+    cur = gc::As_unsafe<core::Cons_sp>(cur)->cdrAtomic(std::memory_order_acquire);
+  }
+  return n;
+}
+
+string Channel_O::__repr__() const {
+  stringstream ss;
+  ss << "#<CHANNEL ";
+  ss << _rep_(this->_Name);
+  if (this->_Capacity > 0)
+    ss << " :capacity " << this->_Capacity;
+  ss << ">";
+  return ss.str();
+}
+
+static double channel_timeout(core::T_sp timeout) {
+  return timeout.nilp() ? -1.0 : core::clasp_to_double(timeout);
+}
+
+CL_LAMBDA(&key name capacity);
+CL_DOCSTRING(R"dx(Make a channel for passing objects between threads in FIFO order.)dx");
+CL_DOCSTRING_LONG(R"dx(If CAPACITY is NIL the channel is unbounded and sends never block. Otherwise senders block while the channel is full; the capacity is rounded up to a power of two, and to at least 2. Sending and receiving do not take locks, and threads only block when they cannot proceed.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Channel_sp mp__make_channel(core::T_sp name, core::T_sp capacity) {
+  size_t cap = 0;
+  if (capacity.notnilp()) {
+    cap = core::clasp_to_size(capacity);
+    if (cap == 0)
+      SIMPLE_ERROR("The capacity of a channel must be positive or NIL, not {}", _rep_(capacity));
+  }
+  return Channel_O::make_channel(name, cap);
+}
+
+CL_LAMBDA(channel object &key timeout);
+CL_DOCSTRING(R"dx(Send OBJECT on CHANNEL. Return true if it was sent, or NIL if TIMEOUT seconds passed with the channel full.)dx");
+CL_DOCSTRING_LONG(R"dx(A TIMEOUT of NIL waits indefinitely, and a TIMEOUT of zero never blocks.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool mp__channel_send(Channel_sp channel, core::T_sp object, core::T_sp timeout) {
+  return channel->send(object, channel_timeout(timeout));
+}
+
+CL_LAMBDA(channel &key timeout);
+CL_DOCSTRING(R"dx(Receive the next object from CHANNEL. Return it and T, or NIL and NIL if TIMEOUT seconds passed with the channel empty.)dx");
+CL_DOCSTRING_LONG(R"dx(A TIMEOUT of NIL waits indefinitely, and a TIMEOUT of zero never blocks.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv mp__channel_receive(Channel_sp channel, core::T_sp timeout) {
+  core::T_sp value;
+  if (channel->receive(value, channel_timeout(timeout)))
+    return Values(value, _lisp->_true());
+  return Values(nil<core::T_O>(), nil<core::T_O>());
+}
+
+CL_LAMBDA(channels &key timeout);
+CL_DOCSTRING(R"dx(Receive from whichever of the list CHANNELS first has an object. Return the object and its channel, or NIL and NIL on timeout.)dx");
+CL_DOCSTRING_LONG(R"dx(Channels earlier in the list are preferred when several are ready. A TIMEOUT of NIL waits indefinitely, and a TIMEOUT of zero never blocks.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv mp__channel_select(core::List_sp channels, core::T_sp timeout) {
+  core::T_sp value;
+  core::T_sp ready = nil<core::T_O>();
+  auto try_all = [&]() {
+    for (auto cur : channels) {
+      Channel_sp channel = gc::As<Channel_sp>(oCar(cur));
+      if (channel->try_receive(value)) {
+        ready = channel;
+        return true;
+      }
+    }
+    return false;
+  };
+  if (channel_wait(try_all, global_ChannelSent, global_ChannelSelectWaiters, channel_timeout(timeout)))
+    return Values(value, ready);
+  return Values(nil<core::T_O>(), nil<core::T_O>());
+}
+
+CL_DOCSTRING(R"dx(Return the number of objects waiting in CHANNEL. Other threads may change it at any time.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t mp__channel_count(Channel_sp channel) {
+  return channel->count();
+}
+
+CL_DOCSTRING(R"dx(Return the capacity of CHANNEL, or NIL if it is unbounded.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp mp__channel_capacity(Channel_sp channel) {
+  return channel->_Capacity > 0 ? core::T_sp(core::clasp_make_fixnum(channel->_Capacity)) : nil<core::T_O>();
+}
+
+CL_DOCSTRING(R"dx(Return the name of CHANNEL.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp mp__channel_name(Channel_sp channel) {
+  return channel->_Name;
+}
+
 };
 
@@ -44,74 +44,136 @@ THE SOFTWARE.
 #include <clasp/core/numbers.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/core/bignum.h>
+#include <clasp/core/lispStream.h>
 #include <clasp/core/numberToString.h>
 #include <clasp/core/wrappers.h>
 
 namespace core {
 
-CL_LAMBDA(buffer x base);
-CL_DECLARE();
-DOCGROUP(clasp);
-CL_DEFUN StrNs_sp core__next_to_string(StrNs_sp buffer, Bignum_sp bn,
-                                       Fixnum_sp base) {
-  const char* num_to_text = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char *num_to_text = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/*! Call FN with the digits of the magnitude of BN in BASE, as characters */
+template <typename Fn>
+static void with_bignum_digits(Bignum_sp bn, int base, Fn &&fn) {
+  mp_size_t size = std::abs(bn->length());
+  const mp_limb_t *limbs = bn->limbs();
+  // mpn_get_str may destroy its input, so convert a copy of the limbs.
+  BignumScratch<mp_limb_t> copy_limbs(size);
+  BignumScratch<unsigned char, 2048> digits(mpn_sizeinbase(limbs, size, base) + 1);
+  unsigned char *str = digits;
+  memcpy(copy_limbs, limbs, size * sizeof(mp_limb_t));
+  // mpn_get_str switches to a divide and conquer conversion for large operands
+  size_t len = mpn_get_str(str, base, copy_limbs, size);
+  while (len > 1 && str[0] == 0) {
+    ++str;
+    --len;
+  }
+  for (size_t i = 0; i < len; ++i)
+    str[i] = num_to_text[str[i]];
+  fn((const char *)str, len);
+}
+
+static void check_print_base(Fixnum_sp base) {
   int ibase = unbox_fixnum(base);
   if (ibase < 2 || ibase > 36) {
     QERROR_WRONG_TYPE_NTH_ARG(3, base, Cons_O::createList(cl::_sym_integer, make_fixnum(2), make_fixnum(36)));
   }
-  mp_size_t len = bn->length();
-  mp_size_t size = std::abs(len);
-  const mp_limb_t* limbs = bn->limbs();
-  size_t str_size = mpn_sizeinbase(limbs, size, ibase);
-  size_t negative = (len < 0) ? 1 : 0;
-  mp_limb_t copy_limbs[size]; // mpn_get_str may destroy its input
-  // FIXME: memcpy copy something
-  for (mp_size_t i = 0; i < size; ++i) copy_limbs[i] = limbs[i];
+}
 
+CL_LAMBDA(buffer x base);
+CL_DECLARE();
+DOCGROUP(clasp);
+CL_DEFUN StrNs_sp core__next_to_string(StrNs_sp buffer, Bignum_sp bn,
+                                       Fixnum_sp base) {
+  check_print_base(base);
+  size_t negative = (bn->length() < 0) ? 1 : 0;
   if (Str8Ns_sp buffer8 = buffer.asOrNull<Str8Ns_O>()) {
-    buffer8->ensureSpaceAfterFillPointer(clasp_make_character('\0'),
-                                         str_size+negative+2);
-    unsigned char *bufferStart = (unsigned char*)&(*buffer8)[buffer8->fillPointer()];
-    unsigned char *significandStart = bufferStart + negative;
-    mp_size_t actual_str_size = mpn_get_str(significandStart, ibase, copy_limbs, size);
-    if (negative == 1) bufferStart[0] = '-';
-    for (size_t i = 0; i < actual_str_size; ++i)
-      significandStart[i] = num_to_text[significandStart[i]];
-    if (bufferStart[actual_str_size + negative - 1] == '\0') {
-      buffer8->fillPointerSet(buffer8->fillPointer()+actual_str_size+negative-1);
-    } else {
-      buffer8->fillPointerSet(buffer8->fillPointer()+actual_str_size+negative);
-    }
+    with_bignum_digits(bn, unbox_fixnum(base), [&](const char *digits, size_t len) {
+      buffer8->ensureSpaceAfterFillPointer(clasp_make_character('\0'), len + negative);
+      unsigned char *bufferStart = (unsigned char *)&(*buffer8)[buffer8->fillPointer()];
+      if (negative == 1)
+        bufferStart[0] = '-';
+      memcpy(bufferStart + negative, digits, len);
+      buffer8->fillPointerSet(buffer8->fillPointer() + len + negative);
+    });
   } else if (StrWNs_sp bufferw = buffer.asOrNull<StrWNs_O>()) {
-    bufferw->ensureSpaceAfterFillPointer(clasp_make_character(' '),
-                                         str_size+negative);
-    unsigned char cpbuffer[str_size+1]; // use a stack allocated array for this
-    mp_size_t actual_str_size = mpn_get_str(cpbuffer, ibase, copy_limbs, size);
-    if (negative == 1) bufferw->vectorPushExtend('-');
-    for (size_t idx(0); idx < actual_str_size; ++idx)
-      bufferw->vectorPushExtend(num_to_text[cpbuffer[idx]]);
+    with_bignum_digits(bn, unbox_fixnum(base), [&](const char *digits, size_t len) {
+      bufferw->ensureSpaceAfterFillPointer(clasp_make_character(' '), len + negative);
+      if (negative == 1)
+        bufferw->vectorPushExtend('-');
+      for (size_t idx(0); idx < len; ++idx)
+        bufferw->vectorPushExtend(digits[idx]);
+    });
   } else {
     SIMPLE_ERROR("The buffer for the bignum must be a string with a fill-pointer");
   }
   return buffer;
 }
 
-static void write_base_prefix(StrNs_sp buffer, int base) {
+static char *base_prefix(char *cur, int base) {
+  *cur++ = '#';
   if (base == 2) {
-    StringPushStringCharStar(buffer,"#b");
+    *cur++ = 'b';
   } else if (base == 8) {
-    StringPushStringCharStar(buffer,"#o");
+    *cur++ = 'o';
   } else if (base == 16) {
-    StringPushStringCharStar(buffer,"#x");
-  } else if (base >= 10) {
-    string prefix = "#00r";
-    prefix[1] = base / 10 + '0';
-    prefix[2] = base % 10 + '0';
-    StringPushStringCharStar(buffer,prefix.c_str());
+    *cur++ = 'x';
   } else {
-    string prefix = "#0r";
-    prefix[1] = base + '0';
-    StringPushStringCharStar(buffer,prefix.c_str());
+    if (base >= 10)
+      *cur++ = base / 10 + '0';
+    *cur++ = base % 10 + '0';
+    *cur++ = 'r';
+  }
+  return cur;
+}
+
+static void write_base_prefix(StrNs_sp buffer, int base) {
+  char prefix[8];
+  *base_prefix(prefix, base) = '\0';
+  StringPushStringCharStar(buffer, prefix);
+}
+
+size_t clasp_fixnum_to_chars(char *buf, gc::Fixnum fn, int base, bool radix, bool decimalp) {
+  char *cur = buf;
+  if (radix && (!decimalp || base != 10))
+    cur = base_prefix(cur, base);
+  if (fn < 0) {
+    *cur++ = '-';
+    fn = -fn;
+  }
+  // Generate the digits backwards at the end of BUF, then slide them down
+  char *end = buf + CLASP_FIXNUM_CHARS_MAX;
+  char *digits = end;
+  do {
+    *--digits = num_to_text[fn % base];
+    fn /= base;
+  } while (fn != 0);
+  size_t ndigits = end - digits;
+  memmove(cur, digits, ndigits);
+  cur += ndigits;
+  if (radix && decimalp && base == 10)
+    *cur++ = '.';
+  return cur - buf;
+}
+
+void clasp_write_integer(Integer_sp integer, int base, bool radix, bool decimalp, T_sp stream) {
+  if (integer.fixnump()) {
+    char txt[CLASP_FIXNUM_CHARS_MAX];
+    size_t len = clasp_fixnum_to_chars(txt, integer.unsafe_fixnum(), base, radix, decimalp);
+    clasp_write_characters(txt, len, stream);
+  } else if (Bignum_sp bn = integer.asOrNull<Bignum_O>()) {
+    char prefix[8];
+    size_t prefix_len = 0;
+    if (radix && (!decimalp || base != 10))
+      prefix_len = base_prefix(prefix, base) - prefix;
+    if (bn->length() < 0)
+      prefix[prefix_len++] = '-';
+    clasp_write_characters(prefix, prefix_len, stream);
+    with_bignum_digits(bn, base, [&](const char *digits, size_t len) { clasp_write_characters(digits, len, stream); });
+    if (radix && decimalp && base == 10)
+      clasp_write_char('.', stream);
+  } else {
+    QERROR_WRONG_TYPE_NTH_ARG(1, integer, cl::_sym_integer);
   }
 }
 
@@ -133,38 +195,11 @@ CL_DEFUN StrNs_sp core__integer_to_string(StrNs_sp buffer, Integer_sp integer,
     return buffer;
   }
   if (integer.fixnump()) {
-    char txt[64];
-    gc::Fixnum fn = unbox_fixnum(gc::As<Fixnum_sp>(integer));
-    if (fn < 0) {
-      StringPushStringCharStar(buffer,"-");
-      fn = - fn;
-    }
-    switch (unbox_fixnum(base)) {
-    case 8:
-      sprintf(txt, "%" PRFoctal, fn);
-      StringPushStringCharStar(buffer,txt);
-      break;
-    case 10:
-      sprintf(txt, "%" PRF, fn);
-      StringPushStringCharStar(buffer,txt);
-      break;
-    case 16:
-      sprintf(txt, "%" PRFhex, fn);
-      StringPushStringCharStar(buffer,txt);
-      break;
-    default:
-        if (fn == 0) {
-          // Zero needs to be special cased, because
-          // zero bignums would need special casing.
-          // Specifically, mpn functions have undefined
-          // behavior when passed them.
-          StringPushStringCharStar(buffer,"0");
-          return buffer;
-        };
-        Bignum_sp bn = core__next_from_fixnum(fn);
-        core__next_to_string(buffer, bn, base);
-        break;
-    }
+    check_print_base(base);
+    char txt[CLASP_FIXNUM_CHARS_MAX + 1];
+    size_t len = clasp_fixnum_to_chars(txt, integer.unsafe_fixnum(), unbox_fixnum(base), false, false);
+    txt[len] = '\0';
+    StringPushStringCharStar(buffer, txt);
     return buffer;
   } else if (Bignum_sp bi = integer.asOrNull<Bignum_O>()) {
     core__next_to_string(buffer, bi, base);
@@ -205,6 +205,49 @@ CL_DEFUN Real_sp cl__max(Real_sp max, List_sp nums) {
   return max;
 }
 
+// Unboxed fast paths for float-heavy generic arithmetic.
+// MATH_DISPATCH classifies each argument with a chain of type tests and the
+// float cases then unbox through clasp_to_double; a double-float combined
+// with a double-float or a fixnum is common enough to test for first and
+// do in registers, boxing only the result.
+static inline bool double_operands(Number_sp na, Number_sp nb, double& da, double& db) {
+  if (gc::IsA<DoubleFloat_sp>(na)) {
+    da = gc::As_unsafe<DoubleFloat_sp>(na)->get();
+    if (gc::IsA<DoubleFloat_sp>(nb)) {
+      db = gc::As_unsafe<DoubleFloat_sp>(nb)->get();
+      return true;
+    }
+    if (nb.fixnump()) {
+      db = (double)nb.unsafe_fixnum();
+      return true;
+    }
+    return false;
+  }
+  if (na.fixnump() && gc::IsA<DoubleFloat_sp>(nb)) {
+    da = (double)na.unsafe_fixnum();
+    db = gc::As_unsafe<DoubleFloat_sp>(nb)->get();
+    return true;
+  }
+  return false;
+}
+
+// A complex with double-float parts, which Complex_O holds as two boxed
+// reals. Arithmetic between two of them is done on the unboxed parts, so
+// only the parts of the result are allocated rather than every product
+// and sum along the way.
+static inline bool double_complex_parts(Number_sp n, double& re, double& im) {
+  if (!gc::IsA<Complex_sp>(n)) return false;
+  Complex_sp c = gc::As_unsafe<Complex_sp>(n);
+  if (!gc::IsA<DoubleFloat_sp>(c->real()) || !gc::IsA<DoubleFloat_sp>(c->imaginary())) return false;
+  re = gc::As_unsafe<DoubleFloat_sp>(c->real())->get();
+  im = gc::As_unsafe<DoubleFloat_sp>(c->imaginary())->get();
+  return true;
+}
+
+static inline bool double_complex_operands(Number_sp na, Number_sp nb, double& ar, double& ai, double& br, double& bi) {
+  return double_complex_parts(na, ar, ai) && double_complex_parts(nb, br, bi);
+}
+
 CL_NAME("TWO-ARG-+-FIXNUM-FIXNUM");
 CL_UNWIND_COOP(true);
 DOCGROUP(clasp);
@@ -216,6 +259,12 @@ CL_NAME("TWO-ARG-+");
 CL_UNWIND_COOP(true);
 DOCGROUP(clasp);
 CL_DEFUN Number_sp contagion_add(Number_sp na, Number_sp nb) {
+  double da, db;
+  if (double_operands(na, nb, da, db))
+    return DoubleFloat_O::create(da + db);
+  double ar, ai, br, bi;
+  if (double_complex_operands(na, nb, ar, ai, br, bi))
+    return clasp_make_complex(DoubleFloat_O::create(ar + br), DoubleFloat_O::create(ai + bi));
   MATH_DISPATCH_BEGIN(na, nb) {
   case_Fixnum_v_Fixnum :
     return two_arg__PLUS_FF(na.unsafe_fixnum(),nb.unsafe_fixnum());
@@ -337,6 +386,12 @@ CL_NAME("TWO-ARG--");
 CL_UNWIND_COOP(true);
 DOCGROUP(clasp);
 CL_DEFUN Number_sp contagion_sub(Number_sp na, Number_sp nb) {
+  double da, db;
+  if (double_operands(na, nb, da, db))
+    return DoubleFloat_O::create(da - db);
+  double ar, ai, br, bi;
+  if (double_complex_operands(na, nb, ar, ai, br, bi))
+    return clasp_make_complex(DoubleFloat_O::create(ar - br), DoubleFloat_O::create(ai - bi));
   MATH_DISPATCH_BEGIN(na, nb) {
   case_Fixnum_v_Fixnum: {
       Fixnum fa = na.unsafe_fixnum();
@@ -452,6 +507,16 @@ CL_NAME("TWO-ARG-*");
 CL_UNWIND_COOP(true);
 DOCGROUP(clasp);
 CL_DEFUN Number_sp contagion_mul(Number_sp na, Number_sp nb) {
+  double da, db;
+  if (double_operands(na, nb, da, db))
+    return DoubleFloat_O::create(da * db);
+  double ar, ai, br, bi;
+  if (double_complex_operands(na, nb, ar, ai, br, bi)) {
+    // (x + yi)(u + vi) = (xu - yv) + (xv + yu)i, each product rounded
+    // separately (no contraction to fma) to match the boxed path.
+    double xu = ar * br, yv = ai * bi, xv = ar * bi, yu = ai * br;
+    return clasp_make_complex(DoubleFloat_O::create(xu - yv), DoubleFloat_O::create(xv + yu));
+  }
   MATH_DISPATCH_BEGIN(na, nb) {
   case_Fixnum_v_Fixnum : {
       // We want to detect when Fixnum * Fixnum multiplication will overflow and only then use bignum arithmetic.
@@ -604,6 +669,17 @@ CL_NAME("TWO-ARG-/");
 CL_UNWIND_COOP(true);
 DOCGROUP(clasp);
 CL_DEFUN Number_sp contagion_div(Number_sp na, Number_sp nb) {
+  double da, db;
+  if (double_operands(na, nb, da, db))
+    return DoubleFloat_O::create(da / db);
+  double ar, ai, br, bi;
+  if (double_complex_operands(na, nb, ar, ai, br, bi)) {
+    // The same formula and roundings as complex_divide.
+    double brbr = br * br, bibi = bi * bi, arbr = ar * br, aibi = ai * bi, aibr = ai * br, arbi = ar * bi;
+    double absB2 = brbr + bibi;
+    return clasp_make_complex(DoubleFloat_O::create((arbr + aibi) / absB2),
+                              DoubleFloat_O::create((aibr - arbi) / absB2));
+  }
   MATH_DISPATCH_BEGIN(na, nb) {
   case_Fixnum_v_Fixnum:
   case_Bignum_v_Fixnum:
@@ -0,0 +1,415 @@
+/*
+    File: numericVector.cc
+
+    Arithmetic over the raw storage of specialized numeric arrays, for the
+    EXT:VECTOR-ADD family (vector-math.lisp).  Every operand must have the
+    same element type, one of DOUBLE-FLOAT, SINGLE-FLOAT or FIXNUM, and the
+    functions here work on the row-major elements [START, END) of each.
+
+    - Float kernels are plain loops over a block of LANES elements with that
+      many independent accumulators, so the compiler turns them into vector
+      instructions. Each is compiled three times: for the baseline target,
+      and with target("avx2,fma") and target("avx512f,fma"), and the widest
+      one the processor supports (see hwinfo.cc) is picked on first use.
+      Reductions combine their accumulators at the end, so their rounding
+      may differ from a left-to-right loop.
+    - Fixnum kernels check every result and signal an error rather than
+      wrap when one leaves the fixnum range. Sums and dot products are
+      accumulated exactly and may return bignums.
+
+    Nothing here calls back into Lisp or allocates until the result is
+    boxed, so the Lisp side may run disjoint ranges in parallel.
+*/
+#include <cmath>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/array.h>
+#include <clasp/core/numbers.h>
+#include <clasp/core/hwinfo.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/wrappers.h>
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#define CLASP_VECTOR_KERNELS_X86 1
+#endif
+
+namespace core {
+
+namespace nv {
+
+/* Every kernel takes the same arguments so one dispatcher serves them all:
+   R = X op Y (or op Z), with ALPHA as the scalar, over N elements. Reductions
+   return their value and the others return zero. */
+#define NV_KERNEL_ARGS T *r, const T *x, const T *y, const T *z, T alpha, size_t n
+#define NV_KERNEL_PARAMS r, x, y, z, alpha, n
+
+struct Add {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    for (size_t i = 0; i < n; ++i) r[i] = x[i] + y[i];
+    return 0;
+  }
+};
+
+struct Multiply {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    for (size_t i = 0; i < n; ++i) r[i] = x[i] * y[i];
+    return 0;
+  }
+};
+
+struct Fma {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    for (size_t i = 0; i < n; ++i) r[i] = std::fma(x[i], y[i], z[i]);
+    return 0;
+  }
+};
+
+struct Scale {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    for (size_t i = 0; i < n; ++i) r[i] = alpha * x[i];
+    return 0;
+  }
+};
+
+struct Axpy {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    for (size_t i = 0; i < n; ++i) r[i] = alpha * x[i] + y[i];
+    return 0;
+  }
+};
+
+// Four blocks of accumulators keep the adders busy.
+struct Sum {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    T acc[4 * L] = {};
+    size_t i = 0;
+    for (; i + 4 * L <= n; i += 4 * L)
+      for (size_t j = 0; j < 4 * L; ++j) acc[j] += x[i + j];
+    T total = 0;
+    for (size_t j = 0; j < 4 * L; ++j) total += acc[j];
+    for (; i < n; ++i) total += x[i];
+    return total;
+  }
+};
+
+struct Dot {
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    T acc[4 * L] = {};
+    size_t i = 0;
+    for (; i + 4 * L <= n; i += 4 * L)
+      for (size_t j = 0; j < 4 * L; ++j) acc[j] += x[i + j] * y[i + j];
+    T total = 0;
+    for (size_t j = 0; j < 4 * L; ++j) total += acc[j];
+    for (; i < n; ++i) total += x[i] * y[i];
+    return total;
+  }
+};
+
+// N must be positive.
+template <bool Max> struct Extreme {
+  template <typename T> [[gnu::always_inline]] static T pick(T a, T b) {
+    if constexpr (Max) return (b > a) ? b : a;
+    else return (b < a) ? b : a;
+  }
+  template <typename T, size_t L> [[gnu::always_inline]] static T run(NV_KERNEL_ARGS) {
+    T acc[L];
+    for (size_t j = 0; j < L; ++j) acc[j] = x[0];
+    size_t i = 0;
+    for (; i + L <= n; i += L)
+      for (size_t j = 0; j < L; ++j) acc[j] = pick(acc[j], x[i + j]);
+    T result = acc[0];
+    for (size_t j = 1; j < L; ++j) result = pick(result, acc[j]);
+    for (; i < n; ++i) result = pick(result, x[i]);
+    return result;
+  }
+};
+
+template <typename Op, typename T> struct Dispatch {
+  typedef T (*kernel)(NV_KERNEL_ARGS);
+  static T generic(NV_KERNEL_ARGS) { return Op::template run<T, 16 / sizeof(T)>(NV_KERNEL_PARAMS); }
+#ifdef CLASP_VECTOR_KERNELS_X86
+  __attribute__((target("avx2,fma"))) static T avx2(NV_KERNEL_ARGS) {
+    return Op::template run<T, 32 / sizeof(T)>(NV_KERNEL_PARAMS);
+  }
+  __attribute__((target("avx512f,fma"))) static T avx512(NV_KERNEL_ARGS) {
+    return Op::template run<T, 64 / sizeof(T)>(NV_KERNEL_PARAMS);
+  }
+#endif
+  static kernel select() {
+#ifdef CLASP_VECTOR_KERNELS_X86
+    const CpuFeatures& features = cpu_features();
+    if (features.avx512f && features.fma) return avx512;
+    if (features.avx2 && features.fma) return avx2;
+#endif
+    return generic;
+  }
+  static T run(NV_KERNEL_ARGS) {
+    static const kernel fn = select();
+    return fn(NV_KERNEL_PARAMS);
+  }
+};
+
+/* Fixnum kernels. */
+
+[[noreturn]] static void fixnum_overflow(const char* op, size_t index) {
+  SIMPLE_ERROR("The result of {} at index {} is not a fixnum", op, index);
+}
+
+static inline Fixnum checked_fixnum(__int128 value, const char* op, size_t index) {
+  if (value < gc::most_negative_fixnum || value > gc::most_positive_fixnum)
+    fixnum_overflow(op, index);
+  return (Fixnum)value;
+}
+
+static mpz_class int128_to_mpz(__int128 value) {
+  bool negative = value < 0;
+  unsigned __int128 magnitude = negative ? -(unsigned __int128)value : (unsigned __int128)value;
+  mpz_class big((unsigned long)(uint64_t)(magnitude >> 64));
+  big <<= 64;
+  big += (unsigned long)(uint64_t)magnitude;
+  if (negative) big = -big;
+  return big;
+}
+
+static Integer_sp int128_to_integer(__int128 value) {
+  if (value >= INT64_MIN && value <= INT64_MAX)
+    return Integer_O::create((int64_t)value);
+  return Integer_O::create(int128_to_mpz(value));
+}
+
+// Exact sum of the products X[i]*Y[i], or of X[i] when Y is null.
+static Integer_sp fixnum_sum(const Fixnum* x, const Fixnum* y, size_t n) {
+  __int128 total = 0;
+  mpz_class spilled = 0;
+  for (size_t i = 0; i < n; ++i) {
+    __int128 term = y ? (__int128)x[i] * y[i] : (__int128)x[i];
+    __int128 next;
+    if (__builtin_add_overflow(total, term, &next)) {
+      spilled += int128_to_mpz(total);
+      next = term;
+    }
+    total = next;
+  }
+  if (spilled == 0) return int128_to_integer(total);
+  return Integer_O::create(mpz_class(spilled + int128_to_mpz(total)));
+}
+
+}; // namespace nv
+
+enum VectorElement { vector_double, vector_single, vector_fixnum };
+
+static VectorElement vector_element(Array_sp array) {
+  T_sp type = array->element_type();
+  if (type == cl::_sym_double_float) return vector_double;
+  if (type == cl::_sym_single_float) return vector_single;
+  if (type == cl::_sym_fixnum) return vector_fixnum;
+  SIMPLE_ERROR("Vector arithmetic needs arrays of double-float, single-float or fixnum, not {}",
+               _rep_(type));
+}
+
+/* Check that every operand has the element type of the first and at
+   least END elements, and return that element type. */
+static VectorElement check_operands(size_t start, size_t end, std::initializer_list<T_sp> operands) {
+  if (start > end)
+    SIMPLE_ERROR("Vector arithmetic start {} is after end {}", start, end);
+  Array_sp first = gc::As<Array_sp>(*operands.begin());
+  VectorElement element = vector_element(first);
+  for (T_sp operand : operands) {
+    Array_sp array = gc::As<Array_sp>(operand);
+    if (vector_element(array) != element)
+      SIMPLE_ERROR("Vector arithmetic operands {} and {} have different element types", _rep_(first), _rep_(array));
+    if (end > array->arrayTotalSize())
+      SIMPLE_ERROR("Vector arithmetic end {} is past the end of {}", end, _rep_(array));
+  }
+  return element;
+}
+
+template <typename T>
+static inline T* vector_data(Array_sp array, size_t start) {
+  return (T*)array->rowMajorAddressOfElement_(0) + start;
+}
+
+template <typename Op, typename T>
+static T run_kernel(T_sp r, T_sp x, T_sp y, T_sp z, T alpha, size_t start, size_t end) {
+  auto data = [&](T_sp a) { return a.nilp() ? (T*)NULL : vector_data<T>(gc::As_unsafe<Array_sp>(a), start); };
+  return nv::Dispatch<Op, T>::run(data(r), data(x), data(y), data(z), alpha, end - start);
+}
+
+static Fixnum fixnum_scalar(T_sp alpha) {
+  if (!alpha.fixnump()) TYPE_ERROR(alpha, cl::_sym_fixnum);
+  return alpha.unsafe_fixnum();
+}
+
+/* Elementwise operations. */
+
+CL_LAMBDA(result x y start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Store X[i] + Y[i] into RESULT[i] for i from START below END.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp core__vector_add_range(Array_sp result, Array_sp x, Array_sp y, size_t start, size_t end) {
+  switch (check_operands(start, end, {x, y, result})) {
+  case vector_double: run_kernel<nv::Add, double>(result, x, y, nil<T_O>(), 0, start, end); break;
+  case vector_single: run_kernel<nv::Add, float>(result, x, y, nil<T_O>(), 0, start, end); break;
+  case vector_fixnum: {
+    Fixnum *r = vector_data<Fixnum>(result, start), *xd = vector_data<Fixnum>(x, start),
+           *yd = vector_data<Fixnum>(y, start);
+    for (size_t i = 0; i < end - start; ++i)
+      r[i] = nv::checked_fixnum((__int128)xd[i] + yd[i], "vector-add", start + i);
+  } break;
+  }
+  return result;
+}
+
+CL_LAMBDA(result x y start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Store X[i] * Y[i] into RESULT[i] for i from START below END.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp core__vector_multiply_range(Array_sp result, Array_sp x, Array_sp y, size_t start, size_t end) {
+  switch (check_operands(start, end, {x, y, result})) {
+  case vector_double: run_kernel<nv::Multiply, double>(result, x, y, nil<T_O>(), 0, start, end); break;
+  case vector_single: run_kernel<nv::Multiply, float>(result, x, y, nil<T_O>(), 0, start, end); break;
+  case vector_fixnum: {
+    Fixnum *r = vector_data<Fixnum>(result, start), *xd = vector_data<Fixnum>(x, start),
+           *yd = vector_data<Fixnum>(y, start);
+    for (size_t i = 0; i < end - start; ++i)
+      r[i] = nv::checked_fixnum((__int128)xd[i] * yd[i], "vector-multiply", start + i);
+  } break;
+  }
+  return result;
+}
+
+CL_LAMBDA(result x y z start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Store X[i] * Y[i] + Z[i] into RESULT[i] for i from START below END.
+Floats are rounded once, as by C's fma.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp core__vector_fma_range(Array_sp result, Array_sp x, Array_sp y, Array_sp z, size_t start,
+                                         size_t end) {
+  switch (check_operands(start, end, {x, y, z, result})) {
+  case vector_double: run_kernel<nv::Fma, double>(result, x, y, z, 0, start, end); break;
+  case vector_single: run_kernel<nv::Fma, float>(result, x, y, z, 0, start, end); break;
+  case vector_fixnum: {
+    Fixnum *r = vector_data<Fixnum>(result, start), *xd = vector_data<Fixnum>(x, start),
+           *yd = vector_data<Fixnum>(y, start), *zd = vector_data<Fixnum>(z, start);
+    for (size_t i = 0; i < end - start; ++i)
+      r[i] = nv::checked_fixnum((__int128)xd[i] * yd[i] + zd[i], "vector-fma", start + i);
+  } break;
+  }
+  return result;
+}
+
+CL_LAMBDA(result alpha x start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Store ALPHA * X[i] into RESULT[i] for i from START below END.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp core__vector_scale_range(Array_sp result, Number_sp alpha, Array_sp x, size_t start, size_t end) {
+  switch (check_operands(start, end, {x, result})) {
+  case vector_double:
+    run_kernel<nv::Scale, double>(result, x, nil<T_O>(), nil<T_O>(), clasp_to_double(alpha), start, end);
+    break;
+  case vector_single:
+    run_kernel<nv::Scale, float>(result, x, nil<T_O>(), nil<T_O>(), clasp_to_float(alpha), start, end);
+    break;
+  case vector_fixnum: {
+    Fixnum a = fixnum_scalar(alpha);
+    Fixnum *r = vector_data<Fixnum>(result, start), *xd = vector_data<Fixnum>(x, start);
+    for (size_t i = 0; i < end - start; ++i)
+      r[i] = nv::checked_fixnum((__int128)a * xd[i], "vector-scale", start + i);
+  } break;
+  }
+  return result;
+}
+
+CL_LAMBDA(alpha x y start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Replace Y[i] with ALPHA * X[i] + Y[i] for i from START below END, and return Y.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp core__vector_axpy_range(Number_sp alpha, Array_sp x, Array_sp y, size_t start, size_t end) {
+  switch (check_operands(start, end, {x, y})) {
+  case vector_double:
+    run_kernel<nv::Axpy, double>(y, x, y, nil<T_O>(), clasp_to_double(alpha), start, end);
+    break;
+  case vector_single:
+    run_kernel<nv::Axpy, float>(y, x, y, nil<T_O>(), clasp_to_float(alpha), start, end);
+    break;
+  case vector_fixnum: {
+    Fixnum a = fixnum_scalar(alpha);
+    Fixnum *xd = vector_data<Fixnum>(x, start), *yd = vector_data<Fixnum>(y, start);
+    for (size_t i = 0; i < end - start; ++i)
+      yd[i] = nv::checked_fixnum((__int128)a * xd[i] + yd[i], "vector-axpy", start + i);
+  } break;
+  }
+  return y;
+}
+
+/* Reductions. */
+
+CL_LAMBDA(x start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return the sum of X[i] for i from START below END.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Number_sp core__vector_sum_range(Array_sp x, size_t start, size_t end) {
+  switch (check_operands(start, end, {x})) {
+  case vector_double:
+    return clasp_make_double_float(run_kernel<nv::Sum, double>(nil<T_O>(), x, nil<T_O>(), nil<T_O>(), 0, start, end));
+  case vector_single:
+    return clasp_make_single_float(run_kernel<nv::Sum, float>(nil<T_O>(), x, nil<T_O>(), nil<T_O>(), 0, start, end));
+  case vector_fixnum:
+    return nv::fixnum_sum(vector_data<Fixnum>(x, start), NULL, end - start);
+  }
+  UNREACHABLE();
+}
+
+CL_LAMBDA(x y start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return the sum of X[i] * Y[i] for i from START below END.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Number_sp core__vector_dot_range(Array_sp x, Array_sp y, size_t start, size_t end) {
+  switch (check_operands(start, end, {x, y})) {
+  case vector_double:
+    return clasp_make_double_float(run_kernel<nv::Dot, double>(nil<T_O>(), x, y, nil<T_O>(), 0, start, end));
+  case vector_single:
+    return clasp_make_single_float(run_kernel<nv::Dot, float>(nil<T_O>(), x, y, nil<T_O>(), 0, start, end));
+  case vector_fixnum:
+    return nv::fixnum_sum(vector_data<Fixnum>(x, start), vector_data<Fixnum>(y, start), end - start);
+  }
+  UNREACHABLE();
+}
+
+template <bool Max>
+static T_sp vector_extreme(Array_sp x, size_t start, size_t end) {
+  VectorElement element = check_operands(start, end, {x});
+  if (start == end) return nil<T_O>();
+  switch (element) {
+  case vector_double:
+    return clasp_make_double_float(
+        run_kernel<nv::Extreme<Max>, double>(nil<T_O>(), x, nil<T_O>(), nil<T_O>(), 0, start, end));
+  case vector_single:
+    return clasp_make_single_float(
+        run_kernel<nv::Extreme<Max>, float>(nil<T_O>(), x, nil<T_O>(), nil<T_O>(), 0, start, end));
+  case vector_fixnum:
+    return make_fixnum(
+        run_kernel<nv::Extreme<Max>, Fixnum>(nil<T_O>(), x, nil<T_O>(), nil<T_O>(), 0, start, end));
+  }
+  UNREACHABLE();
+}
+
+CL_LAMBDA(x start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return the least X[i] for i from START below END, or NIL if the range
+is empty. The result is unspecified if the range holds a NaN.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__vector_min_range(Array_sp x, size_t start, size_t end) {
+  return vector_extreme<false>(x, start, end);
+}
+
+CL_LAMBDA(x start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return the greatest X[i] for i from START below END, or NIL if the range
+is empty. The result is unspecified if the range holds a NaN.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__vector_max_range(Array_sp x, size_t start, size_t end) {
+  return vector_extreme<true>(x, start, end);
+}
+
+}; // namespace core
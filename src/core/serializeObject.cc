@@ -0,0 +1,793 @@
+/*
+    File: serializeObject.cc
+
+    A compact binary format for Lisp data.
+
+    The encoding borrows the approach of the bytecode FASL loader in
+    loadltv.cc: every object that has identity is allocated and entered into
+    an object table *before* its contents are read, and later occurrences
+    are written as back-references into that table.  This preserves sharing
+    and lets cyclic structure round-trip.  Unlike a FASL, the object count
+    is not known up front, so the table grows as the stream is read and an
+    object can be written without first walking the whole graph.
+
+    Supported: conses, fixnums, bignums, ratios, complexes, single and double
+    floats, characters, symbols (by package and name), packages, arrays of
+    every element type clasp specializes on (specialized arrays are written
+    as raw little-endian data), hash tables with standard tests, and
+    structure instances (by class name).
+*/
+#include <vector>
+#include <clasp/core/core.h>
+#include <clasp/core/ql.h>         // ql::list
+#include <clasp/core/lispStream.h> // I/O
+#include <clasp/core/hashTable.h>  // making hash tables
+#include <clasp/core/hashTableEq.h>
+#include <clasp/core/bignum.h>     // making bignums
+#include <clasp/core/package.h>    // finding packages
+#include <clasp/core/instance.h>   // structure instances
+#include <clasp/core/sequence.h>   // cl__length
+
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "serializeObject.cc writes specialized arrays as native data and assumes a little-endian target"
+#endif
+
+#define SER_MAGIC_0 0x43 // C
+#define SER_MAGIC_1 0x53 // S
+#define SER_MAGIC_2 0x45 // E
+#define SER_MAGIC_3 0x52 // R
+#define SER_VERSION 1
+
+#define SER_OP_NIL 0x01
+#define SER_OP_REF 0x02
+#define SER_OP_UNBOUND 0x03
+#define SER_OP_FIXNUM 0x10
+#define SER_OP_BIGNUM 0x11
+#define SER_OP_RATIO 0x12
+#define SER_OP_COMPLEX 0x13
+#define SER_OP_SINGLE 0x14
+#define SER_OP_DOUBLE 0x15
+#define SER_OP_CHARACTER 0x16
+#define SER_OP_PACKAGE 0x20
+#define SER_OP_INTERN 0x21
+#define SER_OP_SYMBOL 0x22
+#define SER_OP_CONS 0x30
+#define SER_OP_ARRAY 0x31
+#define SER_OP_HASHT 0x32
+#define SER_OP_STRUCTURE 0x33
+
+#define SER_ARRAY_ADJUSTABLE 0x01
+#define SER_ARRAY_FILL_POINTER 0x02
+
+// Output is accumulated and handed to the stream in chunks of this size.
+#define SER_FLUSH_BYTES 65536
+
+// Element types whose storage is written verbatim.
+#define SER_PACKED_ELEMENT_TYPES(X)                                                                                                \
+  X(0x01, cl::_sym_base_char, SimpleBaseString_O)                                                                                  \
+  X(0x02, cl::_sym_character, SimpleCharacterString_O)                                                                             \
+  X(0x03, cl::_sym_single_float, SimpleVector_float_O)                                                                             \
+  X(0x04, cl::_sym_double_float, SimpleVector_double_O)                                                                            \
+  X(0x05, cl::_sym_fixnum, SimpleVector_fixnum_O)                                                                                  \
+  X(0x06, ext::_sym_cl_index, SimpleVector_size_t_O)                                                                               \
+  X(0x10, ext::_sym_byte8, SimpleVector_byte8_t_O)                                                                                 \
+  X(0x11, ext::_sym_byte16, SimpleVector_byte16_t_O)                                                                               \
+  X(0x12, ext::_sym_byte32, SimpleVector_byte32_t_O)                                                                               \
+  X(0x13, ext::_sym_byte64, SimpleVector_byte64_t_O)                                                                               \
+  X(0x18, ext::_sym_integer8, SimpleVector_int8_t_O)                                                                               \
+  X(0x19, ext::_sym_integer16, SimpleVector_int16_t_O)                                                                             \
+  X(0x1a, ext::_sym_integer32, SimpleVector_int32_t_O)                                                                             \
+  X(0x1b, ext::_sym_integer64, SimpleVector_int64_t_O)
+
+// Element types narrower than a byte, packed most significant bits first.
+#define SER_SUB_BYTE_ELEMENT_TYPES(X)                                                                                              \
+  X(0x20, cl::_sym_bit, 1, false)                                                                                                  \
+  X(0x21, ext::_sym_byte2, 2, false)                                                                                               \
+  X(0x22, ext::_sym_byte4, 4, false)                                                                                               \
+  X(0x23, ext::_sym_integer2, 2, true)                                                                                             \
+  X(0x24, ext::_sym_integer4, 4, true)
+
+#define SER_ELEMENT_T 0xff
+
+namespace core {
+
+static_assert(sizeof(mp_limb_t) == 8, "bignum limbs are serialized as 64-bit words");
+
+static uint8_t serialize_element_type_code(T_sp element_type) {
+#define ENCODE_PACKED(CODE, SYM, TYPE)                                                                                             \
+  if (element_type == SYM)                                                                                                         \
+    return CODE;
+#define ENCODE_SUB_BYTE(CODE, SYM, NBITS, SIGNEDP)                                                                                 \
+  if (element_type == SYM)                                                                                                         \
+    return CODE;
+  if (element_type == cl::_sym_T_O)
+    return SER_ELEMENT_T;
+  SER_PACKED_ELEMENT_TYPES(ENCODE_PACKED);
+  SER_SUB_BYTE_ELEMENT_TYPES(ENCODE_SUB_BYTE);
+#undef ENCODE_PACKED
+#undef ENCODE_SUB_BYTE
+  SIMPLE_ERROR("Cannot serialize arrays with element type {}", _rep_(element_type));
+}
+
+static T_sp serialize_element_type(uint8_t code) {
+#define DECODE_PACKED(CODE, SYM, TYPE)                                                                                             \
+  case CODE:                                                                                                                       \
+    return SYM;
+#define DECODE_SUB_BYTE(CODE, SYM, NBITS, SIGNEDP)                                                                                 \
+  case CODE:                                                                                                                       \
+    return SYM;
+  switch (code) {
+  case SER_ELEMENT_T:
+    return cl::_sym_T_O;
+    SER_PACKED_ELEMENT_TYPES(DECODE_PACKED);
+    SER_SUB_BYTE_ELEMENT_TYPES(DECODE_SUB_BYTE);
+  default:
+    SIMPLE_ERROR("Invalid serialized data: unknown array element type code {:02x}", code);
+  }
+#undef DECODE_PACKED
+#undef DECODE_SUB_BYTE
+}
+
+static uint8_t serialize_hash_table_test_code(T_sp test) {
+  if (test == cl::_sym_eq)
+    return 0;
+  if (test == cl::_sym_eql)
+    return 1;
+  if (test == cl::_sym_equal)
+    return 2;
+  if (test == cl::_sym_equalp)
+    return 3;
+  SIMPLE_ERROR("Cannot serialize hash tables with test {}", _rep_(test));
+}
+
+static T_sp serialize_hash_table_test(uint8_t code) {
+  switch (code) {
+  case 0:
+    return cl::_sym_eq;
+  case 1:
+    return cl::_sym_eql;
+  case 2:
+    return cl::_sym_equal;
+  case 3:
+    return cl::_sym_equalp;
+  default:
+    SIMPLE_ERROR("Invalid serialized data: unknown hash table test code {:02x}", code);
+  }
+}
+
+static bool structure_instance_p(T_sp obj) {
+  if (Instance_sp inst = obj.asOrNull<Instance_O>())
+    return inst->_Class->_Class == _lisp->_Roots._TheStructureClass;
+  return false;
+}
+
+struct serializer {
+  T_sp _stream; // nil means accumulate everything in _buffer
+  std::vector<uint8_t> _buffer;
+  HashTableEq_sp _objects;
+  size_t _next_index;
+
+  serializer(T_sp stream) : _stream(stream), _objects(HashTableEq_O::create_default()), _next_index(0) {}
+
+  void flush() {
+    if (_stream.notnilp() && !_buffer.empty()) {
+      clasp_write_byte8(_stream, _buffer.data(), _buffer.size());
+      _buffer.clear();
+    }
+  }
+
+  void write_bytes(const void *data, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    if (_stream.notnilp() && len >= SER_FLUSH_BYTES) {
+      // Large array payloads go straight to the stream.
+      flush();
+      clasp_write_byte8(_stream, const_cast<uint8_t *>(bytes), len);
+      return;
+    }
+    _buffer.insert(_buffer.end(), bytes, bytes + len);
+    if (_stream.notnilp() && _buffer.size() >= SER_FLUSH_BYTES)
+      flush();
+  }
+
+  inline void write_u8(uint8_t byte) {
+    _buffer.push_back(byte);
+    if (_stream.notnilp() && _buffer.size() >= SER_FLUSH_BYTES)
+      flush();
+  }
+
+  void write_uvarint(uint64_t value) {
+    while (value >= 0x80) {
+      write_u8((uint8_t)(value | 0x80));
+      value >>= 7;
+    }
+    write_u8((uint8_t)value);
+  }
+
+  // zigzag encoding keeps small negative numbers short
+  void write_svarint(int64_t value) { write_uvarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63)); }
+
+  void write_f32(float f) { write_bytes(&f, sizeof(f)); }
+
+  void write_f64(double d) { write_bytes(&d, sizeof(d)); }
+
+  void write_raw_string(const std::string &str) {
+    write_uvarint(str.size());
+    write_bytes(str.data(), str.size());
+  }
+
+  void register_object(T_sp obj) { _objects->setf_gethash(obj, clasp_make_fixnum(_next_index++)); }
+
+  // Write a back-reference if OBJ has been written already.
+  bool write_reference(T_sp obj) {
+    T_sp index = _objects->gethash(obj, nil<T_O>());
+    if (!index.fixnump())
+      return false;
+    write_u8(SER_OP_REF);
+    write_uvarint(index.unsafe_fixnum());
+    return true;
+  }
+
+  void write_header() {
+    write_u8(SER_MAGIC_0);
+    write_u8(SER_MAGIC_1);
+    write_u8(SER_MAGIC_2);
+    write_u8(SER_MAGIC_3);
+    write_u8(SER_VERSION);
+  }
+
+  void write_bignum(Bignum_sp big) {
+    mp_size_t len = big->length();
+    write_u8(SER_OP_BIGNUM);
+    write_svarint(len);
+    write_bytes(big->limbs(), std::abs(len) * sizeof(mp_limb_t));
+  }
+
+  // The cdr chain is followed iteratively so long lists do not recurse.
+  void write_cons(Cons_sp cons) {
+    write_u8(SER_OP_CONS);
+    register_object(cons);
+    write_object(cons->ocar());
+    T_sp rest = cons->cdr();
+    while (rest.consp() && _objects->gethash(rest, nil<T_O>()).nilp()) {
+      Cons_sp next = gc::As_unsafe<Cons_sp>(rest);
+      write_u8(SER_OP_CONS);
+      register_object(next);
+      write_object(next->ocar());
+      rest = next->cdr();
+    }
+    write_object(rest);
+  }
+
+  void write_symbol(Symbol_sp sym) {
+    T_sp pkg = sym->homePackage();
+    if (pkg.nilp()) {
+      write_u8(SER_OP_SYMBOL);
+      register_object(sym);
+      write_object(sym->symbolName());
+      return;
+    }
+    write_u8(SER_OP_INTERN);
+    register_object(sym);
+    write_object(pkg);
+    write_object(sym->symbolName());
+  }
+
+  void write_package(Package_sp pkg) {
+    write_u8(SER_OP_PACKAGE);
+    register_object(pkg);
+    write_raw_string(pkg->getName());
+  }
+
+  template <typename SimpleType> void write_packed(AbstractSimpleVector_sp bsv, size_t start, size_t count) {
+    if (count == 0)
+      return;
+    gc::smart_ptr<SimpleType> sv = gc::As<gc::smart_ptr<SimpleType>>(bsv);
+    write_bytes(&(*sv)[start], count * sizeof(typename SimpleType::value_type));
+  }
+
+  void write_sub_byte(AbstractSimpleVector_sp bsv, size_t start, size_t count, size_t nbits) {
+    size_t perbyte = 8 / nbits;
+    uint8_t mask = (1 << nbits) - 1;
+    for (size_t i = 0; i < count; i += perbyte) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < perbyte && i + j < count; ++j) {
+        uint8_t bits = (uint8_t)(bsv->rowMajorAref(start + i + j).unsafe_fixnum()) & mask;
+        byte |= bits << (nbits * (perbyte - j - 1));
+      }
+      write_u8(byte);
+    }
+  }
+
+  void write_array(Array_sp array) {
+    uint8_t code = serialize_element_type_code(array->element_type());
+    size_t rank = array->rank();
+    uint8_t flags = 0;
+    if (array->adjustableArrayP())
+      flags |= SER_ARRAY_ADJUSTABLE;
+    if (array->arrayHasFillPointerP())
+      flags |= SER_ARRAY_FILL_POINTER;
+    write_u8(SER_OP_ARRAY);
+    register_object(array);
+    write_u8(code);
+    write_u8(flags);
+    write_uvarint(rank);
+    size_t count;
+    if (rank == 1) {
+      // Only the active elements are written, as the printer would.
+      count = array->length();
+      write_uvarint(count);
+    } else {
+      for (size_t axis = 0; axis < rank; ++axis)
+        write_uvarint(array->arrayDimension(axis));
+      count = array->arrayTotalSize();
+    }
+    AbstractSimpleVector_sp bsv;
+    size_t start, end;
+    array->asAbstractSimpleVectorRange(bsv, start, end);
+#define WRITE_PACKED(CODE, SYM, TYPE)                                                                                              \
+  case CODE:                                                                                                                       \
+    write_packed<TYPE>(bsv, start, count);                                                                                         \
+    break;
+#define WRITE_SUB_BYTE(CODE, SYM, NBITS, SIGNEDP)                                                                                  \
+  case CODE:                                                                                                                       \
+    write_sub_byte(bsv, start, count, NBITS);                                                                                      \
+    break;
+    switch (code) {
+    case SER_ELEMENT_T: {
+      SimpleVector_sp sv = gc::As<SimpleVector_sp>(bsv);
+      for (size_t i = 0; i < count; ++i)
+        write_object((*sv)[start + i]);
+    } break;
+      SER_PACKED_ELEMENT_TYPES(WRITE_PACKED);
+      SER_SUB_BYTE_ELEMENT_TYPES(WRITE_SUB_BYTE);
+    default:
+      UNREACHABLE();
+    }
+#undef WRITE_PACKED
+#undef WRITE_SUB_BYTE
+  }
+
+  void write_hash_table(HashTable_sp table) {
+    uint8_t code = serialize_hash_table_test_code(table->hash_table_test());
+    // Snapshot the entries so no table lock is held while writing.
+    gctools::Vec0<T_sp> entries;
+    table->maphash([&entries](T_sp key, T_sp value) {
+      entries.push_back(key);
+      entries.push_back(value);
+    });
+    write_u8(SER_OP_HASHT);
+    register_object(table);
+    write_u8(code);
+    write_uvarint(entries.size() / 2);
+    for (size_t i = 0; i < entries.size(); ++i)
+      write_object(entries[i]);
+  }
+
+  void write_structure(Instance_sp inst) {
+    write_u8(SER_OP_STRUCTURE);
+    register_object(inst);
+    write_object(inst->_Class->_className());
+    size_t nslots = inst->numberOfSlots();
+    write_uvarint(nslots);
+    for (size_t i = 0; i < nslots; ++i)
+      write_object(inst->instanceRef(i));
+  }
+
+  void write_object(T_sp obj) {
+    if (obj.nilp()) {
+      write_u8(SER_OP_NIL);
+    } else if (obj.fixnump()) {
+      write_u8(SER_OP_FIXNUM);
+      write_svarint(obj.unsafe_fixnum());
+    } else if (obj.characterp()) {
+      write_u8(SER_OP_CHARACTER);
+      write_uvarint(obj.unsafe_character());
+    } else if (obj.single_floatp()) {
+      write_u8(SER_OP_SINGLE);
+      write_f32(obj.unsafe_single_float());
+    } else if (obj.unboundp()) {
+      write_u8(SER_OP_UNBOUND);
+    } else if (obj.consp()) {
+      if (!write_reference(obj))
+        write_cons(gc::As_unsafe<Cons_sp>(obj));
+    } else if (gc::IsA<DoubleFloat_sp>(obj)) {
+      write_u8(SER_OP_DOUBLE);
+      write_f64(gc::As_unsafe<DoubleFloat_sp>(obj)->get());
+    } else if (gc::IsA<Bignum_sp>(obj)) {
+      write_bignum(gc::As_unsafe<Bignum_sp>(obj));
+    } else if (gc::IsA<Ratio_sp>(obj)) {
+      Ratio_sp ratio = gc::As_unsafe<Ratio_sp>(obj);
+      write_u8(SER_OP_RATIO);
+      write_object(ratio->numerator());
+      write_object(ratio->denominator());
+    } else if (gc::IsA<Complex_sp>(obj)) {
+      Complex_sp complex = gc::As_unsafe<Complex_sp>(obj);
+      write_u8(SER_OP_COMPLEX);
+      write_object(complex->real());
+      write_object(complex->imaginary());
+    } else if (write_reference(obj)) {
+      return;
+    } else if (gc::IsA<Symbol_sp>(obj)) {
+      write_symbol(gc::As_unsafe<Symbol_sp>(obj));
+    } else if (gc::IsA<Package_sp>(obj)) {
+      write_package(gc::As_unsafe<Package_sp>(obj));
+    } else if (gc::IsA<Array_sp>(obj)) {
+      write_array(gc::As_unsafe<Array_sp>(obj));
+    } else if (gc::IsA<HashTable_sp>(obj)) {
+      write_hash_table(gc::As_unsafe<HashTable_sp>(obj));
+    } else if (structure_instance_p(obj)) {
+      write_structure(gc::As_unsafe<Instance_sp>(obj));
+    } else {
+      SIMPLE_ERROR("Cannot serialize {}", _rep_(obj));
+    }
+  }
+
+  void serialize(T_sp object) {
+    write_header();
+    write_object(object);
+    flush();
+  }
+};
+
+struct deserializer {
+  T_sp _stream; // nil means read from _octets
+  T_sp _octets;
+  size_t _pos;
+  gctools::Vec0<T_sp> _objects;
+
+  deserializer(T_sp stream) : _stream(stream), _octets(nil<T_O>()), _pos(0) {}
+  deserializer(SimpleVector_byte8_t_sp octets, size_t start) : _stream(nil<T_O>()), _octets(octets), _pos(start) {}
+
+  // Returns the number of bytes actually available, up to LEN.
+  size_t read_some(void *dest, size_t len) {
+    if (_stream.notnilp())
+      return clasp_read_byte8(_stream, static_cast<unsigned char *>(dest), len);
+    SimpleVector_byte8_t_sp octets = gc::As_unsafe<SimpleVector_byte8_t_sp>(_octets);
+    size_t avail = std::min(len, octets->length() - _pos);
+    if (avail > 0)
+      memcpy(dest, &(*octets)[_pos], avail);
+    _pos += avail;
+    return avail;
+  }
+
+  void read_bytes(void *dest, size_t len) {
+    if (read_some(dest, len) != len) {
+      if (_stream.notnilp())
+        ERROR_END_OF_FILE(_stream);
+      SIMPLE_ERROR("Invalid serialized data: unexpected end of octet vector");
+    }
+  }
+
+  inline uint8_t read_u8() {
+    uint8_t byte;
+    read_bytes(&byte, 1);
+    return byte;
+  }
+
+  uint64_t read_uvarint() {
+    uint64_t result = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = read_u8();
+      result |= (uint64_t)(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+        return result;
+    }
+    SIMPLE_ERROR("Invalid serialized data: overlong integer encoding");
+  }
+
+  int64_t read_svarint() {
+    uint64_t zigzag = read_uvarint();
+    return (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  }
+
+  float read_f32() {
+    float f;
+    read_bytes(&f, sizeof(f));
+    return f;
+  }
+
+  double read_f64() {
+    double d;
+    read_bytes(&d, sizeof(d));
+    return d;
+  }
+
+  std::string read_raw_string() {
+    std::string str(read_uvarint(), '\0');
+    read_bytes(str.data(), str.size());
+    return str;
+  }
+
+  void register_object(T_sp obj) { _objects.push_back(obj); }
+
+  T_sp get_object(size_t index) {
+    if (index >= _objects.size())
+      SIMPLE_ERROR("Invalid serialized data: reference to object #{} which has not been read", index);
+    return _objects[index];
+  }
+
+  // Returns false if the stream is at end of file before the header.
+  bool read_header(bool eof_error_p) {
+    uint8_t header[5];
+    size_t got = read_some(header, 1);
+    if (got == 0 && !eof_error_p)
+      return false;
+    if (got == 0 || read_some(header + 1, 4) != 4) {
+      if (_stream.notnilp())
+        ERROR_END_OF_FILE(_stream);
+      SIMPLE_ERROR("Invalid serialized data: unexpected end of octet vector");
+    }
+    if (header[0] != SER_MAGIC_0 || header[1] != SER_MAGIC_1 || header[2] != SER_MAGIC_2 || header[3] != SER_MAGIC_3)
+      SIMPLE_ERROR("Invalid serialized data: incorrect magic number {:02x}{:02x}{:02x}{:02x}", header[0], header[1], header[2],
+                   header[3]);
+    if (header[4] != SER_VERSION)
+      SIMPLE_ERROR("Serialized data version {} is not supported by this reader", header[4]);
+    return true;
+  }
+
+  T_sp read_bignum() {
+    int64_t ssize = read_svarint();
+    std::vector<mp_limb_t> limbs(std::abs(ssize));
+    read_bytes(limbs.data(), limbs.size() * sizeof(mp_limb_t));
+    return bignum_result(ssize, limbs.data());
+  }
+
+  T_sp read_list() {
+    Cons_sp head = Cons_O::create(nil<T_O>(), nil<T_O>());
+    register_object(head);
+    head->rplaca(read_object());
+    Cons_sp tail = head;
+    while (true) {
+      uint8_t op = read_u8();
+      if (op != SER_OP_CONS) {
+        tail->rplacd(read_object_op(op));
+        return head;
+      }
+      Cons_sp next = Cons_O::create(nil<T_O>(), nil<T_O>());
+      register_object(next);
+      tail->rplacd(next);
+      next->rplaca(read_object());
+      tail = next;
+    }
+  }
+
+  T_sp read_package() {
+    size_t index = _objects.size();
+    register_object(unbound<T_O>());
+    std::string name = read_raw_string();
+    T_sp pkg = _lisp->findPackage(name);
+    if (pkg.nilp())
+      SIMPLE_ERROR("Cannot deserialize symbols in package {}, which does not exist", name);
+    _objects[index] = pkg;
+    return pkg;
+  }
+
+  // Symbols are registered before their package and name are read,
+  // matching the order in which the writer registered them.
+  T_sp read_intern() {
+    size_t index = _objects.size();
+    register_object(unbound<T_O>());
+    Package_sp pkg = gc::As<Package_sp>(read_object());
+    SimpleString_sp name = gc::As<SimpleString_sp>(read_object());
+    T_sp sym = pkg->intern(name);
+    _objects[index] = sym;
+    return sym;
+  }
+
+  T_sp read_symbol() {
+    size_t index = _objects.size();
+    register_object(unbound<T_O>());
+    SimpleString_sp name = gc::As<SimpleString_sp>(read_object());
+    T_sp sym = Symbol_O::create(name);
+    _objects[index] = sym;
+    return sym;
+  }
+
+  template <typename SimpleType> void read_packed(AbstractSimpleVector_sp bsv, size_t start, size_t count) {
+    if (count == 0)
+      return;
+    gc::smart_ptr<SimpleType> sv = gc::As<gc::smart_ptr<SimpleType>>(bsv);
+    read_bytes(&(*sv)[start], count * sizeof(typename SimpleType::value_type));
+  }
+
+  void read_sub_byte(AbstractSimpleVector_sp bsv, size_t start, size_t count, size_t nbits, bool signedp) {
+    size_t perbyte = 8 / nbits;
+    uint8_t mask = (1 << nbits) - 1;
+    for (size_t i = 0; i < count; i += perbyte) {
+      uint8_t byte = read_u8();
+      for (size_t j = 0; j < perbyte && i + j < count; ++j) {
+        Fixnum bits = (byte >> (nbits * (perbyte - j - 1))) & mask;
+        if (signedp && (bits & (1 << (nbits - 1))))
+          bits -= (1 << nbits);
+        bsv->rowMajorAset(start + i + j, clasp_make_fixnum(bits));
+      }
+    }
+  }
+
+  T_sp read_array() {
+    uint8_t code = read_u8();
+    uint8_t flags = read_u8();
+    size_t rank = read_uvarint();
+    T_sp element_type = serialize_element_type(code);
+    bool adjustable = flags & SER_ARRAY_ADJUSTABLE;
+    Array_sp array;
+    size_t count;
+    if (rank == 1) {
+      count = read_uvarint();
+      T_sp fill_pointer = (flags & SER_ARRAY_FILL_POINTER) ? T_sp(clasp_make_fixnum(count)) : nil<T_O>();
+      array = core__make_vector(element_type, count, adjustable, fill_pointer);
+    } else {
+      ql::list dims;
+      count = 1;
+      for (size_t axis = 0; axis < rank; ++axis) {
+        size_t dim = read_uvarint();
+        dims << clasp_make_fixnum(dim);
+        count *= dim;
+      }
+      array = core__make_mdarray(dims.cons(), element_type, adjustable);
+    }
+    register_object(array);
+    AbstractSimpleVector_sp bsv;
+    size_t start, end;
+    array->asAbstractSimpleVectorRange(bsv, start, end);
+#define READ_PACKED(CODE, SYM, TYPE)                                                                                               \
+  case CODE:                                                                                                                       \
+    read_packed<TYPE>(bsv, start, count);                                                                                          \
+    break;
+#define READ_SUB_BYTE(CODE, SYM, NBITS, SIGNEDP)                                                                                   \
+  case CODE:                                                                                                                       \
+    read_sub_byte(bsv, start, count, NBITS, SIGNEDP);                                                                              \
+    break;
+    switch (code) {
+    case SER_ELEMENT_T: {
+      SimpleVector_sp sv = gc::As<SimpleVector_sp>(bsv);
+      for (size_t i = 0; i < count; ++i)
+        (*sv)[start + i] = read_object();
+    } break;
+      SER_PACKED_ELEMENT_TYPES(READ_PACKED);
+      SER_SUB_BYTE_ELEMENT_TYPES(READ_SUB_BYTE);
+    default:
+      UNREACHABLE();
+    }
+#undef READ_PACKED
+#undef READ_SUB_BYTE
+    return array;
+  }
+
+  // Entries are added as they are read, so a key that (circularly) contains
+  // an object still being read is hashed before that object is complete.
+  T_sp read_hash_table() {
+    T_sp test = serialize_hash_table_test(read_u8());
+    size_t count = read_uvarint();
+    HashTableBase_sp table =
+        gc::As<HashTableBase_sp>(cl__make_hash_table(test, clasp_make_fixnum(count), clasp_make_single_float(2.0),
+                                                     clasp_make_single_float(0.7), nil<T_O>(), nil<T_O>(), nil<T_O>(), nil<T_O>()));
+    register_object(table);
+    for (size_t i = 0; i < count; ++i) {
+      T_sp key = read_object();
+      T_sp value = read_object();
+      table->hash_table_setf_gethash(key, value);
+    }
+    return table;
+  }
+
+  T_sp read_structure() {
+    size_t index = _objects.size();
+    register_object(unbound<T_O>());
+    Symbol_sp name = gc::As<Symbol_sp>(read_object());
+    size_t nslots = read_uvarint();
+    Instance_sp cl = gc::As<Instance_sp>(cl__find_class(name, true, nil<T_O>()));
+    if (cl->_Class != _lisp->_Roots._TheStructureClass)
+      SIMPLE_ERROR("Cannot deserialize a structure of class {}, which is not a structure class", _rep_(name));
+    if (cl__length(cl->slots()) != nslots)
+      SIMPLE_ERROR("Cannot deserialize a structure of class {}: it was written with {} slots but now has {}", _rep_(name),
+                   nslots, cl__length(cl->slots()));
+    auto inst = gctools::GC<Instance_O>::allocate(cl);
+    inst->initializeSlots(cl->CLASS_stamp_for_instances(), cl->slots(), nslots);
+    _objects[index] = inst;
+    for (size_t i = 0; i < nslots; ++i)
+      inst->instanceSet(i, read_object());
+    return inst;
+  }
+
+  T_sp read_object_op(uint8_t op) {
+    switch (op) {
+    case SER_OP_NIL:
+      return nil<T_O>();
+    case SER_OP_REF:
+      return get_object(read_uvarint());
+    case SER_OP_UNBOUND:
+      return unbound<T_O>();
+    case SER_OP_FIXNUM:
+      return clasp_make_fixnum(read_svarint());
+    case SER_OP_BIGNUM:
+      return read_bignum();
+    case SER_OP_RATIO: {
+      Integer_sp num = gc::As<Integer_sp>(read_object());
+      Integer_sp den = gc::As<Integer_sp>(read_object());
+      return contagion_div(num, den);
+    }
+    case SER_OP_COMPLEX: {
+      Real_sp real = gc::As<Real_sp>(read_object());
+      Real_sp imag = gc::As<Real_sp>(read_object());
+      return clasp_make_complex(real, imag);
+    }
+    case SER_OP_SINGLE:
+      return clasp_make_single_float(read_f32());
+    case SER_OP_DOUBLE:
+      return clasp_make_double_float(read_f64());
+    case SER_OP_CHARACTER:
+      return clasp_make_character(read_uvarint());
+    case SER_OP_PACKAGE:
+      return read_package();
+    case SER_OP_INTERN:
+      return read_intern();
+    case SER_OP_SYMBOL:
+      return read_symbol();
+    case SER_OP_CONS:
+      return read_list();
+    case SER_OP_ARRAY:
+      return read_array();
+    case SER_OP_HASHT:
+      return read_hash_table();
+    case SER_OP_STRUCTURE:
+      return read_structure();
+    default:
+      SIMPLE_ERROR("Invalid serialized data: unknown opcode {:02x}", op);
+    }
+  }
+
+  T_sp read_object() { return read_object_op(read_u8()); }
+
+  T_sp deserialize() {
+    T_sp result = read_object();
+    if (result.unboundp())
+      SIMPLE_ERROR("Invalid serialized data: unbound marker outside of a structure slot");
+    return result;
+  }
+};
+
+CL_LAMBDA(object stream);
+CL_DOCSTRING(R"dx(Write OBJECT to the binary output STREAM in clasp's compact serialization format,
+preserving shared and circular structure. Returns OBJECT. See DESERIALIZE-OBJECT.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp ext__serialize_object(T_sp object, T_sp stream) {
+  serializer writer(stream);
+  writer.serialize(object);
+  return object;
+}
+
+CL_LAMBDA(stream &optional (eof-error-p t) eof-value);
+CL_DOCSTRING(R"dx(Read one object written by SERIALIZE-OBJECT from the binary input STREAM.
+Objects can be read back one at a time from a stream holding several.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp ext__deserialize_object(T_sp stream, bool eof_error_p, T_sp eof_value) {
+  deserializer reader(stream);
+  if (!reader.read_header(eof_error_p))
+    return eof_value;
+  return reader.deserialize();
+}
+
+CL_LAMBDA(object);
+CL_DOCSTRING(R"dx(Return a (SIMPLE-ARRAY (UNSIGNED-BYTE 8) (*)) holding OBJECT in the format written by SERIALIZE-OBJECT.)dx");
+DOCGROUP(clasp);
+CL_DEFUN SimpleVector_byte8_t_sp ext__serialize_to_octets(T_sp object) {
+  serializer writer(nil<T_O>());
+  writer.serialize(object);
+  return SimpleVector_byte8_t_O::make(writer._buffer.size(), 0, false, writer._buffer.size(), writer._buffer.data());
+}
+
+CL_LAMBDA(octets &optional (start 0));
+CL_DOCSTRING(R"dx(Read an object written by SERIALIZE-TO-OCTETS from OCTETS beginning at START.
+Returns the object and the index just past its encoding.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_mv ext__deserialize_from_octets(SimpleVector_byte8_t_sp octets, size_t start) {
+  if (start > octets->length())
+    SIMPLE_ERROR("Start index {} is beyond the end of the octet vector of length {}", start, octets->length());
+  deserializer reader(octets, start);
+  reader.read_header(true);
+  T_sp result = reader.deserialize();
+  return Values(result, clasp_make_fixnum(reader._pos));
+}
+
+}; // namespace core
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <array>
 #include <clasp/core/foundation.h>
 #include <clasp/core/corePackage.h>
 #include <clasp/core/bformat.h>
@@ -203,35 +204,195 @@ StringCharPointer& operator++() {
 };
 
 
-template <typename T1, typename T2>
-bool template_string_equalp_bool(const T1& string1, const T2& string2, size_t start1, size_t end1, size_t start2, size_t end2) {
-  StringCharPointer<T1> cp1(&string1,start1);
-  StringCharPointer<T2> cp2(&string2,start2);
-  size_t num1 = end1 - start1;
-  size_t num2 = end2 - start2;
-  while (1) {
-    if (num1 == 0)
-      goto END_STRING1;
-    if (num2 == 0)
-      goto END_STRING2;
-    if ((char_upcase(static_cast<claspCharacter>(*cp1)) != char_upcase(static_cast<claspCharacter>(*cp2))))
-      goto RETURN_FALSE;
-    --num1;
-    --num2;
-    ++cp1;
-    ++cp2;
+/* String search and case-insensitive comparison on raw character storage.
+ * Base strings hold claspChar and character strings claspCharacter, and every
+ * function here is a template over both, so mixed pairs need no conversion.
+ *
+ * Searching uses the Two-Way algorithm of Crochemore and Perrin, which is
+ * linear in the worst case and needs no allocation, with a Horspool-style
+ * skip on the character under the needle's last position. When both strings
+ * are base strings and case matters, memchr (vectorized in every libc we
+ * care about) finds candidate positions for that last character instead.
+ * Case-insensitive searches fold both sides with char_upcase, as CHAR-EQUAL
+ * does, through a table for the Latin-1 range.
+ */
+namespace string_search {
+
+struct SameCase {
+  claspCharacter operator()(claspCharacter c) const { return c; }
+};
+
+struct FoldCase {
+  const claspCharacter* _latin1;
+  FoldCase() : _latin1(table()) {}
+  claspCharacter operator()(claspCharacter c) const { return (c < 256) ? _latin1[c] : char_upcase(c); }
+  static const claspCharacter* table() {
+    static const std::array<claspCharacter, 256> upcase = []() {
+      std::array<claspCharacter, 256> t;
+      for (claspCharacter c = 0; c < 256; ++c) t[c] = char_upcase(c);
+      return t;
+    }();
+    return upcase.data();
   }
- END_STRING1:
-  if (num2 == 0)
-    goto RETURN_TRUE;
-  goto RETURN_FALSE;
- END_STRING2:
- RETURN_FALSE:
-  return false;
- RETURN_TRUE:
+};
+
+// Index of the first (or last) C in H[0, hlen), or -1.
+template <typename H, typename Fold>
+ptrdiff_t find_char(claspCharacter c, const H* h, size_t hlen, bool from_end, Fold fold) {
+  if constexpr (std::is_same_v<H, claspChar> && std::is_same_v<Fold, SameCase>) {
+    if (c > 255) return -1;
+    if (!from_end) {
+      const void* q = memchr(h, c, hlen);
+      return q ? (const H*)q - h : -1;
+    }
+  }
+  c = fold(c);
+  if (from_end) {
+    for (size_t i = hlen; i > 0; --i)
+      if (fold(h[i - 1]) == c) return i - 1;
+  } else {
+    for (size_t i = 0; i < hlen; ++i)
+      if (fold(h[i]) == c) return i;
+  }
+  return -1;
+}
+
+// Two-Way search for the folded needle N[0, l), l > 0, in H[0, hlen).
+template <typename N, typename H, typename Fold>
+ptrdiff_t two_way(const N* n, size_t l, const H* h, size_t hlen, Fold fold) {
+  constexpr bool exact_bytes =
+      std::is_same_v<N, claspChar> && std::is_same_v<H, claspChar> && std::is_same_v<Fold, SameCase>;
+  // Skip table on the low byte of each character. Characters that share a low
+  // byte share an entry holding the last of their positions, which only makes
+  // the skips shorter.
+  size_t shift[256];
+  uint64_t present[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < l; ++i) {
+    unsigned key = n[i] & 0xff;
+    present[key / 64] |= uint64_t(1) << (key % 64);
+    shift[key] = i + 1;
+  }
+  // Critical factorization from the maximal suffixes under both orderings.
+  size_t ip, jp, k, p, ms, p0;
+  ip = -1; jp = 0; k = p = 1;
+  while (jp + k < l) {
+    if (n[ip + k] == n[jp + k]) {
+      if (k == p) { jp += p; k = 1; } else ++k;
+    } else if (n[ip + k] > n[jp + k]) {
+      jp += k; k = 1; p = jp - ip;
+    } else {
+      ip = jp++; k = p = 1;
+    }
+  }
+  ms = ip;
+  p0 = p;
+  ip = -1; jp = 0; k = p = 1;
+  while (jp + k < l) {
+    if (n[ip + k] == n[jp + k]) {
+      if (k == p) { jp += p; k = 1; } else ++k;
+    } else if (n[ip + k] < n[jp + k]) {
+      jp += k; k = 1; p = jp - ip;
+    } else {
+      ip = jp++; k = p = 1;
+    }
+  }
+  if (ip + 1 > ms + 1) ms = ip;
+  else p = p0;
+  // For a periodic needle, MEM remembers how much of the left half is known to match.
+  size_t mem0;
+  if (!std::equal(n, n + ms + 1, n + p)) {
+    mem0 = 0;
+    p = std::max(ms, l - ms - 1) + 1;
+  } else mem0 = l - p;
+  size_t mem = 0;
+  size_t pos = 0;
+  for (;;) {
+    if (hlen - pos < l) return -1;
+    if constexpr (exact_bytes) {
+      if (mem == 0 && h[pos + l - 1] != n[l - 1]) {
+        const void* q = memchr(h + pos + l - 1, n[l - 1], hlen - (pos + l - 1));
+        if (!q) return -1;
+        pos = (const H*)q - h - (l - 1);
+      }
+    }
+    unsigned key = fold(h[pos + l - 1]) & 0xff;
+    if (present[key / 64] & (uint64_t(1) << (key % 64))) {
+      k = l - shift[key];
+      if (k) {
+        if (k < mem) k = mem;
+        pos += k;
+        mem = 0;
+        continue;
+      }
+    } else {
+      pos += l;
+      mem = 0;
+      continue;
+    }
+    for (k = std::max(ms + 1, mem); k < l && n[k] == fold(h[pos + k]); ++k)
+      ;
+    if (k < l) {
+      pos += k - ms;
+      mem = 0;
+      continue;
+    }
+    for (k = ms + 1; k > mem && n[k - 1] == fold(h[pos + k - 1]); --k)
+      ;
+    if (k <= mem) return pos;
+    pos += p;
+    mem = mem0;
+  }
+}
+
+// Index of the first occurrence of N[0, l) in H[0, hlen), or -1.
+template <typename N, typename H, typename Fold>
+ptrdiff_t search(const N* n, size_t l, const H* h, size_t hlen, Fold fold) {
+  if (l == 0) return 0;
+  if (l > hlen) return -1;
+  if (l == 1) return find_char(n[0], h, hlen, false, fold);
+  if constexpr (std::is_same_v<Fold, SameCase>) {
+    return two_way(n, l, h, hlen, fold);
+  } else {
+    std::vector<claspCharacter> folded(l);
+    for (size_t i = 0; i < l; ++i) folded[i] = fold(n[i]);
+    return two_way(folded.data(), l, h, hlen, fold);
+  }
+}
+
+// True if A[0, n) and B[0, n) are equal under char_upcase.
+template <typename A, typename B>
+bool equal_folded(const A* a, const B* b, size_t n) {
+  FoldCase fold;
+  size_t i = 0;
+  if constexpr (std::is_same_v<A, B>) {
+    // Skip identical stretches a word at a time.
+    constexpr size_t per_word = sizeof(uint64_t) / sizeof(A);
+    for (; i + per_word <= n; i += per_word) {
+      uint64_t wa, wb;
+      memcpy(&wa, a + i, sizeof(wa));
+      memcpy(&wb, b + i, sizeof(wb));
+      if (wa != wb) break;
+    }
+  }
+  for (; i < n; ++i)
+    if (a[i] != b[i] && fold(a[i]) != fold(b[i])) return false;
   return true;
 }
 
+}; // namespace string_search
+
+template <typename T>
+static inline const typename T::simple_element_type* string_data(const T& string, size_t start) {
+  return (const typename T::simple_element_type*)string.rowMajorAddressOfElement_(start);
+}
+
+template <typename T1, typename T2>
+bool template_string_equalp_bool(const T1& string1, const T2& string2, size_t start1, size_t end1, size_t start2, size_t end2) {
+  size_t num = end1 - start1;
+  if (num != end2 - start2) return false;
+  return string_search::equal_folded(string_data(string1, start1), string_data(string2, start2), num);
+}
+
 
 
 
@@ -432,31 +593,9 @@ T_sp template_string_GE_(const T1& string1, const T2& string2, size_t start1, si
 /*! bounding index designator range from 0 to the end of each string */
 template <typename T1, typename T2>
 T_sp template_string_equal(const T1& string1, const T2& string2, size_t start1, size_t end1, size_t start2, size_t end2) {
-  StringCharPointer<T1> cp1(&string1,start1);
-  StringCharPointer<T2> cp2(&string2,start2);
-  size_t num1 = end1 - start1;
-  size_t num2 = end2 - start2;
-  while (1) {
-    if (num1 == 0)
-      goto END_STRING1;
-    if (num2 == 0)
-      goto END_STRING2;
-    if ((char_upcase(static_cast<claspCharacter>(*cp1)) != char_upcase(static_cast<claspCharacter>(*cp2))))
-      goto RETURN_FALSE;
-    --num1;
-    --num2;
-    ++cp1;
-    ++cp2;
-  }
- END_STRING1:
-  if (num2 == 0)
-    goto RETURN_TRUE;
-  goto RETURN_FALSE;
- END_STRING2:
- RETURN_FALSE:
+  if (template_string_equalp_bool(string1, string2, start1, end1, start2, end2))
+    return _lisp->_true();
   return nil<T_O>();
- RETURN_TRUE:
-  return _lisp->_true();
 }
 
 /*! bounding index designator range from 0 to the end of each string */
@@ -1060,6 +1199,9 @@ cl_index fsmInteger(mpz_class &result, cl_index &numDigits, bool &sawJunk, Strin
   cl_index sign = 1;
   result = 0;
   numDigits = 0;
+  // The digits are converted all at once at the end, where GMP uses a
+  // divide and conquer algorithm, rather than multiplying in one at a time.
+  std::string digits;
   cl_index cur = istart;
   while (1) {
     claspCharacter c = clasp_as_claspCharacter(gc::As_unsafe<Character_sp>(str->rowMajorAref(cur)));
@@ -1085,7 +1227,7 @@ cl_index fsmInteger(mpz_class &result, cl_index &numDigits, bool &sawJunk, Strin
           state = ijunk;
           break;
         }
-        result = result * GMP_LONG(radix) + GMP_LONG(idigit);
+        digits.push_back((char)c);
         ++numDigits;
         state = inum;
         break;
@@ -1110,7 +1252,7 @@ cl_index fsmInteger(mpz_class &result, cl_index &numDigits, bool &sawJunk, Strin
           state = ijunk;
           break;
         }
-        result = result * GMP_LONG(radix) + GMP_LONG(idigit);
+        digits.push_back((char)c);
         ++numDigits;
         state = inum;
         break;
@@ -1139,6 +1281,8 @@ cl_index fsmInteger(mpz_class &result, cl_index &numDigits, bool &sawJunk, Strin
       break;
   }
   sawJunk = (state == ijunk);
+  if (numDigits > 0)
+    mpz_set_str(result.get_mpz_t(), digits.c_str(), radix);
   if (sign < 0) {
     mpz_class nresult;
     mpz_neg(nresult.get_mpz_t(), result.get_mpz_t());
@@ -1475,17 +1619,22 @@ CL_DEFUN T_sp core__base_string_concatenate(Vaslist_sp vargs) {
 template <typename T1,typename T2>
 T_sp template_search_string(const T1& sub, const T2& outer, size_t sub_start, size_t sub_end, size_t outer_start, size_t outer_end)
 {
-  // The std::search convention is reversed -->  std::search(outer,sub,...)
-  const typename T2::simple_element_type* startp = (const typename T2::simple_element_type*)outer.rowMajorAddressOfElement_(0); // &outer[0];
-  const typename T2::simple_element_type* cps = (const typename T2::simple_element_type*)outer.rowMajorAddressOfElement_(outer_start); //&outer[outer_start];
-  const typename T2::simple_element_type* cpe = (const typename T2::simple_element_type*)outer.rowMajorAddressOfElement_(outer_end);
-  const typename T1::simple_element_type* s_cps = (const typename T1::simple_element_type*)sub.rowMajorAddressOfElement_(sub_start); //&sub[sub_start];
-  const typename T1::simple_element_type* s_cpe = (const typename T1::simple_element_type*)sub.rowMajorAddressOfElement_(sub_end);
-  const typename T2::simple_element_type* pos = std::search(cps,cpe,s_cps,s_cpe);
-  if (pos == cpe ) return nil<T_O>();
-  // this should return the absolute position starting from 0, not relative to outer_start
-  //now that I understood this in pointer arithmethic, compare to the beginning of the string, e.g. index 0
-  return clasp_make_fixnum(pos-startp);
+  ptrdiff_t pos = string_search::search(string_data(sub, sub_start), sub_end - sub_start,
+                                        string_data(outer, outer_start), outer_end - outer_start,
+                                        string_search::SameCase());
+  if (pos < 0) return nil<T_O>();
+  // The position is relative to the start of OUTER, not to OUTER_START.
+  return clasp_make_fixnum(outer_start + pos);
+}
+
+template <typename T1,typename T2>
+T_sp template_search_string_equal(const T1& sub, const T2& outer, size_t sub_start, size_t sub_end, size_t outer_start, size_t outer_end)
+{
+  ptrdiff_t pos = string_search::search(string_data(sub, sub_start), sub_end - sub_start,
+                                        string_data(outer, outer_start), outer_end - outer_start,
+                                        string_search::FoldCase());
+  if (pos < 0) return nil<T_O>();
+  return clasp_make_fixnum(outer_start + pos);
 }
 
 SYMBOL_EXPORT_SC_(CorePkg,search_string);
@@ -1496,6 +1645,35 @@ CL_DEFUN T_sp core__search_string(String_sp sub, size_t sub_start, size_t sub_en
   TEMPLATE_STRING_DISPATCHER(sub,outer,template_search_string,sub_start,sub_end,outer_start,outer_end);
 };
 
+CL_LAMBDA(sub sub_start sub_end outer outer_start outer_end);
+CL_DOCSTRING(R"dx(Search for the first occurrence of SUB in OUTER, comparing characters with CHAR-EQUAL.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__search_string_equal(String_sp sub, size_t sub_start, size_t sub_end, String_sp outer, size_t outer_start, size_t outer_end) {
+  TEMPLATE_STRING_DISPATCHER(sub,outer,template_search_string_equal,sub_start,sub_end,outer_start,outer_end);
+};
+
+CL_LAMBDA(char string start end from_end case_insensitive);
+CL_DOCSTRING(R"dx(Return the index of the first (or with FROM-END, the last) CHAR in STRING between
+START and END, comparing with CHAR-EQUAL if CASE-INSENSITIVE and with CHAR= otherwise, or NIL.)dx");
+DOCGROUP(clasp);
+CL_DEFUN T_sp core__search_char(Character_sp chr, String_sp string, size_t start, size_t end, bool from_end, bool case_insensitive) {
+  if (start > end || end > string->arrayTotalSize())
+    SIMPLE_ERROR("Invalid range {} to {} for string search", start, end);
+  claspCharacter c = chr.unsafe_character();
+  ptrdiff_t pos;
+  if (string->element_type() == cl::_sym_base_char) {
+    const claspChar* data = (const claspChar*)string->rowMajorAddressOfElement_(start);
+    pos = case_insensitive ? string_search::find_char(c, data, end - start, from_end, string_search::FoldCase())
+                           : string_search::find_char(c, data, end - start, from_end, string_search::SameCase());
+  } else {
+    const claspCharacter* data = (const claspCharacter*)string->rowMajorAddressOfElement_(start);
+    pos = case_insensitive ? string_search::find_char(c, data, end - start, from_end, string_search::FoldCase())
+                           : string_search::find_char(c, data, end - start, from_end, string_search::SameCase());
+  }
+  if (pos < 0) return nil<T_O>();
+  return clasp_make_fixnum(start + pos);
+};
+
 
 CL_LISPIFY_NAME("core:split");
 DOCGROUP(clasp);
@@ -25,6 +25,12 @@ typedef int mode_t;
 #include <sys/types.h>
 
 #include <pwd.h>
+#ifndef _MSC_VER
+#include <spawn.h>
+#endif
+#ifdef __APPLE__
+#include <crt_externs.h>
+#endif
 
 #if defined( _TARGET_OS_LINUX) || defined( _TARGET_OS_FREEBSD)
 #include <unistd.h>
@@ -80,6 +86,17 @@ namespace core {
 # undef environ
 #endif
 
+#if !defined(ECL_MS_WINDOWS_HOST) && !defined(NACL)
+/* Our own environment, for children run with :ENVIRON :DEFAULT. Several
+   functions below have a parameter named environ, hence the wrapper. */
+#ifdef __APPLE__
+static char **clasp_environ() { return *_NSGetEnviron(); }
+#else
+extern "C" char **environ;
+static char **clasp_environ() { return environ; }
+#endif
+#endif
+
 T_sp
 clasp_system(T_sp cmd_string)
 {
@@ -141,6 +158,9 @@ SYMBOL_EXPORT_SC_(KeywordPkg,stopped);
 SYMBOL_EXPORT_SC_(KeywordPkg,resumed);
 SYMBOL_EXPORT_SC_(KeywordPkg,running);
 
+#if defined(ECL_MS_WINDOWS_HOST)
+/* Only the Windows branch of sys__spawn_subprocess still packs the
+   environment this way; posix_spawn takes an envp vector. */
 static void
 from_list_to_execve_argument(T_sp l, char ***environp)
 {
@@ -171,6 +191,7 @@ from_list_to_execve_argument(T_sp l, char ***environp)
   environ[j] = 0;
   if (environp) *environp = environ;
 }
+#endif
 
 T_mv
 clasp_waitpid(T_sp pid, T_sp wait)
@@ -372,7 +393,7 @@ CL_DEFUN
 T_mv sys__spawn_subprocess(T_sp command, T_sp argv, T_sp environ, T_sp input, T_sp output, T_sp error)
 {
   int parent_write = 0, parent_read = 0, parent_error = 0;
-  int child_pid;
+  int spawn_error = 0;
   T_sp pid;
 
   /* environ is either a list or `:default'. */
@@ -453,11 +474,26 @@ T_mv sys__spawn_subprocess(T_sp command, T_sp argv, T_sp environ, T_sp input, T_
   }
 #elif !defined(NACL) /* All POSIX but NaCL/pNaCL */
   {
-    ql::list ll;
-    ll << nil<T_O>();
     int child_stdin, child_stdout, child_stderr;
-    argv = clasp_nconc( argv, ll.cons() );
-    argv = eval::funcall(cl::_sym_coerce, argv, cl::_sym_vector);
+    /* Build argv and envp here in the parent: posix_spawn runs the child
+       in our address space until it execs (vfork-style on glibc), so
+       nothing is copied and the child never calls malloc. */
+    std::vector<std::string> argv_strings, env_strings;
+    for (T_sp p = argv; p.consp(); p = CONS_CDR(p))
+      argv_strings.push_back(gc::As<String_sp>(CONS_CAR(p))->get_std_string());
+    std::vector<char*> argv_ptrs;
+    for (auto& arg : argv_strings)
+      argv_ptrs.push_back((char*)arg.c_str());
+    argv_ptrs.push_back(NULL);
+    std::vector<char*> env_ptrs;
+    if (environ.consp() || environ.nilp()) {
+      for (T_sp p = environ; p.consp(); p = CONS_CDR(p))
+        env_strings.push_back(gc::As<String_sp>(CONS_CAR(p))->get_std_string());
+      for (auto& var : env_strings)
+        env_ptrs.push_back((char*)var.c_str());
+      env_ptrs.push_back(NULL);
+    }
+    std::string command_string = gc::As<String_sp>(command)->get_std_string();
 
     create_descriptor(input,  kw::_sym_input,  &child_stdin,  &parent_write);
     create_descriptor(output, kw::_sym_output, &child_stdout, &parent_read);
@@ -468,51 +504,50 @@ T_mv sys__spawn_subprocess(T_sp command, T_sp argv, T_sp environ, T_sp input, T_
     else
       create_descriptor(error,  kw::_sym_output, &child_stderr, &parent_error);
 
-    child_pid = fork();
-    if (child_pid == 0) {
-      /* Child */
-      int j;
-      Array_sp argvv = gc::As<Array_sp>(argv);
-      void** argv_ptr = (void**)malloc(sizeof(void*)*cl__length(argvv));
-      for (j = 0; j < cl__length(argvv); j++ ) {
-        T_sp arg = argvv->rowMajorAref(j);
-        if ( arg.nilp() ) {
-          argv_ptr[j] = NULL;
-        } else {
-          std::string str = gc::As<String_sp>(arg)->get_std_string();
-          argv_ptr[j] = (void*)malloc(str.size()+1);
-          char* end = strncpy((char*)argv_ptr[j],(const char*)str.c_str(),str.size());
-          end = end + str.size();
-          *end = '\0';
-        }
-      }
-      if (parent_write) close(parent_write);
-      if (parent_read)  close(parent_read);
-      if (parent_error) close(parent_error);
-
-      dup2(child_stdin,  STDIN_FILENO);
-      dup2(child_stdout, STDOUT_FILENO);
-      dup2(child_stderr, STDERR_FILENO);
-
-      if (environ.consp() || environ.nilp()) {
-        char **pstrings;
-        from_list_to_execve_argument(environ, &pstrings);
-        execve((char*)gc::As<String_sp>(command)->get_std_string().c_str(), (char **)argv_ptr, pstrings);
-      } else {
-        execvp((char*)gc::As<String_sp>(command)->get_std_string().c_str(), (char **)argv_ptr);
-      }
-      /* at this point exec has failed */
-      perror("exec");
-      _exit(EXIT_FAILURE);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, child_stdin, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, child_stdout, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, child_stderr, STDERR_FILENO);
+    /* Closing a descriptor twice would make the spawn fail, so only
+       close each distinct one once. */
+    int to_close[] = {parent_write, parent_read, parent_error, child_stdin, child_stdout, child_stderr};
+    for (size_t i = 0; i < sizeof(to_close) / sizeof(to_close[0]); ++i) {
+      int fd = to_close[i];
+      bool seen = (fd <= STDERR_FILENO);
+      for (size_t j = 0; j < i; ++j)
+        seen = seen || (to_close[j] == fd);
+      if (!seen)
+        posix_spawn_file_actions_addclose(&actions, fd);
     }
+    /* Don't pass on our signal mask or handlers. */
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigfillset(&signals);
+    sigdelset(&signals, SIGKILL);
+    sigdelset(&signals, SIGSTOP);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    pid_t spawned;
+    if (env_ptrs.empty())
+      spawn_error = posix_spawnp(&spawned, command_string.c_str(), &actions, &attr, argv_ptrs.data(), clasp_environ());
+    else
+      spawn_error = posix_spawn(&spawned, command_string.c_str(), &actions, &attr, argv_ptrs.data(), env_ptrs.data());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
     close(child_stdin);
     close(child_stdout);
     if (!(error == kw::_sym_output)) close(child_stderr);
 
-    if (child_pid < 0) {
+    if (spawn_error != 0) {
       pid = nil<T_O>();
     } else {
-      pid = clasp_make_fixnum(child_pid);
+      pid = clasp_make_fixnum(spawned);
     }
   }
 #else  /* NACL */
@@ -529,7 +564,10 @@ T_mv sys__spawn_subprocess(T_sp command, T_sp argv, T_sp environ, T_sp input, T_
     parent_write = 0;
     parent_read = 0;
     parent_error = 0;
-    FEerror("Could not spawn subprocess to run ~S.", 1, command);
+    if (spawn_error != 0)
+      FEerror("Could not spawn subprocess to run ~S: ~A", 2, command.raw_(),
+              SimpleBaseString_O::make(strerror(spawn_error)).raw_());
+    FEerror("Could not spawn subprocess to run ~S.", 1, command.raw_());
   }
   return Values(
       pid,
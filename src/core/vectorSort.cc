@@ -0,0 +1,300 @@
+/*
+    File: vectorSort.cc
+
+    Sorting of specialized vectors on their raw storage, used by SORT and
+    STABLE-SORT (seqlib.lisp) when the predicate is one of the standard
+    orderings and there is no key.  Nothing here calls back into Lisp.
+
+    - Numbers under < and > are sorted with std::sort, or with an LSD radix
+      sort on order-preserving unsigned keys once the vector is large.
+      Floats are only handled when there is no NaN, and stable sorts of
+      floats use std::stable_sort, since -0.0 and 0.0 are equal under <.
+    - Characters of a string under CHAR< and CHAR> are counted into
+      buckets (base strings) or sorted as codes.
+    - General vectors of strings under STRING< and STRING> are sorted as a
+      permutation, which is then written back through a Lisp vector so
+      every element stays reachable for the collector.
+
+    Anything else returns NIL and the caller falls back to the Lisp sorts.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/array.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/wrappers.h>
+
+namespace core {
+
+// Below this many elements std::sort beats the radix passes.
+#define RADIX_SORT_THRESHOLD 4096
+
+/* Map a value to an unsigned integer of the same width whose order is
+   the numeric order of the values. */
+template <typename T, typename U>
+static inline U radix_key(T value) {
+  U bits;
+  memcpy(&bits, &value, sizeof(U));
+  constexpr U sign = U(1) << (8 * sizeof(U) - 1);
+  if constexpr (std::is_floating_point_v<T>)
+    return (bits & sign) ? ~bits : (bits | sign);
+  else if constexpr (std::is_signed_v<T>)
+    return bits ^ sign;
+  else
+    return bits;
+}
+
+/* Sort DATA ascending with one counting pass per byte of the key,
+   skipping the bytes on which every key agrees. */
+template <typename T>
+static void radix_sort(T* data, size_t n) {
+  using U = std::conditional_t<sizeof(T) == 8, uint64_t,
+                               std::conditional_t<sizeof(T) == 4, uint32_t,
+                                                  std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+  std::vector<T> scratch(n);
+  T* from = data;
+  T* to = scratch.data();
+  for (size_t shift = 0; shift < 8 * sizeof(T); shift += 8) {
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < n; ++i)
+      counts[(radix_key<T, U>(from[i]) >> shift) & 0xff]++;
+    if (counts[(radix_key<T, U>(from[0]) >> shift) & 0xff] == n)
+      continue;
+    size_t total = 0;
+    for (size_t b = 0; b < 256; ++b) {
+      size_t count = counts[b];
+      counts[b] = total;
+      total += count;
+    }
+    for (size_t i = 0; i < n; ++i)
+      to[counts[(radix_key<T, U>(from[i]) >> shift) & 0xff]++] = from[i];
+    std::swap(from, to);
+  }
+  if (from != data)
+    memcpy(data, from, n * sizeof(T));
+}
+
+template <typename T>
+static bool sort_numbers(T* data, size_t n, bool descending, bool stable) {
+  if constexpr (std::is_floating_point_v<T>) {
+    for (size_t i = 0; i < n; ++i)
+      if (std::isnan(data[i]))
+        return false; // < is not an ordering with NaNs around
+    if (stable) {
+      if (descending)
+        std::stable_sort(data, data + n, [](T a, T b) { return a > b; });
+      else
+        std::stable_sort(data, data + n);
+      return true;
+    }
+  }
+  // Equal integers are indistinguishable, so stability is moot.
+  if (n >= RADIX_SORT_THRESHOLD)
+    radix_sort(data, n);
+  else
+    std::sort(data, data + n);
+  if (descending)
+    std::reverse(data, data + n);
+  return true;
+}
+
+static void sort_base_chars(claspChar* data, size_t n, bool descending) {
+  size_t counts[256] = {0};
+  for (size_t i = 0; i < n; ++i)
+    counts[data[i]]++;
+  size_t pos = 0;
+  for (size_t b = 0; b < 256; ++b) {
+    size_t code = descending ? 255 - b : b;
+    memset(data + pos, (int)code, counts[code]);
+    pos += counts[code];
+  }
+}
+
+/* A string's characters, for comparing under STRING<. */
+struct StringView {
+  const void* data;
+  size_t length;
+  bool wide;
+  inline claspCharacter at(size_t i) const {
+    return wide ? ((const claspCharacter*)data)[i] : ((const claspChar*)data)[i];
+  }
+};
+
+static inline bool string_view_less(const StringView& a, const StringView& b) {
+  size_t n = std::min(a.length, b.length);
+  if (!a.wide && !b.wide) {
+    int c = memcmp(a.data, b.data, n);
+    if (c != 0)
+      return c < 0;
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      claspCharacter ca = a.at(i), cb = b.at(i);
+      if (ca != cb)
+        return ca < cb;
+    }
+  }
+  return a.length < b.length;
+}
+
+static bool sort_strings(Array_sp vector, size_t start, size_t end, bool descending, bool stable) {
+  size_t n = end - start;
+  std::vector<StringView> views(n);
+  for (size_t i = 0; i < n; ++i) {
+    T_sp element = vector->rowMajorAref(start + i);
+    if (!gc::IsA<String_sp>(element))
+      return false; // STRING< also takes symbols and characters
+    String_sp string = gc::As_unsafe<String_sp>(element);
+    views[i].length = string->length();
+    views[i].wide = (string->element_type() == cl::_sym_character);
+    views[i].data = views[i].length ? string->rowMajorAddressOfElement_(0) : "";
+  }
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i)
+    order[i] = i;
+  auto less = [&](size_t a, size_t b) {
+    return descending ? string_view_less(views[b], views[a]) : string_view_less(views[a], views[b]);
+  };
+  if (stable)
+    std::stable_sort(order.begin(), order.end(), less);
+  else
+    std::sort(order.begin(), order.end(), less);
+  SimpleVector_sp sorted = SimpleVector_O::make(n);
+  for (size_t i = 0; i < n; ++i)
+    (*sorted)[i] = vector->rowMajorAref(start + order[i]);
+  for (size_t i = 0; i < n; ++i)
+    vector->rowMajorAset(start + i, (*sorted)[i]);
+  return true;
+}
+
+enum SortOrdering { sort_numeric, sort_char, sort_string, sort_unknown };
+
+static SortOrdering sort_ordering(T_sp predicate, bool& descending) {
+  descending = false;
+  if (predicate == cl::_sym__LT_->symbolFunction())
+    return sort_numeric;
+  if (predicate == cl::_sym_char_LT_->symbolFunction())
+    return sort_char;
+  if (predicate == cl::_sym_string_LT_->symbolFunction())
+    return sort_string;
+  descending = true;
+  if (predicate == cl::_sym__GT_->symbolFunction())
+    return sort_numeric;
+  if (predicate == cl::_sym_char_GT_->symbolFunction())
+    return sort_char;
+  if (predicate == cl::_sym_string_GT_->symbolFunction())
+    return sort_string;
+  return sort_unknown;
+}
+
+template <typename T>
+static inline T* vector_data(Array_sp vector, size_t start) {
+  return (T*)vector->rowMajorAddressOfElement_(0) + start;
+}
+
+CL_LAMBDA(vector start end predicate stable);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Sort VECTOR from START to END by PREDICATE on its raw storage if that is
+supported, and return true. Return NIL, leaving VECTOR alone, otherwise.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__native_sort(Array_sp vector, size_t start, size_t end, T_sp predicate, bool stable) {
+  if (vector->rank() != 1 || start > end || end > vector->length())
+    return false;
+  bool descending;
+  SortOrdering ordering = sort_ordering(predicate, descending);
+  if (ordering == sort_unknown)
+    return false;
+  size_t n = end - start;
+  if (n < 2)
+    return true;
+  T_sp type = vector->element_type();
+  if (ordering == sort_numeric) {
+    if (type == cl::_sym_double_float)
+      return sort_numbers(vector_data<double>(vector, start), n, descending, stable);
+    if (type == cl::_sym_single_float)
+      return sort_numbers(vector_data<float>(vector, start), n, descending, stable);
+    if (type == cl::_sym_fixnum)
+      return sort_numbers(vector_data<Fixnum>(vector, start), n, descending, stable);
+    if (type == ext::_sym_cl_index)
+      return sort_numbers(vector_data<size_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_byte64)
+      return sort_numbers(vector_data<uint64_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_integer64)
+      return sort_numbers(vector_data<int64_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_byte32)
+      return sort_numbers(vector_data<uint32_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_integer32)
+      return sort_numbers(vector_data<int32_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_byte16)
+      return sort_numbers(vector_data<uint16_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_integer16)
+      return sort_numbers(vector_data<int16_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_byte8)
+      return sort_numbers(vector_data<uint8_t>(vector, start), n, descending, stable);
+    if (type == ext::_sym_integer8)
+      return sort_numbers(vector_data<int8_t>(vector, start), n, descending, stable);
+    return false;
+  }
+  if (ordering == sort_char) {
+    // Characters with the same code are identical, so any sort is stable.
+    if (type == cl::_sym_base_char) {
+      sort_base_chars(vector_data<claspChar>(vector, start), n, descending);
+      return true;
+    }
+    if (type == cl::_sym_character)
+      return sort_numbers(vector_data<claspCharacter>(vector, start), n, descending, false);
+    return false;
+  }
+  if (type == cl::_sym_T_O)
+    return sort_strings(vector, start, end, descending, stable);
+  return false;
+}
+
+CL_LAMBDA(vector start middle end predicate);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Merge the sorted ranges [START, MIDDLE) and [MIDDLE, END) of VECTOR, stably,
+if NATIVE-SORT supports VECTOR's element type and PREDICATE, and return true.
+Return NIL otherwise.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__native_merge(Array_sp vector, size_t start, size_t middle, size_t end, T_sp predicate) {
+  if (vector->rank() != 1 || start > middle || middle > end || end > vector->length())
+    return false;
+  bool descending;
+  SortOrdering ordering = sort_ordering(predicate, descending);
+  T_sp type = vector->element_type();
+  auto merge = [&](auto* data) {
+    using T = std::remove_pointer_t<decltype(data)>;
+    if constexpr (std::is_floating_point_v<T>) {
+      for (size_t i = start; i < end; ++i)
+        if (std::isnan(data[i]))
+          return false;
+    }
+    if (descending)
+      std::inplace_merge(data + start, data + middle, data + end, [](T a, T b) { return a > b; });
+    else
+      std::inplace_merge(data + start, data + middle, data + end);
+    return true;
+  };
+  if (ordering == sort_numeric) {
+    if (type == cl::_sym_double_float) return merge(vector_data<double>(vector, 0));
+    if (type == cl::_sym_single_float) return merge(vector_data<float>(vector, 0));
+    if (type == cl::_sym_fixnum) return merge(vector_data<Fixnum>(vector, 0));
+    if (type == ext::_sym_cl_index) return merge(vector_data<size_t>(vector, 0));
+    if (type == ext::_sym_byte64) return merge(vector_data<uint64_t>(vector, 0));
+    if (type == ext::_sym_integer64) return merge(vector_data<int64_t>(vector, 0));
+    if (type == ext::_sym_byte32) return merge(vector_data<uint32_t>(vector, 0));
+    if (type == ext::_sym_integer32) return merge(vector_data<int32_t>(vector, 0));
+    if (type == ext::_sym_byte16) return merge(vector_data<uint16_t>(vector, 0));
+    if (type == ext::_sym_integer16) return merge(vector_data<int16_t>(vector, 0));
+    if (type == ext::_sym_byte8) return merge(vector_data<uint8_t>(vector, 0));
+    if (type == ext::_sym_integer8) return merge(vector_data<int8_t>(vector, 0));
+  } else if (ordering == sort_char) {
+    if (type == cl::_sym_base_char) return merge(vector_data<claspChar>(vector, 0));
+    if (type == cl::_sym_character) return merge(vector_data<claspCharacter>(vector, 0));
+  }
+  return false;
+}
+
+}; // namespace core
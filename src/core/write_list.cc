@@ -110,6 +110,8 @@ void Cons_O::__write__(T_sp stream) const {
   }
   x = this->const_sharedThis<Cons_O>();
   clasp_write_char('(', stream);
+  // recursion with printlevel -1, bound once for the whole list
+  DynamicScopeManager scope(cl::_sym_STARprint_levelSTAR, clasp_make_fixnum(print_level - 1));
   for (i = 0;; i++) {
     if (i >= print_length) {
       clasp_write_string("...", stream);
@@ -117,8 +119,6 @@ void Cons_O::__write__(T_sp stream) const {
     }
     y = oCar(x);
     x = oCdr(x);
-    // recursion with printlevel -1
-    DynamicScopeManager scope(cl::_sym_STARprint_levelSTAR, clasp_make_fixnum(print_level - 1));
     write_object(y, stream);
     /* FIXME! */
     if (!x || cl__atom(x) ||
@@ -109,8 +109,25 @@ Fixnum search_print_circle(T_sp x) {
   }
 }
 
+/*! True if X is of a standardized class whose printing print-object methods
+    cannot portably change (CLHS 11.1.2.1.2, item 19), so that dispatching
+    through the generic function would only reach write-ugly-object.
+    Conses are left to print-object, which has Clasp methods of its own. */
+static bool print_object_bypass_p(T_sp x) {
+  if (x.fixnump() || x.characterp() || x.single_floatp())
+    return true;
+  if (!x.generalp())
+    return false;
+  if (!(gc::IsA<Number_sp>(x) || gc::IsA<Array_sp>(x) || gc::IsA<Symbol_sp>(x)))
+    return false;
+  // The core:general method prints objects with fields as #i when readable
+  return !clasp_print_readably() || !x.unsafe_general()->fieldsp();
+}
+
 T_sp do_write_object(T_sp x, T_sp stream) {
-  return cl::_sym_printObject->fboundp() ? core::eval::funcall(cl::_sym_printObject, x, stream) : write_ugly_object(x, stream);
+  if (print_object_bypass_p(x) || !cl::_sym_printObject->fboundp())
+    return write_ugly_object(x, stream);
+  return core::eval::funcall(cl::_sym_printObject, x, stream);
 }
 
 T_sp do_write_object_circle(T_sp x, T_sp stream) {
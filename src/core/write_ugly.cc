@@ -110,21 +110,15 @@ void Instance_O::__write__(T_sp stream) const { clasp_write_string(_rep_(this->a
 void FuncallableInstance_O::__write__(T_sp stream) const { clasp_write_string(_rep_(this->asSmartPtr()), stream); }
 
 void Integer_O::__write__(T_sp stream) const {
-  SafeBufferStr8Ns buffer;
-  int print_base = clasp_print_base();
-  core__integer_to_string(buffer._Buffer, this->const_sharedThis<Integer_O>(), make_fixnum(print_base),
-                          cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), true);
-  cl__write_sequence(buffer._Buffer, stream, make_fixnum(0), nil<T_O>());
+  clasp_write_integer(this->const_sharedThis<Integer_O>(), clasp_print_base(),
+                      cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), true, stream);
 }
 
 void Ratio_O::__write__(T_sp stream) const {
-  SafeBufferStr8Ns buffer;
   int print_base = clasp_print_base();
-  core__integer_to_string(buffer._Buffer, this->numerator(), make_fixnum(print_base),
-                          cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), false);
-  buffer._Buffer->vectorPushExtend('/');
-  core__integer_to_string(buffer._Buffer, this->denominator(), make_fixnum(print_base), false, false);
-  cl__write_sequence(buffer._Buffer, stream, make_fixnum(0), nil<T_O>());
+  clasp_write_integer(this->numerator(), print_base, cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), false, stream);
+  clasp_write_char('/', stream);
+  clasp_write_integer(this->denominator(), print_base, false, false, stream);
 }
 
 void Complex_O::__write__(T_sp stream) const {
@@ -146,18 +140,14 @@ void Function_O::__write__(T_sp stream) const {
 }
 
 void _clasp_write_fixnum(gctools::Fixnum i, T_sp stream) {
-  SafeBufferStr8Ns buffer;
-  core__integer_to_string(buffer._Buffer, clasp_make_fixnum(i), clasp_make_fixnum(clasp_print_base()),
-                          cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), true);
-  cl__write_sequence(buffer._Buffer, stream, make_fixnum(0), nil<T_O>());
+  char txt[CLASP_FIXNUM_CHARS_MAX];
+  size_t len = clasp_fixnum_to_chars(txt, i, clasp_print_base(), cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), true);
+  clasp_write_characters(txt, len, stream);
 }
 
 void write_fixnum(T_sp strm, T_sp i) {
   Fixnum_sp fn = gc::As<Fixnum_sp>(i);
-  SafeBufferStr8Ns buffer;
-  int print_base = clasp_print_base();
-  core__integer_to_string(buffer._Buffer, fn, make_fixnum(print_base), cl::_sym_STARprint_radixSTAR->symbolValue().isTrue(), true);
-  cl__write_sequence(buffer._Buffer, strm, make_fixnum(0), nil<T_O>());
+  _clasp_write_fixnum(fn.unsafe_fixnum(), strm);
 }
 
 void write_single_float(T_sp strm, SingleFloat_sp i) {
@@ -167,6 +157,12 @@ void write_single_float(T_sp strm, SingleFloat_sp i) {
 }
 
 void write_float(Float_sp f, T_sp stream) {
+  char text[64];
+  size_t len = clasp_float_to_string_free(text, sizeof(text), f, -3, 8);
+  if (len) {
+    clasp_write_characters(text, len, stream);
+    return;
+  }
   T_sp result = core_float_to_string_free(f, clasp_make_fixnum(-3), clasp_make_fixnum(8));
   cl__write_sequence(result, stream, clasp_make_fixnum(0), nil<T_O>());
 }
@@ -150,6 +150,9 @@
              #~"kernel/stage/base/2-begin.lisp"  
              :clasp-cleavir
              #~"kernel/lsp/queue.lisp" ;; cclasp sources
+             #~"kernel/lsp/scheduler.lisp"
+             #~"kernel/lsp/async-io.lisp"
+             #~"kernel/lsp/vector-math.lisp"
              #~"kernel/lsp/generated-encodings.lisp"
              #~"kernel/lsp/process.lisp"
              #~"kernel/lsp/encodings.lisp"
@@ -665,7 +665,16 @@ FIXME!!!! This code will have problems with multithreading if a generic function
                                     call-history)
                                    (t (setf updatedp t)
                                       (union-entries call-history new-entries))))))
-       (when updatedp (force-dispatcher generic-function))
+       (let ((cache (megamorphic-cache-of generic-function)))
+         (cond ((null cache)
+                (when updatedp (force-dispatcher generic-function)))
+               ((or updatedp
+                    (call-history-find-key
+                     (mp:atomic (safe-gf-call-history generic-function))
+                     (megamorphic-class-key generic-function arguments)))
+                ;; The installed discriminator is a megamorphic cache;
+                ;; add the entry in place rather than regenerating.
+                (megamorphic-cache-insert cache arguments outcome))))
        (gf-log "Performing outcome {}%N" outcome)
        (when report
          (format *trace-output*
@@ -696,19 +705,255 @@ FIXME!!!! This code will have problems with multithreading if a generic function
 (defun dispatch-miss-va (generic-function vaslist-args)
   (apply #'dispatch-miss generic-function vaslist-args))
 
+;;; ------------------------------------------------------------
+;;;
+;;; Megamorphic dispatch
+;;;
+;;; A discriminator compiled from the call history grows with the number
+;;; of classes seen, and every new class costs a regeneration. Once the
+;;; call history passes *MEGAMORPHIC-CALL-HISTORY-THRESHOLD* entries we
+;;; instead install a discriminator that looks the stamps of the
+;;; specialized arguments up in an open-addressed hash table. Misses add
+;;; to that table in place (see DISPATCH-MISS), so a generic function
+;;; called on ever more classes stops regenerating its discriminator.
+;;; Stamps rather than classes are hashed so that obsolete instances,
+;;; whose stamp no longer matches their class, miss and get updated.
+;;; Generic functions with EQL specializers keep the usual discriminator.
+
+(defparameter *megamorphic-call-history-threshold* 128)
+
+;;; TABLE is a power-of-two simple-vector of NIL or (stamp-vector . outcome).
+;;; Readers never lock; writers hold LOCK and publish each entry atomically.
+;;; POSITIONS lists the indices of the specialized required arguments.
+(defstruct (megamorphic-cache (:type vector) :named)
+  (table nil) (count 0) (positions nil) (lock nil))
+
+;;; Maps megamorphic discriminators to their caches, so that DISPATCH-MISS
+;;; can tell whether a generic function's installed discriminator is one.
+;;; Weak tables are not thread safe, hence the lock.
+(defvar *megamorphic-caches* (make-hash-table :test #'eq :weakness :key))
+(defvar *megamorphic-caches-lock* (mp:make-lock :name 'megamorphic-caches))
+
+(defun megamorphic-cache-of (generic-function)
+  (let ((discriminator (get-funcallable-instance-function generic-function)))
+    (mp:with-lock (*megamorphic-caches-lock*)
+      (values (gethash discriminator *megamorphic-caches*)))))
+
+(defun megamorphic-positions (generic-function)
+  "Return a list of the specialized argument positions of GENERIC-FUNCTION,
+or NIL if it cannot use a megamorphic cache."
+  (loop for spec across (safe-gf-specializer-profile generic-function)
+        for i from 0
+        when (consp spec) ; eql specializer
+          do (return-from megamorphic-positions nil)
+        when spec collect i))
+
+(defun megamorphic-class-key (generic-function arguments)
+  (coerce (subseq (mapcar #'class-of arguments)
+                  0 (length (safe-gf-specializer-profile generic-function)))
+          'simple-vector))
+
+(declaim (inline megamorphic-mix))
+(defun megamorphic-mix (hash stamp)
+  (logand (logxor (+ (ash hash 5) hash) stamp (ash stamp -9)) #x3fffffff))
+
+(defun megamorphic-stamps-hash (stamps)
+  (let ((hash 0))
+    (loop for stamp across stamps do (setf hash (megamorphic-mix hash stamp)))
+    hash))
+
+(defun megamorphic-table-insert (table key outcome)
+  "Store (KEY . OUTCOME) in TABLE unless KEY is present. Return true if stored."
+  (loop with mask = (1- (length table))
+        for index = (logand (megamorphic-stamps-hash key) mask)
+          then (logand (1+ index) mask)
+        for entry = (svref table index)
+        do (cond ((null entry)
+                  (setf (mp:atomic (svref table index)) (cons key outcome))
+                  (return t))
+                 ((equalp (car entry) key) (return nil)))))
+
+(defun make-megamorphic-table (size entries)
+  (let ((table (make-array size :initial-element nil)))
+    (loop for (key . outcome) in entries
+          do (megamorphic-table-insert table key outcome))
+    table))
+
+(defun megamorphic-cache-insert (cache arguments outcome)
+  "Add an entry mapping the stamps of ARGUMENTS to OUTCOME."
+  (let ((key (map 'simple-vector (lambda (position)
+                                   (core:instance-stamp (nth position arguments)))
+                  (megamorphic-cache-positions cache))))
+    (mp:with-lock ((megamorphic-cache-lock cache))
+      (let ((table (megamorphic-cache-table cache)))
+        ;; Keep the load factor at or under one half so probes stay short.
+        (when (> (* 2 (1+ (megamorphic-cache-count cache))) (length table))
+          (setf table (make-megamorphic-table
+                       (* 2 (length table))
+                       (loop for entry across table when entry collect entry))
+                (megamorphic-cache-table cache) table))
+        (when (megamorphic-table-insert table key outcome)
+          (incf (megamorphic-cache-count cache)))))))
+
+(defun make-megamorphic-cache (generic-function positions)
+  (let* ((entries
+           (loop for (classes . outcome) in (mp:atomic (safe-gf-call-history
+                                                        generic-function))
+                 collect (cons (map 'simple-vector
+                                    (lambda (position)
+                                      (core:class-stamp-for-instances
+                                       (svref classes position)))
+                                    positions)
+                               outcome)))
+         (table (make-megamorphic-table
+                 (ash 1 (integer-length (* 2 (length entries)))) entries)))
+    (make-megamorphic-cache
+     :table table
+     ;; Entries differing only in unspecialized classes share a key.
+     :count (count-if #'identity table)
+     :positions positions
+     :lock (mp:make-lock :name 'megamorphic-cache))))
+
+;;; Find the outcome for the arguments in ARGS, or NIL.
+;;; ARGS is left in an unspecified state; callers rewind it.
+(defun megamorphic-cache-lookup (cache args)
+  (let* ((positions (megamorphic-cache-positions cache))
+         (table (megamorphic-cache-table cache))
+         (mask (1- (length table)))
+         (hash 0))
+    (loop with position = 0
+          for wanted in positions
+          do (loop until (= position wanted)
+                   do (core:vaslist-pop args) (incf position))
+             (setf hash (megamorphic-mix hash (core:instance-stamp
+                                               (core:vaslist-pop args))))
+             (incf position))
+    (loop for index = (logand hash mask) then (logand (1+ index) mask)
+          for entry = (svref table index)
+          do (cond ((null entry) (return nil))
+                   ((megamorphic-key-match-p (car entry) positions args)
+                    (return (cdr entry)))))))
+
+(defun megamorphic-key-match-p (key positions args)
+  (core:vaslist-rewind args)
+  (loop with position = 0
+        for wanted in positions
+        for stamp across key
+        do (loop until (= position wanted)
+                 do (core:vaslist-pop args) (incf position))
+           (unless (eql stamp (core:instance-stamp (core:vaslist-pop args)))
+             (return nil))
+           (incf position)
+        finally (return t)))
+
+(defun megamorphic-discriminator (generic-function positions)
+  (let* ((cache (make-megamorphic-cache generic-function positions))
+         (nreq (1+ (reduce #'max positions)))
+         (discriminator
+           (lambda (core:&va-rest args)
+             (declare (core:lambda-name megamorphic-discriminator))
+             (let ((outcome (and (>= (core:vaslist-length args) nreq)
+                                 (megamorphic-cache-lookup cache args))))
+               (core:vaslist-rewind args)
+               (cond ((null outcome)
+                      (apply #'dispatch-miss generic-function args))
+                     ((effective-method-outcome-p outcome)
+                      (apply (effective-method-outcome-function outcome) args))
+                     (t (perform-outcome outcome
+                                         (core:list-from-vaslist args))))))))
+    (mp:with-lock (*megamorphic-caches-lock*)
+      (setf (gethash discriminator *megamorphic-caches*) cache))
+    discriminator))
+
+(defun maybe-megamorphic-discriminator (generic-function)
+  (let ((call-history (mp:atomic (safe-gf-call-history generic-function))))
+    (when (> (length call-history) *megamorphic-call-history-threshold*)
+      (let ((positions (megamorphic-positions generic-function)))
+        (when positions
+          (megamorphic-discriminator generic-function positions))))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Background compilation of discriminators
+;;;
+;;; Compiling a discriminator natively takes long enough to be felt as
+;;; latency by whichever thread missed. When *BACKGROUND-DISCRIMINATOR-
+;;; COMPILATION* is true, the missing thread installs the bytecode
+;;; interpreted discriminator and queues the generic function, together
+;;; with the call history the interpreted discriminator was built from,
+;;; for a dedicated compiler thread. The compiled discriminator is only
+;;; installed if that call history is still current; otherwise a newer
+;;; dispatcher (and job) has superseded it.
+
+(defvar *background-discriminator-compilation* t)
+
+(defvar *discriminator-compiler-lock* (mp:make-lock :name 'discriminator-compiler))
+(defvar *discriminator-compiler-queue* nil)
+(defvar *discriminator-compiler-process* nil)
+
+(defmacro with-discriminator-compilation-timer (() &body body)
+  (let ((timer-start (gensym "TIMER-START")))
+    `(let ((,timer-start (get-internal-real-time)))
+       (unwind-protect (progn ,@body)
+         (gctools:accumulate-discriminating-function-compilation-seconds
+          (/ (float (- (get-internal-real-time) ,timer-start) 1d0)
+             internal-time-units-per-second))))))
+
+(defun background-compile-discriminator (generic-function call-history)
+  (when (eq (mp:atomic (safe-gf-call-history generic-function)) call-history)
+    (let ((compiled (with-discriminator-compilation-timer ()
+                      (compile nil (generate-discriminator generic-function)))))
+      (when (eq (mp:atomic (safe-gf-call-history generic-function)) call-history)
+        (set-funcallable-instance-function generic-function compiled)
+        ;; A dispatch miss may have updated the call history between the
+        ;; check and the installation. If so, don't leave a stale
+        ;; discriminator in place.
+        (unless (eq (mp:atomic (safe-gf-call-history generic-function))
+                    call-history)
+          (force-dispatcher generic-function))))))
+
+(defun discriminator-compiler-loop (queue)
+  (loop for (generic-function . call-history) = (core:dequeue queue)
+        do (handler-case
+               (background-compile-discriminator generic-function call-history)
+             ;; The interpreted discriminator stays installed, which is
+             ;; correct, just slower.
+             (error (condition)
+               (declare (ignorable condition))
+               (gf-log "Background discriminator compilation failed: {}%N"
+                       condition)))))
+
+(defun enqueue-discriminator-compilation (generic-function)
+  (let ((queue
+          (mp:with-lock (*discriminator-compiler-lock*)
+            (unless *discriminator-compiler-queue*
+              (setf *discriminator-compiler-queue*
+                    (core:make-queue 'discriminator-compiler)))
+            (unless (and *discriminator-compiler-process*
+                         (mp:process-active-p *discriminator-compiler-process*))
+              (let ((queue *discriminator-compiler-queue*))
+                (setf *discriminator-compiler-process*
+                      (mp:process-run-function
+                       'discriminator-compiler
+                       (lambda () (discriminator-compiler-loop queue))))))
+            *discriminator-compiler-queue*)))
+    (core:atomic-enqueue queue
+                         (cons generic-function
+                               (mp:atomic (safe-gf-call-history generic-function))))))
+
 (defvar *fastgf-force-compiler* nil)
 (defun calculate-fastgf-dispatch-function
     (generic-function &key (compile *fastgf-force-compiler*))
   (if (mp:atomic (safe-gf-call-history generic-function))
-      (let ((timer-start (get-internal-real-time)))
-        (unwind-protect
-            (if (and #-cclasp nil compile cmp:*cleavir-compile-hook*
-                     (not (eq core:*clasp-build-mode* :bytecode)))
-                (compile nil (generate-discriminator generic-function))
-                (bytecode-interpreted-discriminator generic-function))
-          (let ((delta-seconds (/ (float (- (get-internal-real-time) timer-start) 1d0)
-                                  internal-time-units-per-second)))
-            (gctools:accumulate-discriminating-function-compilation-seconds delta-seconds))))
+      (with-discriminator-compilation-timer ()
+        (cond ((maybe-megamorphic-discriminator generic-function))
+              ((and #-cclasp nil compile cmp:*cleavir-compile-hook*
+                    (not (eq core:*clasp-build-mode* :bytecode)))
+               (if *background-discriminator-compilation*
+                   (prog1 (bytecode-interpreted-discriminator generic-function)
+                     (enqueue-discriminator-compilation generic-function))
+                   (compile nil (generate-discriminator generic-function))))
+              (t (bytecode-interpreted-discriminator generic-function))))
       (invalidated-discriminating-function-closure generic-function)))
 
 (defun force-dispatcher (generic-function)
@@ -869,8 +1114,9 @@ FIXME!!!! This code will have problems with multithreading if a generic function
         (clos:compile-discriminating-function f)))))
 
 (defun compile-all-generic-functions ()
-  (do-all-symbols (s)
-    (maybe-compile-named-gf s)
-    (maybe-compile-named-gf `(setf ,s))))
+  (let ((*background-discriminator-compilation* nil))
+    (do-all-symbols (s)
+      (maybe-compile-named-gf s)
+      (maybe-compile-named-gf `(setf ,s)))))
 
 (export 'compile-all-generic-functions)
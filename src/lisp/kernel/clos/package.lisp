@@ -141,6 +141,8 @@
 #+clasp
 (export '(satiate
           satiate-initialization
+          save-call-histories
+          load-call-histories
           apply-method
           ))
 
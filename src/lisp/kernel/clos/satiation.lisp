@@ -639,3 +639,109 @@ a list (EQL object) - just like DEFMETHOD."
           standard-direct-slot-definition standard-effective-slot-definition
           eql-specializer method-combination funcallable-standard-class))
        (%early-satiate make-instances-obsolete (standard-class) (funcallable-standard-class) (structure-class)))))
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;
+;;; PROFILE-GUIDED SATIATION
+;;;
+;;; A running image's call histories record which classes each generic function
+;;; has actually been called with. SAVE-CALL-HISTORIES writes them out by name,
+;;; and LOAD-CALL-HISTORIES satiates the same generic functions in a new process
+;;; so it doesn't have to rediscover them through dispatch misses. Loading into
+;;; an image that is then saved as a snapshot bakes the histories into it.
+;;; Stamps are not portable between images, so entries are recorded as class
+;;; names and (EQL object) designators. Entries involving anonymous classes or
+;;; unreadable EQL objects are dropped.
+
+(defun map-named-generic-functions (function)
+  (flet ((maybe (name)
+           (when (fboundp name)
+             (let ((f (fdefinition name)))
+               (when (typep f 'standard-generic-function)
+                 (funcall function name f))))))
+    (do-all-symbols (s)
+      (maybe s)
+      (maybe `(setf ,s)))))
+
+(defun specializer-designator (specializer)
+  "Return a designator that can be read back in another image, or NIL."
+  (cond ((typep specializer 'eql-specializer)
+         (let ((object (eql-specializer-object specializer)))
+           (when (typep object '(or symbol number character))
+             `(eql ,object))))
+        ((and (typep specializer 'class)
+              (class-name specializer)
+              (eq (find-class (class-name specializer) nil) specializer))
+         (class-name specializer))))
+
+(defun call-history-designators (generic-function)
+  (loop for (key . nil) in (mp:atomic (safe-gf-call-history generic-function))
+        for designators = (map 'list #'specializer-designator key)
+        when (every #'identity designators)
+          collect designators))
+
+(defun save-call-histories (pathname &key (names nil namesp))
+  "Write the call histories of the generic functions named by NAMES, or of all
+named generic functions by default, to PATHNAME, in a form LOAD-CALL-HISTORIES
+can use to satiate them in another image."
+  (with-open-file (stream pathname :direction :output :if-exists :supersede)
+    (with-standard-io-syntax
+      ;; One entry per line, so LOAD-CALL-HISTORIES can skip one it can't read.
+      (let ((*print-readably* t) (*print-pretty* nil))
+        (flet ((save (name generic-function)
+                 (let ((designators (call-history-designators generic-function)))
+                   (when designators
+                     (prin1 (cons name designators) stream)
+                     (terpri stream)))))
+          (if namesp
+              (dolist (name names)
+                (save name (fdefinition name)))
+              (map-named-generic-functions #'save))))))
+  pathname)
+
+(defun load-call-histories (pathname &key (compile t))
+  "Satiate generic functions from a file written by SAVE-CALL-HISTORIES, and
+install their discriminating functions. If COMPILE is true, the discriminators
+are compiled natively as well. Entries naming generic functions, classes or
+methods that do not exist in this image are skipped. Returns the number of
+generic functions satiated."
+  (let ((count 0)
+        ;; Compile in this thread, so that the discriminators are ready
+        ;; when we return rather than queued.
+        (*background-discriminator-compilation* nil))
+    (with-open-file (stream pathname)
+      (with-standard-io-syntax
+        (loop with eof = stream
+              with skip = (list nil)
+              for form = (handler-case (read stream nil eof)
+                           (error (condition)
+                             ;; e.g. a package or symbol missing from this image
+                             (warn "Skipping an unreadable call history entry: ~a" condition)
+                             (read-line stream nil)
+                             skip))
+              until (eq form eof)
+              unless (eq form skip)
+                do (destructuring-bind (name &rest designators) form
+                     (let ((generic-function (and (fboundp name) (fdefinition name))))
+                       (when (typep generic-function 'standard-generic-function)
+                         (let ((nspec (length (safe-gf-specializer-profile
+                                               generic-function))))
+                           (handler-case
+                               (progn
+                                 (apply #'satiate generic-function
+                                        (remove-if-not
+                                         (lambda (list)
+                                           (and (= (length list) nspec)
+                                                (every (lambda (designator)
+                                                         (or (consp designator)
+                                                             (find-class designator nil)))
+                                                       list)))
+                                         designators))
+                                 (if compile
+                                     (compile-discriminating-function generic-function)
+                                     (force-dispatcher generic-function))
+                                 (incf count))
+                             (error (condition)
+                               (warn "Could not satiate ~s from call history: ~a"
+                                     name condition))))))))))
+    count))
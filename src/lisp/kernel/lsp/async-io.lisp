@@ -0,0 +1,393 @@
+;;;; async-io.lisp -- asynchronous file I/O.
+
+(in-package "EXT")
+
+(export '(async-read async-write async-read-sequence async-write-sequence
+          register-async-io-buffers async-io-backend
+          async-io-error async-io-error-errno
+          *async-io-workers* *async-io-chunk-size*))
+
+;;; ASYNC-READ and friends start a read or write and immediately return an
+;;; MP:FUTURE. MP:FORCE waits for it and returns the octet count.
+;;;
+;;; On Linux all requests go through one io_uring shared by every thread.
+;;; A submitting thread only queues its request; a single completion
+;;; process finishes the futures as the kernel reports results, so
+;;; thousands of reads can be in flight without a thread for each.
+;;; Where io_uring is missing or refused, a small pool of I/O processes
+;;; performs the requests with pread and pwrite instead.
+;;;
+;;; Requests use explicit file offsets and never move the file position
+;;; of a stream or descriptor. Their buffers must be vectors of
+;;; (UNSIGNED-BYTE 8), and must not be modified or resized until the
+;;; request is finished.
+
+(defvar *async-io-workers* 4
+  "Number of processes that perform asynchronous I/O when io_uring is not
+available.")
+
+(defvar *async-io-chunk-size* (* 1024 1024)
+  "ASYNC-READ-SEQUENCE and ASYNC-WRITE-SEQUENCE split their ranges into
+requests of at most this many octets and submit them together.")
+
+(defvar *async-io-ring-entries* 256)
+
+(define-condition async-io-error (simple-error)
+  ((errno :initarg :errno :reader async-io-error-errno)))
+
+(defun make-async-io-error (op errno)
+  (make-condition 'async-io-error
+                  :errno errno
+                  :format-control "Asynchronous ~(~a~) failed: ~a"
+                  :format-arguments (list op (core:strerror errno))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Requests and the I/O service
+;;;
+
+(defstruct (io-request (:constructor make-io-request
+                           (op fd buffer start end offset completion)))
+  op fd buffer start end offset
+  ;; Called with the octet count and NIL, or the count so far and an errno.
+  completion
+  ;; Octets transferred so far; short writes are resubmitted.
+  (done 0))
+
+(defstruct (io-service (:constructor %make-io-service (backend)))
+  ;; :IO-URING or :THREAD-POOL
+  backend
+  ring
+  ;; Held while filling and submitting the ring, and for the request table.
+  (lock (mp:make-lock :name 'async-io))
+  ;; In-flight requests, indexed by the user data given to the kernel.
+  ;; This also keeps their buffers alive.
+  (requests (make-array 256 :adjustable t :fill-pointer 0))
+  (free-ids nil)
+  ;; (request . result) pairs reaped by a submitter whose submission the
+  ;; kernel refused, finished once it releases the lock.
+  (reaped nil)
+  ;; Buffers registered with the ring, in registration order.
+  (registered nil)
+  ;; Thread pool requests.
+  channel
+  processes)
+
+(defvar *io-service* nil)
+(defvar *io-service-lock* (mp:make-lock :name 'io-service-creation))
+
+(defun io-service ()
+  (or *io-service*
+      (mp:with-lock (*io-service-lock*)
+        (or *io-service*
+            (setf *io-service* (start-io-service))))))
+
+(defun start-io-service ()
+  (let ((ring (core:io-ring-create *async-io-ring-entries*)))
+    (if ring
+        (let ((service (%make-io-service :io-uring)))
+          (setf (io-service-ring service) ring
+                (io-service-processes service)
+                (list (mp:process-run-function
+                       'async-io-completion
+                       (lambda () (io-completion-loop service)))))
+          service)
+        (let ((service (%make-io-service :thread-pool)))
+          (setf (io-service-channel service) (mp:make-channel :name 'async-io)
+                (io-service-processes service)
+                (loop repeat (max 1 *async-io-workers*)
+                      collect (mp:process-run-function
+                               'async-io-worker
+                               (lambda () (io-worker-loop service)))))
+          service))))
+
+(defun stop-io-service (service)
+  "Stop SERVICE's processes and close its ring. Requests still in flight
+are abandoned."
+  (ecase (io-service-backend service)
+    (:io-uring
+     ;; The completion process only leaves its wait when a request
+     ;; completes, so interrupt it.
+     (dolist (process (io-service-processes service))
+       (when (mp:process-active-p process)
+         (mp:process-kill process)
+         (mp:process-join process)))
+     (core:io-ring-close (io-service-ring service)))
+    (:thread-pool
+     (dolist (process (io-service-processes service))
+       (declare (ignore process))
+       (mp:channel-send (io-service-channel service) :stop))
+     (mapc #'mp:process-join (io-service-processes service)))))
+
+;;; The ring and the processes don't survive a snapshot, so shut the
+;;; service down when saving and start a fresh one on demand.
+(defun stop-io-service-on-save ()
+  (let ((service *io-service*))
+    (setf *io-service* nil)
+    (when service
+      (stop-io-service service))))
+
+(eval-when (:load-toplevel :execute)
+  (cmp:register-save-hook 'stop-io-service-on-save))
+
+(defun async-io-backend ()
+  "Return :IO-URING or :THREAD-POOL, whichever performs asynchronous I/O."
+  (io-service-backend (io-service)))
+
+;;; ------------------------------------------------------------
+;;;
+;;; io_uring backend
+;;;
+
+;;; Linux errno values; io_uring only exists there.
+(defconstant +eagain+ 11)
+(defconstant +ebusy+ 16)
+
+(defun allocate-request-id (service request)
+  (let ((id (pop (io-service-free-ids service))))
+    (cond (id (setf (aref (io-service-requests service) id) request)
+              id)
+          (t (vector-push-extend request (io-service-requests service))))))
+
+(defun release-request-id (service id)
+  (let ((requests (io-service-requests service)))
+    (prog1 (aref requests id)
+      (setf (aref requests id) nil)
+      (push id (io-service-free-ids service)))))
+
+(defun prepare-request (service request id)
+  (let ((done (io-request-done request)))
+    (core:io-ring-prepare (io-service-ring service)
+                          (if (eq (io-request-op request) :read) 0 1)
+                          (io-request-fd request)
+                          (io-request-buffer request)
+                          (+ (io-request-start request) done)
+                          (io-request-end request)
+                          (+ (io-request-offset request) done)
+                          id
+                          (position (io-request-buffer request)
+                                    (io-service-registered service)))))
+
+(defun reap-completions (service)
+  "Consume the ring's completions and return them as (request . result)
+pairs. The caller holds the service lock."
+  (loop for (id . result) in (core:io-ring-completions (io-service-ring service))
+        collect (cons (release-request-id service id) result)))
+
+(defun submit-ring (service)
+  (loop
+    (multiple-value-bind (count errno)
+        (core:io-ring-submit (io-service-ring service))
+      (cond (count (return count))
+            ;; Too many completions are waiting to be reaped. We hold the
+            ;; lock the completion process needs, and may be that process,
+            ;; so reap them here and finish them after unlocking.
+            ((member errno (list +eagain+ +ebusy+))
+             (let ((reaped (reap-completions service)))
+               (if reaped
+                   (setf (io-service-reaped service)
+                         (nconc (io-service-reaped service) reaped))
+                   (mp:process-yield))))
+            (t (error (make-async-io-error :submit errno)))))))
+
+(defun finish-completions (service finished)
+  (loop for (request . result) in finished
+        do (complete-request service request result)))
+
+(defun io-completion-loop (service)
+  (let ((ring (io-service-ring service)))
+    (loop
+      (core:io-ring-wait ring)
+      (finish-completions service
+                          (mp:with-lock ((io-service-lock service))
+                            (reap-completions service))))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Thread pool backend
+;;;
+
+(defun io-worker-loop (service)
+  (loop
+    (let* ((request (mp:channel-receive (io-service-channel service)))
+           (done (if (eq request :stop)
+                     (return)
+                     (io-request-done request))))
+      (multiple-value-bind (count errno)
+          (funcall (if (eq (io-request-op request) :read)
+                       #'core:io-pread
+                       #'core:io-pwrite)
+                   (io-request-fd request)
+                   (io-request-buffer request)
+                   (+ (io-request-start request) done)
+                   (io-request-end request)
+                   (+ (io-request-offset request) done))
+        (complete-request service request (if errno (- errno) count))))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Submission and completion
+;;;
+
+(defun submit-requests (service requests)
+  "Start REQUESTS. On io_uring they are submitted with one system call."
+  (ecase (io-service-backend service)
+    (:io-uring
+     (finish-completions
+      service
+      (mp:with-lock ((io-service-lock service))
+        (dolist (request requests)
+          (let ((id (allocate-request-id service request)))
+            ;; When the submission queue is full, hand it to the kernel,
+            ;; which empties it.
+            (loop until (prepare-request service request id)
+                  do (submit-ring service))))
+        (submit-ring service)
+        (shiftf (io-service-reaped service) nil))))
+    (:thread-pool
+     (dolist (request requests)
+       (mp:channel-send (io-service-channel service) request)))))
+
+(defun complete-request (service request result)
+  "Handle RESULT, the octet count or minus the errno, for REQUEST."
+  (if (minusp result)
+      (funcall (io-request-completion request)
+               (io-request-done request) (- result))
+      (let ((done (incf (io-request-done request) result)))
+        (if (and (eq (io-request-op request) :write)
+                 (plusp result)
+                 (< done (- (io-request-end request) (io-request-start request))))
+            (submit-requests service (list request))
+            (funcall (io-request-completion request) done nil)))))
+
+(defun check-octet-buffer (buffer start end)
+  (unless (typep buffer '(vector (unsigned-byte 8)))
+    (error 'type-error :datum buffer :expected-type '(vector (unsigned-byte 8))))
+  (let ((end (or end (length buffer))))
+    (unless (<= 0 start end (length buffer))
+      (error "Bad range [~d, ~d) for a buffer of length ~d" start end (length buffer)))
+    end))
+
+(defun target-fd (target)
+  (if (integerp target) target (file-stream-file-descriptor target)))
+
+(defun target-offset (target offset)
+  (cond (offset)
+        ((integerp target) 0)
+        (t (file-position target))))
+
+(defun async-transfer (op target buffer start end offset callback)
+  (let* ((end (check-octet-buffer buffer start end))
+         (future (mp::make-external-future))
+         (completion
+           (lambda (count errno)
+             (cond (errno
+                    (mp::finish-future future (make-async-io-error op errno) t))
+                   (callback
+                    (handler-case
+                        (mp::finish-future future
+                                           (multiple-value-list (funcall callback count)))
+                      (serious-condition (condition)
+                        (mp::finish-future future condition t))))
+                   (t (mp::finish-future future (list count)))))))
+    (submit-requests (io-service)
+                     (list (make-io-request op (target-fd target) buffer start end
+                                            (target-offset target offset)
+                                            completion)))
+    future))
+
+(defun async-read (target buffer &key (start 0) end offset callback)
+  "Start reading into BUFFER from TARGET, a file stream or file descriptor,
+and return a future for the number of octets read.
+BUFFER is a vector of (UNSIGNED-BYTE 8), filled from START to END. OFFSET
+is the position in the file, by default the stream's file position, or 0
+for a descriptor; the file position is not changed. If CALLBACK is given,
+it is called with the octet count when the read finishes, usually on an I/O
+process but possibly on one submitting other requests, and the future
+returns its values instead. Forcing the future signals an
+ASYNC-IO-ERROR if the read failed."
+  (async-transfer :read target buffer start end offset callback))
+
+(defun async-write (target buffer &key (start 0) end offset callback)
+  "Start writing BUFFER from START to END to TARGET, a file stream or file
+descriptor, and return a future for the number of octets written.
+OFFSET and CALLBACK are as for ASYNC-READ."
+  (async-transfer :write target buffer start end offset callback))
+
+(defstruct (io-batch (:constructor make-io-batch (future counts remaining)))
+  future counts remaining (errno nil))
+
+(defun async-transfer-sequence (op target buffer start end offset result)
+  (let* ((end (check-octet-buffer buffer start end))
+         (fd (target-fd target))
+         (offset (target-offset target offset))
+         (chunk-size (max 1 *async-io-chunk-size*))
+         (chunks (loop for chunk-start from start below end by chunk-size
+                       collect (cons chunk-start (min end (+ chunk-start chunk-size)))))
+         (batch (make-io-batch (mp::make-external-future)
+                               (make-array (length chunks) :initial-element 0)
+                               (length chunks))))
+    (flet ((finish ()
+             (let ((errno (io-batch-errno batch))
+                   (future (io-batch-future batch)))
+               (if errno
+                   (mp::finish-future future (make-async-io-error op errno) t)
+                   ;; Count up to the first short chunk, as a read stops
+                   ;; at end of file.
+                   (let ((position start))
+                     (loop for (chunk-start . chunk-end) in chunks
+                           for count across (io-batch-counts batch)
+                           do (incf position count)
+                           while (= count (- chunk-end chunk-start)))
+                     (mp::finish-future future
+                                        (list (funcall result position))))))))
+      (if (null chunks)
+          (finish)
+          (submit-requests
+           (io-service)
+           (loop for (chunk-start . chunk-end) in chunks
+                 for index from 0
+                 collect (let ((index index))
+                           (make-io-request
+                            op fd buffer chunk-start chunk-end
+                            (+ offset (- chunk-start start))
+                            (lambda (count errno)
+                              (setf (aref (io-batch-counts batch) index) count)
+                              (when errno
+                                (setf (io-batch-errno batch) errno))
+                              (when (zerop (mp:atomic-decf (io-batch-remaining batch)))
+                                (finish))))))))
+      (io-batch-future batch))))
+
+(defun async-read-sequence (sequence stream &key (start 0) end offset)
+  "Like READ-SEQUENCE on an octet vector, but return a future for the
+index of the first element not read. Large ranges are read as several
+requests submitted together. OFFSET is as for ASYNC-READ."
+  (async-transfer-sequence :read stream sequence start end offset #'identity))
+
+(defun async-write-sequence (sequence stream &key (start 0) end offset)
+  "Like WRITE-SEQUENCE on an octet vector, but return a future for SEQUENCE.
+Large ranges are written as several requests submitted together. OFFSET is
+as for ASYNC-READ."
+  (async-transfer-sequence :write stream sequence start end offset
+                           (lambda (position)
+                             (declare (ignore position))
+                             sequence)))
+
+(defun register-async-io-buffers (buffers)
+  "Register the octet vectors in the list BUFFERS with the kernel, replacing
+any registered before. Requests on registered buffers skip mapping them
+into the kernel each time. The buffers should be static vectors (see
+CORE:MAKE-STATIC-VECTOR) and must not be in use by any request when this
+is called. Without io_uring this does nothing."
+  (let ((service (io-service)))
+    (when (eq (io-service-backend service) :io-uring)
+      (mp:with-lock ((io-service-lock service))
+        ;; The old registration is dropped even if the new one fails.
+        (setf (io-service-registered service) nil)
+        (let ((errno (core:io-ring-register-buffers (io-service-ring service)
+                                                    buffers)))
+          (when errno
+            (error (make-async-io-error :register errno)))
+          (setf (io-service-registered service) (copy-list buffers)))))
+    buffers))
@@ -306,10 +306,53 @@
          (last (car (last types))))
     (values (list last arg-types) args)))
 
+;;; A foreign symbol cell is a (NAME . POINTER) cons that %FOREIGN-FUNCALL
+;;; call sites get at load time, one per symbol name, so reloading code
+;;; reuses the cells. The symbol is looked up with dlsym on the first call
+;;; and the pointer is kept in the cell, so later calls do not search the
+;;; loaded libraries again. The pointers are cleared when a library is
+;;; opened or closed, since that can change what a name resolves to or
+;;; unmap it, and when an image is saved, since addresses do not survive
+;;; a restart.
+
+(defvar *foreign-symbol-cells* (make-hash-table :test 'equal))
+(defvar *foreign-symbol-cells-lock* (mp:make-lock :name 'foreign-symbol-cells))
+
+(defun intern-foreign-symbol-cell (name)
+  (mp:with-lock (*foreign-symbol-cells-lock*)
+    (or (gethash name *foreign-symbol-cells*)
+        (setf (gethash name *foreign-symbol-cells*) (cons name nil)))))
+
+(defun resolve-foreign-symbol-cell (cell)
+  (setf (cdr cell)
+        (ensure-core-pointer (core:dlsym :rtld-default (car cell))
+                             "%foreign-funcall" (car cell))))
+
+(declaim (inline foreign-symbol-cell-pointer))
+(defun foreign-symbol-cell-pointer (cell)
+  (or (cdr cell) (resolve-foreign-symbol-cell cell)))
+
+(defun clear-foreign-symbol-cells ()
+  (mp:with-lock (*foreign-symbol-cells-lock*)
+    (maphash (lambda (name cell)
+               (declare (ignore name))
+               (setf (cdr cell) nil))
+             *foreign-symbol-cells*)))
+
+(defun clear-foreign-symbol-cells-on-save ()
+  (clear-foreign-symbol-cells))
+
+(eval-when (:load-toplevel :execute)
+  (cmp:register-save-hook 'clear-foreign-symbol-cells-on-save))
+
 (defmacro %foreign-funcall (name &rest arguments)
   (multiple-value-bind (signature args)
       (extract-signature arguments)
-    `(core:foreign-call-pointer ,signature (ensure-core-pointer (core:dlsym :rtld-default ,name) "%foreign-funcall" ,name) ,@args)))
+    (if (stringp name)
+        `(core:foreign-call-pointer ,signature
+           (foreign-symbol-cell-pointer (load-time-value (intern-foreign-symbol-cell ,name)))
+           ,@args)
+        `(core:foreign-call-pointer ,signature (ensure-core-pointer (core:dlsym :rtld-default ,name) "%foreign-funcall" ,name) ,@args))))
 
 (defmacro %foreign-funcall-pointer (ptr &rest arguments)
   (multiple-value-bind (signature args)
@@ -326,6 +369,7 @@
 ;;; Cache table from foreign-call signatures to caller functions.
 ;;; A caller takes a function pointer and its arguments as arguments.
 (defvar *foreign-callers* (make-hash-table :test 'equal))
+(defvar *foreign-callers-lock* (mp:make-lock :name 'foreign-callers))
 
 (defun make-foreign-caller (signature)
   (let ((fptr (gensym "FUNCTION-POINTER"))
@@ -338,16 +382,33 @@
         (ensure-core-pointer ,fptr "%%foreign-funcall" ,fptr)
         ,@args)))))
 
+;;; The compile happens outside the lock, so that one thread compiling a
+;;; caller doesn't stall foreign calls on every other thread. If two threads
+;;; race to make the same caller, the first one stored wins.
 (defun ensure-foreign-caller (signature)
-  (or (gethash signature *foreign-callers*)
-      (setf (gethash signature *foreign-callers*)
-            (make-foreign-caller signature))))
+  (or (mp:with-lock (*foreign-callers-lock*)
+        (gethash signature *foreign-callers*))
+      (let ((caller (make-foreign-caller signature)))
+        (mp:with-lock (*foreign-callers-lock*)
+          (or (gethash signature *foreign-callers*)
+              (setf (gethash signature *foreign-callers*) caller))))))
 
 (defun %%foreign-funcall (signature function-pointer &rest arguments)
   (apply (ensure-foreign-caller signature) function-pointer arguments))
 
+;;; Each call site gets a (SIGNATURE . CALLER) cell at load time, filled in
+;;; from *FOREIGN-CALLERS* on the first call. After that a foreign call is
+;;; a plain funcall of the caller with the pointer and arguments: no hash
+;;; lookup, no &rest list and no APPLY.
+
+(defun install-foreign-caller (cell)
+  (setf (cdr cell) (ensure-foreign-caller (car cell))))
+
 (defmacro core:foreign-call-pointer (signature pointer &rest arguments)
-  `(%%foreign-funcall ',signature ,pointer ,@arguments))
+  (let ((cell (gensym "CALLER-CELL")))
+    `(let ((,cell (load-time-value (list ',signature))))
+       (funcall (or (cdr ,cell) (install-foreign-caller ,cell))
+                ,pointer ,@arguments))))
 
 ;;; === F O R E I G N   L I B R A R Y   H A N D L I N G ===
 
@@ -359,12 +420,14 @@
       (%dlopen path)
     (if (not handle)
         (error "~A" error)
-        handle)))
+        (progn (clear-foreign-symbol-cells)
+               handle))))
 
 (declaim (inline %close-foreign-library))
 (defun %close-foreign-library (ptr)
   "Close a foreign library."
-  (%dlclose ptr))
+  (prog1 (%dlclose ptr)
+    (clear-foreign-symbol-cells)))
 
 (defun close-foreign-libraries-on-save ()
   (format t "Trying to close foreign libraries~%")
@@ -391,6 +454,111 @@
   (declare (ignore module))
   (%dlsym name))
 
+;;; === F O R E I G N   M E M O R Y   P O O L S ===
+
+;;; A foreign memory pool carves foreign buffers out of large blocks, so
+;;; many buffers cost one allocation, and frees them all at once.
+;;;
+;;; A pool also makes pinned Lisp vectors: static vectors, which the
+;;; garbage collector never moves and does not scan. C code can fill one
+;;; through the pointer the pool returns with it, and Lisp sees the data
+;;; with no copying. Clasp stores the elements of a simple vector inside
+;;; the vector object, so a Lisp vector cannot be laid over memory from
+;;; malloc; the pinned vector is the buffer instead.
+
+(defstruct (foreign-memory-pool
+            (:constructor %make-foreign-memory-pool (block-size)))
+  (block-size 0 :type fixnum)
+  ;; Foreign data blocks owned by the pool.
+  (blocks nil :type list)
+  ;; The block buffers are being carved from, and how much of it is used.
+  (current nil)
+  (fill 0 :type fixnum)
+  ;; Pinned vectors kept alive until the pool is freed.
+  (vectors nil :type list)
+  (lock (mp:make-lock :name 'foreign-memory-pool)))
+
+(defun make-foreign-memory-pool (&key (block-size 1048576))
+  "Make a pool that allocates foreign memory BLOCK-SIZE bytes at a time."
+  (%make-foreign-memory-pool block-size))
+
+(defun pool-new-block (pool size)
+  (let ((block (%allocate-foreign-data size)))
+    (push block (foreign-memory-pool-blocks pool))
+    block))
+
+(defun pool-carve (pool block size alignment)
+  "Return a pointer to SIZE bytes of BLOCK past the pool's fill mark, or NIL
+if they don't fit."
+  (let* ((base (%foreign-data-address block))
+         (start (- (* alignment (ceiling (+ base (foreign-memory-pool-fill pool)) alignment))
+                   base)))
+    (when (<= (+ start size) (foreign-data-size block))
+      (setf (foreign-memory-pool-fill pool) (+ start size))
+      (%inc-pointer block start))))
+
+(defun pool-allocate (pool size alignment)
+  (let ((current (foreign-memory-pool-current pool)))
+    (or (and current (pool-carve pool current size alignment))
+        (if (> (+ size alignment) (floor (foreign-memory-pool-block-size pool) 4))
+            ;; A large buffer gets a block of its own, and the current
+            ;; block stays open for small ones.
+            (let* ((block (pool-new-block pool (+ size alignment)))
+                   (base (%foreign-data-address block)))
+              (%inc-pointer block (- (* alignment (ceiling base alignment)) base)))
+            (progn
+              (setf (foreign-memory-pool-current pool)
+                    (pool-new-block pool (foreign-memory-pool-block-size pool))
+                    (foreign-memory-pool-fill pool) 0)
+              (pool-carve pool (foreign-memory-pool-current pool) size alignment))))))
+
+(defun foreign-pool-alloc (pool size &key (alignment 16))
+  "Return a pointer to SIZE bytes of foreign memory from POOL, aligned to
+ALIGNMENT bytes. The memory lives until the pool is freed."
+  (mp:with-lock ((foreign-memory-pool-lock pool))
+    (pool-allocate pool size alignment)))
+
+(defun foreign-pool-alloc-many (pool size count &key (alignment 16))
+  "Return a list of COUNT pointers to SIZE bytes of foreign memory each."
+  (mp:with-lock ((foreign-memory-pool-lock pool))
+    (loop repeat count collect (pool-allocate pool size alignment))))
+
+(defun foreign-pool-make-vector (pool element-type length)
+  "Make a pinned vector of LENGTH elements of ELEMENT-TYPE, such as
+(UNSIGNED-BYTE 8), DOUBLE-FLOAT or FIXNUM, kept alive by POOL. Returns the
+vector and a foreign pointer to its first element."
+  (let ((vector (core:make-static-vector (upgraded-array-element-type element-type) length)))
+    (mp:with-lock ((foreign-memory-pool-lock pool))
+      (push vector (foreign-memory-pool-vectors pool)))
+    (values vector (core:static-vector-pointer vector 0))))
+
+(defun free-foreign-memory-pool (pool)
+  "Free all the foreign memory of POOL. Pointers it returned must not be
+used afterwards; its pinned vectors stay valid while anything refers to them."
+  (mp:with-lock ((foreign-memory-pool-lock pool))
+    (mapc #'%free-foreign-data (foreign-memory-pool-blocks pool))
+    (setf (foreign-memory-pool-blocks pool) nil
+          (foreign-memory-pool-current pool) nil
+          (foreign-memory-pool-fill pool) 0
+          (foreign-memory-pool-vectors pool) nil))
+  pool)
+
+(defmacro with-foreign-memory-pool ((var &rest options) &body body)
+  `(let ((,var (make-foreign-memory-pool ,@options)))
+     (unwind-protect
+          (progn ,@body)
+       (free-foreign-memory-pool ,var))))
+
+(defun %copy-vector-to-foreign (vector pointer &key (start 0) end (offset 0))
+  "Copy the elements of the specialized VECTOR from START below END to the
+foreign memory OFFSET bytes past POINTER, with one memcpy."
+  (%copy-to-foreign vector start (or end (length vector)) pointer offset))
+
+(defun %copy-foreign-to-vector (pointer vector &key (start 0) end (offset 0))
+  "Fill the elements of the specialized VECTOR from START below END from
+the foreign memory OFFSET bytes past POINTER, with one memcpy."
+  (%copy-from-foreign pointer offset vector start (or end (length vector))))
+
 ;;;----------------------------------------------------------------------------
 ;;;
 ;;; F L I   I N I T I A L I Z A T I O N
@@ -546,6 +714,14 @@
             %foreign-symbol-pointer
             %foreign-type-size
             %foreign-type-alignment
+            make-foreign-memory-pool
+            foreign-pool-alloc
+            foreign-pool-alloc-many
+            foreign-pool-make-vector
+            free-foreign-memory-pool
+            with-foreign-memory-pool
+            %copy-vector-to-foreign
+            %copy-foreign-to-vector
             %defcallback
             %callback
             %get-callback
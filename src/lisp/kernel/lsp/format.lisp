@@ -444,10 +444,118 @@
                           (coerce string-or-fun 'simple-string))))
                (*output-layout-mode* nil)
                (*default-format-error-control-string* string)
-               (*logical-block-popper* nil))
+               (*logical-block-popper* nil)
+               (compiled (format-cache-lookup string)))
           (fmt-log "line 498")
-          (interpret-directive-list stream (tokenize-control-string string)
-                                    orig-args args)))))
+          (if (functionp compiled)
+              (funcall compiled stream args)
+              (interpret-directive-list stream compiled orig-args args))))))
+
+;;;; FORMAT CACHE
+;;;
+;;; Control strings that the compiler macro never sees (built at runtime,
+;;; or passed through APPLY) would otherwise be tokenized on every call.
+;;; FORMAT-CACHE-LOOKUP remembers the result of compiling each one: a
+;;; closure if the control string uses only simple directives, or else
+;;; the tokenized directive list for INTERPRET-DIRECTIVE-LIST.
+;;;
+;;; Weak hash tables only support EQ, and dynamically built control strings
+;;; are almost never EQ to one another, so this is an EQUAL table that is
+;;; flushed once it holds *FORMAT-CACHE-LIMIT* entries.  Keys are private
+;;; copies, so that mutating a string after passing it to FORMAT is harmless.
+
+(defparameter *format-cache-limit* 1024)
+(defvar *format-cache* (make-hash-table :test #'equal :thread-safe t))
+
+(defun format-cache-lookup (string)
+  (declare (simple-string string))
+  (or (gethash string *format-cache*)
+      (let* ((key (copy-seq string))
+             (directives (tokenize-control-string key))
+             (compiled (or (compile-simple-directives directives)
+                           directives)))
+        (when (>= (hash-table-count *format-cache*) *format-cache-limit*)
+          (clrhash *format-cache*))
+        (setf (gethash key *format-cache*) compiled))))
+
+;;; A directive is simple if it is one of ~A ~S ~D ~% without parameters
+;;; or modifiers, or a ~{...~} of simple directives.  These make up most
+;;; logging output, and skip the interpreter's per directive dispatch.
+(defun simple-directive-p (directive char)
+  (and (char= (format-directive-character directive) char)
+       (null (format-directive-params directive))
+       (not (format-directive-colonp directive))
+       (not (format-directive-atsignp directive))))
+
+(defmacro simple-next-arg (directive)
+  `(if args
+       (pop args)
+       (error 'format-error
+              :complaint "No more arguments."
+              :offset (1- (format-directive-end ,directive)))))
+
+;;; True if DIRECTIVE always consumes an argument when it is simple.
+(defun simple-consuming-directive-p (directive)
+  (and (format-directive-p directive)
+       (member (format-directive-character directive) '(#\A #\S #\D #\{)
+               :test #'char=)))
+
+;;; Return a function of (STREAM ARGS) that performs DIRECTIVES and returns
+;;; the unconsumed ARGS, or NIL if DIRECTIVES contain anything not simple.
+(defun compile-simple-directives (directives)
+  (let ((steps nil))
+    (loop
+      (when (null directives)
+        (return))
+      (let ((directive (pop directives)))
+        (push
+         (cond ((stringp directive)
+                (lambda (stream args)
+                  (write-string directive stream)
+                  args))
+               ((simple-directive-p directive #\A)
+                (lambda (stream args)
+                  (princ (simple-next-arg directive) stream)
+                  args))
+               ((simple-directive-p directive #\S)
+                (lambda (stream args)
+                  (prin1 (simple-next-arg directive) stream)
+                  args))
+               ((simple-directive-p directive #\D)
+                (lambda (stream args)
+                  (write (simple-next-arg directive) :stream stream
+                         :base 10 :radix nil :escape nil)
+                  args))
+               ((simple-directive-p directive #\%)
+                (lambda (stream args)
+                  (terpri stream)
+                  args))
+               ((simple-directive-p directive #\{)
+                ;; A body that consumes no arguments is left to the
+                ;; interpreter, which signals an error instead of looping.
+                (let* ((close (find-directive directives #\} nil))
+                       (posn (and close (position close directives)))
+                       (body (and posn
+                                  (not (format-directive-colonp close))
+                                  (null (format-directive-params close))
+                                  (some #'simple-consuming-directive-p
+                                        (subseq directives 0 posn))
+                                  (compile-simple-directives
+                                   (subseq directives 0 posn)))))
+                  (unless body
+                    (return-from compile-simple-directives nil))
+                  (setf directives (nthcdr (1+ posn) directives))
+                  (lambda (stream args)
+                    (let ((sublist (simple-next-arg directive)))
+                      (loop while sublist
+                            do (setf sublist (funcall body stream sublist))))
+                    args)))
+               (t (return-from compile-simple-directives nil)))
+         steps)))
+    (let ((steps (nreverse steps)))
+      (lambda (stream args)
+        (dolist (step steps args)
+          (setf args (funcall step stream args)))))))
 
 (defun interpret-directive-list (stream directives orig-args args)
   (fmt-log "interpret-directive-list directives: " directives " orig-args: " orig-args " args: " args)
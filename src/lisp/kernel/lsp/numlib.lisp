@@ -70,15 +70,19 @@
 Returns the integer square root of INTEGER."
   (unless (and (integerp i) (>= i 0))
     (error 'type-error :datum i :expected-type 'unsigned-byte))
-  (if (zerop i)
-      0
-      (let ((n (integer-length i)))
-        (do ((x (ash 1 (ceiling n 2))))
-            (nil)
-          (let ((y (floor i x)))
-            (when (<= x y)
-              (return x))
-            (setq x (floor (+ x y) 2)))))))
+  (cond
+    ((zerop i) 0)
+    ;; GMP's square root is subquadratic, where Newton's iteration below
+    ;; does a full division per step.
+    ((core:bignump i) (core:next-isqrt i))
+    (t
+     (let ((n (integer-length i)))
+       (do ((x (ash 1 (ceiling n 2))))
+           (nil)
+         (let ((y (floor i x)))
+           (when (<= x y)
+             (return x))
+           (setq x (floor (+ x y) 2))))))))
 
 (defun phase (x)
   "Args: (number)
@@ -1096,7 +1096,12 @@
   ;; A hash table mapping things to entries for type specifiers of the
   ;; form (CONS (MEMBER <thing>)).  If the type specifier is of this form,
   ;; we put it in this hash table instead of the regular entries table.
-  (cons-entries (make-hash-table :test #'eql)))
+  (cons-entries (make-hash-table :test #'eql))
+  ;;
+  ;; T iff ENTRIES holds anything besides the initial entries.  The initial
+  ;; entries only match arrays and conses, so without custom entries every
+  ;; other object gets the default printer without searching ENTRIES.
+  (custom-entries-p nil))
 
 (defun %print-pprint-dispatch-table (table stream depth)
   (declare (ignore depth))
@@ -1133,7 +1138,8 @@
 	   #.+ecl-safe-declarations+)
   (let* ((orig (or table *initial-pprint-dispatch*)))
     (let* ((new (make-pprint-dispatch-table
-		 :entries (copy-list (pprint-dispatch-table-entries orig))))
+		 :entries (copy-list (pprint-dispatch-table-entries orig))
+                 :custom-entries-p (pprint-dispatch-table-custom-entries-p orig)))
 	   (new-cons-entries (pprint-dispatch-table-cons-entries new)))
       (maphash #'(lambda (key value)
 		   (setf (gethash key new-cons-entries) value))
@@ -1147,6 +1153,11 @@
   (declare (type (or pprint-dispatch-table null) table)
 	   (ext:check-arguments-type)
 	   #.+ecl-safe-declarations+)
+  (let ((table (or table *initial-pprint-dispatch*)))
+    (unless (or (consp object)
+                (arrayp object)
+                (pprint-dispatch-table-custom-entries-p table))
+      (return-from pprint-dispatch (values #'default-pprint-dispatch nil))))
   (let* ((table (or table *initial-pprint-dispatch*))
 	 (cons-entry
 	  (and (consp object)
@@ -1212,6 +1223,9 @@
 		(delete type (pprint-dispatch-table-entries table)
 			:key #'pprint-dispatch-entry-type
 			:test #'equal))))
+  (setf (pprint-dispatch-table-custom-entries-p table)
+        (notevery #'pprint-dispatch-entry-initial-p
+                  (pprint-dispatch-table-entries table)))
   nil)
 
 ;;; The guts of print-unreadable-object, inspired by SBCL. This is
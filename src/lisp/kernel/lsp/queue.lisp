@@ -54,12 +54,10 @@
 (defstruct (queue
             (:constructor make-queue
                 (name
-                 &aux
-                   (lock (mp:make-lock :name (format nil "~A-LOCK" name)))
-                   (not-empty (mp:make-condition-variable :name (format nil "~A-NOT-EMPTY" name)))))
+                 &aux (channel (mp:make-channel :name name))))
             (:copier nil)
             (:predicate queuep))
-  name (head nil) (tail nil) lock not-empty)
+  name channel)
 
 (eval-when (:compile-toplevel :load-toplevel :execute)
   (setf (documentation 'make-queue 'function) "
@@ -68,20 +66,11 @@ RETURN:     A new queue named NAME
         (documentation 'queue-name 'function) "
 RETURN:     The name of the QUEUE.
 "
-        (documentation 'queue-head 'function) "
-RETURN:     the head CONS cell of the QUEUE.
-"
-        (documentation 'queue-tail 'function) "
-RETURN:     the tail CONS cell of the QUEUE.
+        (documentation 'queue-channel 'function) "
+RETURN:     The unbounded MP:CHANNEL holding the messages of the QUEUE.
 "
         (documentation 'queuep 'function) "
 RETURN:     Predicate for the QUEUE type.
-"
-        (documentation 'queue-lock 'function) "
-RETURN:     The lock of the QUEUE.
-"
-        (documentation 'queue-not-empty 'function) "
-RETURN:     The NOT-EMPTY condition variable of the QUEUE.
 "))
 
 (defun atomic-enqueue (queue message)
@@ -90,52 +79,31 @@ DO:         Atomically enqueues the MESSAGE in the QUEUE.
 
 RETURN:     MESSAGE
 "
-  (mp:with-lock ((queue-lock queue))
-    (if (queue-tail queue)
-        (setf (cdr (queue-tail queue)) (list message)
-              (queue-tail queue) (cdr (queue-tail queue)))
-        (setf (queue-head queue) (setf (queue-tail queue) (list message))))
-    (mp:condition-variable-signal (queue-not-empty queue)))
+  (mp:channel-send (queue-channel queue) message)
   message)
 
 (defun dequeue (queue &key (timeout nil timeoutp) (timeout-val nil timeout-val-p))
   "
 DO:         Atomically, dequeue the first message from the QUEUE.  If
-            the queue is empty,  then wait on the not-empty condition
-            of the queue.
+            the queue is empty,  then wait for a message, for at most
+            TIMEOUT seconds if TIMEOUT is given.
 
-RETURN:     the dequeued MESSAGE.
+RETURN:     the dequeued MESSAGE, or TIMEOUT-VAL on timeout.
 "
-  (mp:with-lock ((queue-lock queue))
-    (loop :until (queue-head queue)
-          :do (if timeout
-                  (mp:condition-variable-timedwait (queue-not-empty queue) (queue-lock queue) timeout)
-                  (mp:condition-variable-wait (queue-not-empty queue) (queue-lock queue)))
-          :if (and timeout (null (queue-head queue)))
-            :do (return-from dequeue timeout-val))
-    (if (eq (queue-head queue) (queue-tail queue))
-        (prog1 (car (queue-head queue))
-          (setf (queue-head queue) nil
-                (queue-tail queue) nil))
-        (pop (queue-head queue)))))
+  (declare (ignore timeoutp timeout-val-p))
+  (multiple-value-bind (message receivedp)
+      (mp:channel-receive (queue-channel queue) :timeout timeout)
+    (if receivedp message timeout-val)))
 
 (defun dequeue-timed (queue time)
   "
 DO:         Atomically, dequeue the first message from the QUEUE.  If
-            the queue is empty,  then wait on the not-empty condition
-            of the queue.
+            the queue is empty,  then wait for a message.
 
 RETURN:     the dequeued MESSAGE.
 "
   (declare (ignore time))
-  (mp:with-lock ((queue-lock queue))
-    (loop :until (queue-head queue)
-          :do (mp:condition-variable-wait (queue-not-empty queue) (queue-lock queue)))
-    (if (eq (queue-head queue) (queue-tail queue))
-        (prog1 (car (queue-head queue))
-          (setf (queue-head queue) nil
-                (queue-tail queue) nil))
-        (pop (queue-head queue)))))
+  (values (mp:channel-receive (queue-channel queue))))
 
 (defun queue-count (queue)
   "
@@ -144,8 +112,7 @@ RETURN:     The number of entries in the QUEUE.
 NOTE:       The result may be falsified immediately, if another thread
             enqueues or dequeues.
 "
-  (mp:with-lock ((queue-lock queue))
-    (length (queue-head queue))))
+  (mp:channel-count (queue-channel queue)))
 
 (defun queue-emptyp (queue)
   "
@@ -155,7 +122,7 @@ NOTE:       The result may be falsified immediately, becoming false if
             another thread enqueues, or becoming true if another
             thread dequeues.
 "
-  (not (queue-head queue)))
+  (zerop (mp:channel-count (queue-channel queue))))
 
 ;;;; THE END ;;;;
          
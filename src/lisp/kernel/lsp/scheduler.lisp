@@ -0,0 +1,349 @@
+;;;; scheduler.lisp -- a work-stealing task scheduler with futures.
+
+(in-package "MP")
+
+(export '(future futurep future-done-p force pmap preduce psort
+          *scheduler-worker-count* *psort-threshold*))
+
+;;; A FUTURE runs its body on a pool of worker processes, and FORCE waits for
+;;; and returns its values. Each worker owns a Chase-Lev deque of tasks: it
+;;; pushes and pops at the bottom, while idle workers steal from the top.
+;;; Futures created outside the pool go into a shared injection list.
+;;; A worker that forces an unfinished future runs other tasks meanwhile,
+;;; and runs the future itself if nobody has started it, so nested futures
+;;; never deadlock the pool.
+;;;
+;;; Workers are ordinary processes made by PROCESS-RUN-FUNCTION, so they have
+;;; full thread-local state and dynamic bindings work as usual inside tasks.
+;;; Bindings are not conveyed from the creator of a future to its worker.
+
+;;; ------------------------------------------------------------
+;;;
+;;; Chase-Lev work-stealing deque
+;;; (Chase & Lev, "Dynamic circular work-stealing deque", SPAA 2005)
+;;;
+
+(defstruct (ws-deque (:constructor make-ws-deque ()))
+  (top 0) (bottom 0) (buffer (make-array 64 :initial-element nil)))
+
+(defun ws-deque-push (deque task)
+  "Push TASK on the bottom of DEQUE. Only the owner may call this."
+  (let* ((bottom (ws-deque-bottom deque))
+         (top (atomic (ws-deque-top deque)))
+         (buffer (ws-deque-buffer deque))
+         (size (length buffer)))
+    (when (>= (- bottom top) (1- size))
+      ;; Grow. Thieves may still read the old buffer, which stays valid.
+      (let ((new (make-array (* 2 size) :initial-element nil)))
+        (loop for i from top below bottom
+              do (setf (svref new (logand i (1- (* 2 size))))
+                       (svref buffer (logand i (1- size)))))
+        (setf (atomic (ws-deque-buffer deque)) new
+              buffer new size (* 2 size))))
+    (setf (atomic (svref buffer (logand bottom (1- size)))) task)
+    (setf (atomic (ws-deque-bottom deque)) (1+ bottom))
+    task))
+
+(defun ws-deque-pop (deque)
+  "Pop a task from the bottom of DEQUE, or return NIL. Only the owner may
+call this."
+  (let* ((bottom (1- (ws-deque-bottom deque)))
+         (buffer (ws-deque-buffer deque)))
+    (setf (atomic (ws-deque-bottom deque)) bottom)
+    (let ((top (atomic (ws-deque-top deque))))
+      (cond ((< bottom top)
+             (setf (atomic (ws-deque-bottom deque)) top)
+             nil)
+            (t
+             (let ((task (atomic (svref buffer (logand bottom (1- (length buffer)))))))
+               (cond ((> bottom top) task)
+                     ;; Last element: race any thief for it.
+                     (t (prog1 (and (eql (cas (ws-deque-top deque) top (1+ top)) top)
+                                    task)
+                          (setf (atomic (ws-deque-bottom deque)) (1+ top)))))))))))
+
+(defun ws-deque-steal (deque)
+  "Take a task from the top of DEQUE, or return NIL if it is empty or
+another process won the race."
+  (let* ((top (atomic (ws-deque-top deque)))
+         (bottom (atomic (ws-deque-bottom deque))))
+    (when (< top bottom)
+      (let* ((buffer (atomic (ws-deque-buffer deque)))
+             (task (atomic (svref buffer (logand top (1- (length buffer)))))))
+        (and (eql (cas (ws-deque-top deque) top (1+ top)) top)
+             task)))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Scheduler
+;;;
+
+(defvar *scheduler-worker-count* nil
+  "Number of worker processes the scheduler starts on first use.
+NIL means one per logical processor.")
+
+(defstruct (scheduler (:constructor %make-scheduler (deques)))
+  deques
+  (processes nil)
+  ;; Tasks submitted from outside the pool.
+  (injected nil)
+  ;; Idle workers park on this.
+  (lock (make-lock :name 'scheduler))
+  (wakeup (make-condition-variable :name 'scheduler-wakeup))
+  (sleepers 0))
+
+(defvar *scheduler* nil)
+(defvar *scheduler-lock* (make-lock :name 'scheduler-creation))
+
+;;; Bound in worker processes to that worker's deque and its index.
+(defvar *worker-deque* nil)
+(defvar *worker-index* 0)
+
+(defun scheduler ()
+  (or *scheduler*
+      (with-lock (*scheduler-lock*)
+        (or *scheduler*
+            (let* ((count (or *scheduler-worker-count*
+                              (max 1 (core:num-logical-processors))))
+                   (scheduler (%make-scheduler
+                               (coerce (loop repeat count collect (make-ws-deque))
+                                       'simple-vector))))
+              (setf (scheduler-processes scheduler)
+                    (loop for deque across (scheduler-deques scheduler)
+                          for index from 0
+                          collect (let ((deque deque) (index index))
+                                    (process-run-function
+                                     'scheduler-worker
+                                     (lambda ()
+                                       (let ((*worker-index* index))
+                                         (worker-loop scheduler deque)))))))
+              (setf *scheduler* scheduler))))))
+
+;;; The workers don't survive a snapshot, so forget the scheduler when
+;;; saving; the first future after a restore makes a fresh one.
+(defun forget-scheduler-on-save ()
+  (setf *scheduler* nil))
+
+(eval-when (:load-toplevel :execute)
+  (cmp:register-save-hook 'forget-scheduler-on-save))
+
+(defun wake-workers (scheduler)
+  (when (plusp (atomic (scheduler-sleepers scheduler)))
+    (with-lock ((scheduler-lock scheduler))
+      (condition-variable-signal (scheduler-wakeup scheduler)))))
+
+(defun submit-task (scheduler task)
+  (if *worker-deque*
+      (ws-deque-push *worker-deque* task)
+      (atomic-push task (scheduler-injected scheduler)))
+  (wake-workers scheduler))
+
+(defun find-task (scheduler)
+  "Return a task for the current worker to run, or NIL."
+  (or (and *worker-deque* (ws-deque-pop *worker-deque*))
+      (atomic-pop (scheduler-injected scheduler))
+      (let* ((deques (scheduler-deques scheduler))
+             (count (length deques))
+             ;; Start with our neighbour, so thieves spread out.
+             (start (1+ *worker-index*)))
+        (loop for i below count
+              for victim = (svref deques (mod (+ start i) count))
+              for task = (and (not (eq victim *worker-deque*))
+                              (ws-deque-steal victim))
+              when task return task))))
+
+(defun worker-loop (scheduler deque)
+  (let ((*worker-deque* deque))
+    (loop
+      (let ((task (find-task scheduler)))
+        (unless task
+          (with-lock ((scheduler-lock scheduler))
+            ;; A submitter pushes its task and then looks for sleepers, so
+            ;; once we count ourselves either it sees us and signals, which
+            ;; it can't do until we wait, or we see its task here.
+            (atomic-incf (scheduler-sleepers scheduler))
+            (loop until (setf task (find-task scheduler))
+                  do (condition-variable-wait (scheduler-wakeup scheduler)
+                                              (scheduler-lock scheduler)))
+            (atomic-decf (scheduler-sleepers scheduler))))
+        (funcall task)))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Futures
+;;;
+
+(defstruct (future (:constructor %make-future (function))
+                   (:predicate futurep))
+  function
+  ;; :PENDING, :RUNNING, :DONE or :FAILED
+  (state :pending)
+  (values nil)
+  (lock nil)
+  (done nil))
+
+(defun finish-future (future values &optional failed)
+  "Store VALUES, the list of values FORCE returns, in FUTURE and wake its
+waiters. If FAILED is true, VALUES is instead the condition FORCE signals."
+  (setf (future-values future) values
+        (atomic (future-state future)) (if failed :failed :done))
+  (let ((lock (atomic (future-lock future))))
+    (when lock
+      (with-lock (lock)
+        (condition-variable-broadcast (future-done future))))))
+
+(defun run-future (future)
+  "Run FUTURE's function here unless another process has claimed it."
+  (when (eq (cas (future-state future) :pending :running) :pending)
+    (let ((function (future-function future)))
+      (setf (future-function future) nil)
+      (handler-case
+          (finish-future future (multiple-value-list (funcall function)))
+        (serious-condition (condition)
+          (finish-future future condition t))))))
+
+(defun make-external-future ()
+  "Return a future that the scheduler never runs. Whatever produces its
+result, such as the completion of an I/O request, calls FINISH-FUTURE."
+  (let ((future (%make-future nil)))
+    (setf (future-state future) :running)
+    future))
+
+(defun submit-future (function)
+  (let ((future (%make-future function)))
+    (submit-task (scheduler) (lambda () (run-future future)))
+    future))
+
+(defmacro future (&body body)
+  "Return a future that evaluates BODY on a scheduler worker."
+  `(submit-future (lambda () ,@body)))
+
+(defun future-done-p (future)
+  (member (atomic (future-state future)) '(:done :failed)))
+
+(defun wait-for-future (future)
+  (let ((scheduler (scheduler)))
+    ;; Run it ourselves if nobody has picked it up yet.
+    (run-future future)
+    (if *worker-deque*
+        ;; Keep the worker busy until the future is finished.
+        (loop until (future-done-p future)
+              do (let ((task (find-task scheduler)))
+                   (if task (funcall task) (process-yield))))
+        (progn
+          ;; The condition variable must exist before the lock does:
+          ;; FINISH-FUTURE only signals once it sees the lock, and it
+          ;; stores the state before looking, so we either see the future
+          ;; done or get woken.
+          (unless (atomic (future-lock future))
+            (cas (future-done future) nil
+                 (make-condition-variable :name 'future-done))
+            (cas (future-lock future) nil (make-lock :name 'future)))
+          (with-lock ((future-lock future))
+            (loop until (future-done-p future)
+                  do (condition-variable-wait (future-done future)
+                                              (future-lock future))))))))
+
+(defun force (future)
+  "Wait for FUTURE to finish and return its values. If evaluating it signaled
+a serious condition, signal that condition here. Non-futures are returned
+as they are."
+  (cond ((not (futurep future)) future)
+        (t (unless (future-done-p future)
+             (wait-for-future future))
+           (if (eq (atomic (future-state future)) :failed)
+               (error (future-values future))
+               (values-list (future-values future))))))
+
+;;; ------------------------------------------------------------
+;;;
+;;; Parallel sequence functions
+;;;
+
+(defun chunk-bounds (length)
+  "Split [0, LENGTH) into a list of (start . end) ranges, a few per worker."
+  (let* ((workers (length (scheduler-deques (scheduler))))
+         (size (max 1 (ceiling length (* 4 workers)))))
+    (loop for start from 0 below length by size
+          collect (cons start (min length (+ start size))))))
+
+(defun chunkable (sequence)
+  ;; SUBSEQ on a list is linear, so chunk a vector instead.
+  (if (listp sequence) (coerce sequence 'simple-vector) sequence))
+
+(defun pmap (result-type function sequence &rest more-sequences)
+  "Like MAP, but calls FUNCTION on chunks of the sequences in parallel.
+FUNCTION may be called in any order and on any process."
+  (let* ((sequences (mapcar #'chunkable (cons sequence more-sequences)))
+         (length (reduce #'min sequences :key #'length))
+         (futures
+           (loop for (start . end) in (chunk-bounds length)
+                 collect (let ((start start) (end end))
+                           (future
+                             (apply #'map (if result-type 'list nil) function
+                                    (mapcar (lambda (s) (subseq s start end))
+                                            sequences)))))))
+    (cond ((null result-type) (mapc #'force futures) nil)
+          ;; Each chunk is a fresh list, so splice them together.
+          ((subtypep result-type 'list)
+           (loop for future in futures nconc (force future)))
+          (t
+           (let ((result (make-sequence result-type length)))
+             (loop with index = 0
+                   for future in futures
+                   do (dolist (element (force future))
+                        (setf (elt result index) element)
+                        (incf index)))
+             result)))))
+
+(defun preduce (function sequence &key key (initial-value nil initial-value-p))
+  "Like REDUCE, but reduces chunks of SEQUENCE in parallel and then reduces
+the partial results. FUNCTION must be associative."
+  (let* ((sequence (chunkable sequence))
+         (partials
+          (mapcar #'force
+                  (loop for (start . end) in (chunk-bounds (length sequence))
+                        collect (let ((start start) (end end))
+                                  (future (reduce function sequence
+                                                  :start start :end end
+                                                  :key key)))))))
+    (if initial-value-p
+        (reduce function partials :initial-value initial-value)
+        (reduce function partials))))
+
+(defvar *psort-threshold* 100000
+  "PSORT sorts vectors shorter than this without the scheduler.")
+
+(defun psort (vector predicate &key key stable)
+  "Like SORT on VECTOR, or STABLE-SORT if STABLE is true, but sorts chunks of
+VECTOR in parallel and then merges them pairwise, also in parallel. Vectors
+shorter than *PSORT-THRESHOLD* are sorted as usual."
+  (let ((key (if key (core:coerce-fdesignator key) #'identity))
+        (predicate (core:coerce-fdesignator predicate))
+        (length (length vector)))
+    (if (< length *psort-threshold*)
+        (core::sort-vector-range vector 0 length predicate key stable)
+        (let ((ranges (chunk-bounds length)))
+          (mapc #'force
+                (loop for (start . end) in ranges
+                      collect (let ((start start) (end end))
+                                (future (core::sort-vector-range vector start end
+                                                                 predicate key stable)))))
+          ;; Merge neighbouring ranges until one is left.
+          (loop while (rest ranges)
+                do (setf ranges
+                         (mapcar #'force
+                                 (loop for (left right) on ranges by #'cddr
+                                       collect (if right
+                                                   (let ((start (car left))
+                                                         (middle (car right))
+                                                         (end (cdr right)))
+                                                     (future
+                                                       (or (and (eq key #'identity)
+                                                                (core:native-merge vector start middle end predicate))
+                                                           (core::merge-vector-runs
+                                                            vector start middle end predicate key
+                                                            (make-array (- middle start))))
+                                                       (cons start end)))
+                                                   left)))))
+          vector))))
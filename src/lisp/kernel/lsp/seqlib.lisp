@@ -409,8 +409,50 @@
 	  :start start :end end :from-end from-end :count count
 	  :test-not #'unsafe-funcall1 :key key))
 
+;;; COUNT, FIND and POSITION of a bit in a bit vector, with the default test
+;;; and no key, go to the word-at-a-time kernels in array_bit.cc.
+(defun bit-vector-search-p (item sequence test test-not key)
+  (and (bit-vector-p sequence)
+       (or (eql item 0) (eql item 1))
+       (null test-not) (null key)
+       (or (null test)
+           (eq test 'eql) (eq test #'eql)
+           (eq test 'eq) (eq test #'eq))))
+
+(defun bit-vector-count (bit vector start end)
+  (with-start-end (start end vector)
+    (with-array-data ((data vector) offset)
+      (let ((ones (core:sbv-count-ones data (+ start offset) (+ end offset))))
+        (if (eql bit 1) ones (- end start ones))))))
+
+(defun bit-vector-position (bit vector start end from-end)
+  (with-start-end (start end vector)
+    (with-array-data ((data vector) offset)
+      (let ((index (core:sbv-position bit data (+ start offset) (+ end offset)
+                                      from-end)))
+        (and index (- index offset))))))
+
+;;; SEARCH on two strings, and POSITION and FIND of a character in a
+;;; string, use the native search in string.cc when the test is one of
+;;; these and there is no key. Returns :EXACT, :FOLD or NIL.
+(defun string-search-mode (test test-not key)
+  (cond ((or test-not key) nil)
+        ((or (null test)
+             (eq test 'eql) (eq test #'eql)
+             (eq test 'eq) (eq test #'eq)
+             (eq test 'char=) (eq test #'char=))
+         :exact)
+        ((or (eq test 'char-equal) (eq test #'char-equal))
+         :fold)))
+
+(defun string-position (char string start end from-end mode)
+  (with-start-end (start end string)
+    (core:search-char char string start end from-end (eq mode :fold))))
+
 (defun count (item sequence
               &key test test-not from-end (start 0) end key)
+  (when (bit-vector-search-p item sequence test test-not key)
+    (return-from count (bit-vector-count item sequence start end)))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence l)
@@ -517,6 +559,15 @@
 
 
 (defun find (item sequence &key test test-not (start 0) end from-end key)
+  (when (bit-vector-search-p item sequence test test-not key)
+    (return-from find
+      (and (bit-vector-position item sequence start end from-end) item)))
+  (when (and (characterp item) (stringp sequence))
+    (let ((mode (string-search-mode test test-not key)))
+      (when mode
+        (return-from find
+          (let ((index (string-position item sequence start end from-end mode)))
+            (and index (char sequence index)))))))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence)
@@ -539,6 +590,14 @@
 
 
 (defun position (item sequence &key test test-not from-end (start 0) end key)
+  (when (bit-vector-search-p item sequence test test-not key)
+    (return-from position
+      (bit-vector-position item sequence start end from-end)))
+  (when (and (characterp item) (stringp sequence))
+    (let ((mode (string-search-mode test test-not key)))
+      (when mode
+        (return-from position
+          (string-position item sequence start end from-end mode)))))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence)
@@ -770,9 +829,11 @@ subsequence is found.  Returns NIL otherwise."
   (with-start-end (start1 end1 sequence1)
     (with-start-end (start2 end2 sequence2)
       (cond
-        ((and (stringp sequence1) (stringp sequence2)
-              (not from-end) (not test) (not test-not) (not key))
-         (search-string sequence1 start1 end1 sequence2 start2 end2))
+        ((and (stringp sequence1) (stringp sequence2) (not from-end)
+              (string-search-mode test test-not key))
+         (if (eq (string-search-mode test test-not key) :fold)
+             (search-string-equal sequence1 start1 end1 sequence2 start2 end2)
+             (search-string sequence1 start1 end1 sequence2 start2 end2)))
         ((and (vectorp sequence1) (vectorp sequence2))
          (search-vector sequence1 start1 end1 sequence2 start2 end2
                         test test-not key from-end))
@@ -873,9 +934,12 @@ elements X and Y is arbitrary if both
 evaluates to NIL.  See STABLE-SORT."
   (setf key (if key (coerce-fdesignator key) #'identity)
 	predicate (coerce-fdesignator predicate))
-  (if (listp sequence)
-      (list-merge-sort sequence predicate key)
-      (quick-sort sequence 0 (the fixnum (1- (length sequence))) predicate key)))
+  (cond ((listp sequence)
+         (list-merge-sort sequence predicate key))
+        ((vectorp sequence)
+         (sort-vector-range sequence 0 (length sequence) predicate key nil))
+        (t
+         (quick-sort sequence 0 (the fixnum (1- (length sequence))) predicate key))))
 
 
 (defun list-merge-sort (l predicate key)
@@ -973,92 +1037,207 @@ evaluates to NIL.  See STABLE-SORT."
       seq))
 
 
-(defun stable-sort-merge-vectors (source target start-1
-                                  end-1 end-2 pred key)
-  (let ((i start-1)
-        (j end-1) ; start-2
-        (target-i start-1))
-    (declare (fixnum i j target-i))
-    (loop
-      (cond ((= i end-1)
-        (loop (if (= j end-2) (return))
-                  (setf (aref target target-i)
-                        (aref source j))
-                  (incf target-i)
-                  (incf j))
-            (return))
-            ((= j end-2)
-             (loop (if (= i end-1) (return))
-                  (setf (aref target target-i)
-                        (aref source i))
-                  (incf target-i)
-                  (incf i))
-             (return))
-            ((if key
-                 (funcall pred (funcall key (aref source j))
-                               (funcall key (aref source i)))
-                 (funcall pred (aref source j) (aref source i)))
-             (setf (aref target target-i)
-                   (aref source j))
-             (incf j))
-            (t (setf (aref target target-i)
-                     (aref source i))
-               (incf i)))
-     (incf target-i))))
-
-
-(defun vector-merge-sort (vector pred key)
-  (let* ((vector-len (length (the vector vector)))
-         (n 1)            ; bottom-up size of contiguous runs to be merged
-         (direction t)    ; t vector --> temp    nil temp --> vector
-         (temp (make-array vector-len))
-         (unsorted 0)   ; unsorted..vector-len are the elements that need
-                                    ; to be merged for a given n
-         (start-1 0))   ; one n-len subsequence to be merged with the next
-    (declare (fixnum vector-len n unsorted start-1))
-    (loop
-       ;; for each n we start taking n-runs from the start of the vector
-      (setf unsorted 0)
+;;; Stable merge sort for vectors, after Tim Peters' listsort: split the
+;;; vector into natural runs (reversing strictly descending ones), extend
+;;; short runs by binary insertion, and merge adjacent runs while keeping
+;;; the run lengths on the stack shrinking geometrically. A merge switches
+;;; to galloping (exponential, then binary search) once one side has won
+;;; +MERGE-SORT-MIN-GALLOP+ times in a row, so ordered data costs few
+;;; comparisons.
+
+(defconstant +merge-sort-min-gallop+ 7)
+
+(defmacro sort-less (pred key a b)
+  `(funcall ,pred (funcall ,key ,a) (funcall ,key ,b)))
+
+(defun merge-sort-min-run (n)
+  (declare (fixnum n))
+  (let ((r 0))
+    (declare (fixnum r))
+    (loop while (>= n 64)
+          do (setf r (logior r (logand n 1))
+                   n (ash n -1)))
+    (+ n r)))
+
+(defun natural-run-end (vector start end pred key)
+  "Return the end of the run starting at START, making it ascending."
+  (declare (fixnum start end) (function pred key) (vector vector))
+  (let ((run-end (1+ start)))
+    (declare (fixnum run-end))
+    (when (< run-end end)
+      (cond ((sort-less pred key (aref vector run-end) (aref vector start))
+             ;; Strictly descending, so reversing it keeps the sort stable.
+             (loop do (incf run-end)
+                   while (and (< run-end end)
+                              (sort-less pred key (aref vector run-end)
+                                         (aref vector (1- run-end)))))
+             (loop for i of-type fixnum from start
+                   for j of-type fixnum downfrom (1- run-end)
+                   while (< i j)
+                   do (rotatef (aref vector i) (aref vector j))))
+            (t
+             (loop do (incf run-end)
+                   while (and (< run-end end)
+                              (not (sort-less pred key (aref vector run-end)
+                                              (aref vector (1- run-end)))))))))
+    run-end))
+
+(defun binary-insertion-sort (vector start sorted-end end pred key)
+  "Sort VECTOR from START to END, where START to SORTED-END is already sorted."
+  (declare (fixnum start sorted-end end) (function pred key) (vector vector))
+  (loop for i of-type fixnum from sorted-end below end
+        do (let* ((pivot (aref vector i))
+                  (pivot-key (funcall key pivot))
+                  (lo start)
+                  (hi i))
+             (declare (fixnum lo hi))
+             ;; Insert after any equal elements.
+             (loop while (< lo hi)
+                   do (let ((mid (ash (+ lo hi) -1)))
+                        (if (funcall pred pivot-key (funcall key (aref vector mid)))
+                            (setf hi mid)
+                            (setf lo (1+ mid)))))
+             (loop for j of-type fixnum downfrom i above lo
+                   do (setf (aref vector j) (aref vector (1- j))))
+             (setf (aref vector lo) pivot))))
+
+(defun gallop (item-key vector base length pred key rightp)
+  "Return how many of the sorted elements VECTOR[BASE, BASE+LENGTH) precede an
+element with key ITEM-KEY: those not greater than it if RIGHTP, or those less
+than it otherwise."
+  (declare (fixnum base length) (function pred key) (vector vector))
+  (flet ((precedes (i)
+           (let ((element-key (funcall key (aref vector (+ base i)))))
+             (if rightp
+                 (not (funcall pred item-key element-key))
+                 (funcall pred element-key item-key)))))
+    (let ((lo 0) (probe 1) (hi 0))
+      (declare (fixnum lo probe hi))
+      (loop (cond ((> probe length) (setf hi length) (return))
+                  ((precedes (1- probe)) (setf lo probe probe (1+ (* 2 probe))))
+                  (t (setf hi (1- probe)) (return))))
+      (loop while (< lo hi)
+            do (let ((mid (ash (+ lo hi) -1)))
+                 (if (precedes mid)
+                     (setf lo (1+ mid))
+                     (setf hi mid))))
+      lo)))
+
+(defun merge-vector-runs (vector start middle end pred key temp)
+  "Stably merge the sorted runs VECTOR[START, MIDDLE) and VECTOR[MIDDLE, END).
+TEMP is a simple vector with room for the first run."
+  (declare (fixnum start middle end) (function pred key) (vector vector)
+           (simple-vector temp))
+  ;; Elements already in their final place at either end need no work.
+  (incf start (gallop (funcall key (aref vector middle)) vector start
+                      (- middle start) pred key t))
+  (when (= start middle) (return-from merge-vector-runs vector))
+  (setf end (+ middle (gallop (funcall key (aref vector (1- middle))) vector middle
+                              (- end middle) pred key nil)))
+  (let* ((length-1 (- middle start))
+         (i 0)             ; next in TEMP, the copy of the first run
+         (j middle)        ; next in the second run
+         (k start))        ; next to fill; always <= J
+    (declare (fixnum length-1 i j k))
+    (replace temp vector :start2 start :end2 middle)
+    (block merge
       (loop
-        (setf start-1 unsorted)
-        (let ((end-1 (+ start-1 n)))
-          (declare (fixnum end-1))
-          (cond ((< end-1 vector-len)
-                 ;; there are enough elements for a second run
-                 (let ((end-2 (+ end-1 n)))
-                   (declare (fixnum end-2))
-                   (if (> end-2 vector-len) (setf end-2 vector-len))
-                   (setf unsorted end-2)
-                   (if direction
-                       (stable-sort-merge-vectors
-                          vector temp start-1 end-1 end-2 pred key)
-                       (stable-sort-merge-vectors
-                          temp vector start-1 end-1 end-2 pred key))
-                   (if (= unsorted vector-len) (return))))
-                ;; if there is only one run copy those elements to the end
-                (t (if direction
-                       (do ((i start-1 (1+ i)))
-                           ((= i vector-len))
-                         (declare (fixnum i))
-                         (setf (aref temp i) (aref vector i)))
-                       (do ((i start-1 (1+ i)))
-                           ((= i vector-len))
-                         (declare (fixnum i))
-                         (setf (aref vector i) (aref temp i))))
-                   (return)))))
-      ;; If the inner loop only executed once then there were only enough
-      ;; elements for two subsequences given n so all the elements have
-      ;; been merged into one list. Start-1 will have remained 0 upon exit.
-      (when (zerop start-1)
-        (when direction
-          ;; if we just merged into the temporary copy it all back
-          ;; to the given vector.
-          (dotimes (i vector-len)
-            (setf (aref vector i) (aref temp i))))
-        (return vector))
-      (setf n (ash n 1))           ; (* 2 n)
-      (setf direction (not direction)))))
-
+        ;; One element at a time until one side keeps winning.
+        (let ((left-wins 0) (right-wins 0))
+          (declare (fixnum left-wins right-wins))
+          (loop
+            (when (or (= i length-1) (= j end)) (return-from merge))
+            (when (or (>= left-wins +merge-sort-min-gallop+)
+                      (>= right-wins +merge-sort-min-gallop+))
+              (return))
+            (cond ((sort-less pred key (aref vector j) (svref temp i))
+                   (setf (aref vector k) (aref vector j))
+                   (incf j) (incf right-wins) (setf left-wins 0))
+                  (t
+                   (setf (aref vector k) (svref temp i))
+                   (incf i) (incf left-wins) (setf right-wins 0)))
+            (incf k)))
+        ;; Gallop while it keeps paying off.
+        (loop
+          (let ((left-count (gallop (funcall key (aref vector j)) temp i
+                                    (- length-1 i) pred key t)))
+            (declare (fixnum left-count))
+            (replace vector temp :start1 k :start2 i :end2 (+ i left-count))
+            (incf i left-count) (incf k left-count)
+            (when (= i length-1) (return-from merge))
+            (setf (aref vector k) (aref vector j))
+            (incf j) (incf k)
+            (when (= j end) (return-from merge))
+            (let ((right-count (gallop (funcall key (svref temp i)) vector j
+                                       (- end j) pred key nil)))
+              (declare (fixnum right-count))
+              (loop repeat right-count
+                    do (setf (aref vector k) (aref vector j))
+                       (incf j) (incf k))
+              (when (= j end) (return-from merge))
+              (setf (aref vector k) (svref temp i))
+              (incf i) (incf k)
+              (when (= i length-1) (return-from merge))
+              (when (and (< left-count +merge-sort-min-gallop+)
+                         (< right-count +merge-sort-min-gallop+))
+                (return)))))))
+    ;; Whatever is left of the first run goes at the end; what is left of
+    ;; the second run is already in place.
+    (replace vector temp :start1 k :start2 i :end2 length-1))
+  vector)
+
+(defun vector-merge-sort (vector pred key &optional (start 0) (end (length vector)))
+  (declare (fixnum start end) (function pred key) (vector vector))
+  (let ((n (- end start)))
+    (declare (fixnum n))
+    (when (< n 2) (return-from vector-merge-sort vector))
+    (let ((min-run (merge-sort-min-run n))
+          (temp nil)
+          ;; Stack of (start . length) of the pending runs, top first.
+          (runs nil))
+      (flet ((merge-at (stack)
+               ;; Merge the two runs at the head of STACK into one.
+               (destructuring-bind ((start-2 . length-2) (start-1 . length-1) . rest)
+                   stack
+                 (unless temp (setf temp (make-array n)))
+                 (merge-vector-runs vector start-1 start-2 (+ start-2 length-2)
+                                    pred key temp)
+                 (list* (cons start-1 (+ length-1 length-2)) rest))))
+        (loop with lo of-type fixnum = start
+              while (< lo end)
+              do (let ((run-end (natural-run-end vector lo end pred key)))
+                   (declare (fixnum run-end))
+                   (when (< (- run-end lo) min-run)
+                     (let ((forced-end (min end (+ lo min-run))))
+                       (binary-insertion-sort vector lo run-end forced-end pred key)
+                       (setf run-end forced-end)))
+                   (push (cons lo (- run-end lo)) runs)
+                   (setf lo run-end))
+                 ;; Keep run lengths decreasing fast enough that the stack
+                 ;; stays logarithmic and merges stay balanced.
+                 (loop
+                   (let ((c (cdr (first runs)))
+                         (b (cdr (second runs)))
+                         (a (cdr (third runs)))
+                         (d (cdr (fourth runs))))
+                     (cond ((null b) (return))
+                           ((or (and a (<= a (+ b c)))
+                                (and d (<= d (+ a b))))
+                            (if (< a c)
+                                (setf (cdr runs) (merge-at (cdr runs)))
+                                (setf runs (merge-at runs))))
+                           ((<= b c) (setf runs (merge-at runs)))
+                           (t (return))))))
+        (loop while (rest runs)
+              do (setf runs (merge-at runs)))))
+    vector))
+
+(defun sort-vector-range (vector start end pred key stable)
+  "Sort VECTOR from START to END, natively if the predicate allows it."
+  (or (and (eq key #'identity)
+           (core:native-sort vector start end pred stable)
+           vector)
+      (vector-merge-sort vector pred key start end)))
 
 (defun stable-sort (sequence predicate &rest args &key key)
   "Args: (sequence test &key key)
@@ -1073,12 +1252,8 @@ SEQUENCE.  See SORT."
         predicate (coerce-fdesignator predicate))
   (cond ((listp sequence)
          (list-merge-sort sequence predicate key))
-        ;; TODO: We can actually do this for any non-general vector,
-        ;; as the elements essentially lack discernable identities.
-        ((or (stringp sequence) (bit-vector-p sequence))
-         (sort sequence predicate :key key))
         ((vectorp sequence)
-         (vector-merge-sort sequence predicate key))
+         (sort-vector-range sequence 0 (length sequence) predicate key t))
         (t (apply #'sequence:stable-sort sequence predicate args))))
 
 (defun merge (result-type sequence1 sequence2 predicate &key key
@@ -439,7 +439,9 @@ Use special code 0 to cancel this operation.")
 		 for p in (mp:all-processes)
 		 unless (or (eq p this)
 			    (member (mp:process-name p)
-                                    '(si:signal-servicing si::handle-signal)))
+                                    '(si:signal-servicing si::handle-signal
+                                      clos::discriminator-compiler
+                                      mp::scheduler-worker)))
 		 collect p)))
      (when (and (= (length all-processes) 1) *interrupt-lonely-threads-p*)
        (mp:interrupt-process (first all-processes)
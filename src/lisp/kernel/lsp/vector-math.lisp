@@ -0,0 +1,86 @@
+;;;; vector-math.lisp -- arithmetic on specialized numeric arrays.
+
+(in-package "EXT")
+
+(export '(vector-add vector-multiply vector-fma vector-scale vector-axpy
+          vector-dot vector-sum vector-min vector-max
+          *vector-math-parallel-threshold*))
+
+;;; These functions run over the elements from START to END of arrays of
+;;; DOUBLE-FLOAT, SINGLE-FLOAT or FIXNUM, all operands having the same
+;;; element type. Arrays of higher rank are taken in row-major order, and
+;;; END defaults to the length of the first array. The loops are in C++
+;;; (numericVector.cc) and work on the raw storage without boxing, using the
+;;; widest vector instructions the processor has.
+;;;
+;;; With :PARALLEL true, a range of at least *VECTOR-MATH-PARALLEL-THRESHOLD*
+;;; elements is split into chunks that run as MP futures.
+
+(defvar *vector-math-parallel-threshold* 262144
+  "Vector math functions given :PARALLEL T run ranges shorter than this
+on the calling thread.")
+
+(defun vector-math-end (array end)
+  (or end (if (vectorp array) (length array) (array-total-size array))))
+
+(defun map-vector-math-chunks (function start end parallel)
+  "Call FUNCTION on subranges covering [START, END) and return the list of
+its values, in order."
+  (if (and parallel (>= (- end start) *vector-math-parallel-threshold*))
+      (mapcar #'mp:force
+              (loop for (chunk-start . chunk-end) in (mp::chunk-bounds (- end start))
+                    collect (let ((s (+ start chunk-start)) (e (+ start chunk-end)))
+                              (mp:future (funcall function s e)))))
+      (list (funcall function start end))))
+
+(defun vector-add (result x y &key (start 0) end parallel)
+  "Store X[i] + Y[i] into RESULT[i] for i from START below END, and return RESULT."
+  (map-vector-math-chunks (lambda (s e) (core:vector-add-range result x y s e))
+                          start (vector-math-end x end) parallel)
+  result)
+
+(defun vector-multiply (result x y &key (start 0) end parallel)
+  "Store X[i] * Y[i] into RESULT[i] for i from START below END, and return RESULT."
+  (map-vector-math-chunks (lambda (s e) (core:vector-multiply-range result x y s e))
+                          start (vector-math-end x end) parallel)
+  result)
+
+(defun vector-fma (result x y z &key (start 0) end parallel)
+  "Store X[i] * Y[i] + Z[i] into RESULT[i] for i from START below END, and
+return RESULT. Floats are rounded only once."
+  (map-vector-math-chunks (lambda (s e) (core:vector-fma-range result x y z s e))
+                          start (vector-math-end x end) parallel)
+  result)
+
+(defun vector-scale (result alpha x &key (start 0) end parallel)
+  "Store ALPHA * X[i] into RESULT[i] for i from START below END, and return RESULT."
+  (map-vector-math-chunks (lambda (s e) (core:vector-scale-range result alpha x s e))
+                          start (vector-math-end x end) parallel)
+  result)
+
+(defun vector-axpy (alpha x y &key (start 0) end parallel)
+  "Replace Y[i] with ALPHA * X[i] + Y[i] for i from START below END, and return Y."
+  (map-vector-math-chunks (lambda (s e) (core:vector-axpy-range alpha x y s e))
+                          start (vector-math-end x end) parallel)
+  y)
+
+(defun vector-sum (x &key (start 0) end parallel)
+  "Return the sum of X[i] for i from START below END. Float sums are
+accumulated in blocks, so they may round differently than a serial loop."
+  (reduce #'+ (map-vector-math-chunks (lambda (s e) (core:vector-sum-range x s e))
+                                      start (vector-math-end x end) parallel)))
+
+(defun vector-dot (x y &key (start 0) end parallel)
+  "Return the sum of X[i] * Y[i] for i from START below END."
+  (reduce #'+ (map-vector-math-chunks (lambda (s e) (core:vector-dot-range x y s e))
+                                      start (vector-math-end x end) parallel)))
+
+(defun vector-min (x &key (start 0) end parallel)
+  "Return the least X[i] for i from START below END, or NIL if the range is empty."
+  (reduce #'min (map-vector-math-chunks (lambda (s e) (core:vector-min-range x s e))
+                                        start (vector-math-end x end) parallel)))
+
+(defun vector-max (x &key (start 0) end parallel)
+  "Return the greatest X[i] for i from START below END, or NIL if the range is empty."
+  (reduce #'max (map-vector-math-chunks (lambda (s e) (core:vector-max-range x s e))
+                                        start (vector-math-end x end) parallel)))
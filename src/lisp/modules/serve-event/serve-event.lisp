@@ -32,6 +32,15 @@
 ;;
 ;;    http://haltcondition.net/?p=2232
 ;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;
+;; Where epoll(7) is available (Linux), handlers are kept registered in
+;; an EXT:EVENT-LOOP and SERVE-EVENT waits on it, so a wakeup costs
+;; O(ready descriptors) and descriptors above FD_SETSIZE work.
+;; Elsewhere SERVE-EVENT builds fd_sets for select(2) on every call.
+;; EXT:EVENT-LOOP can also be used on its own, and adds timers and
+;; wakeups from other threads.
+;;
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 
 (defpackage "SERVE-EVENT"
@@ -40,17 +49,27 @@
            "SERVE-EVENT" "SERVE-ALL-EVENTS"))
 (in-package "SERVE-EVENT")
 
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (export '(ext::event-loop ext::event-loop-p ext::make-event-loop
+            ext::event-loop-add-fd ext::event-loop-remove-fd
+            ext::event-loop-add-timer ext::event-loop-remove-timer
+            ext::event-loop-wakeup ext::event-loop-run-once
+            ext::event-loop-run ext::event-loop-stop ext::close-event-loop)
+          "EXT"))
+
 
 (defstruct (handler
-             (:constructor make-handler (descriptor direction function))
+             (:constructor make-handler (descriptor direction function
+                                         &optional edge-triggered))
              (:copier nil))
   ;; Reading or writing...
   (direction nil :type (member :input :output))
   ;; File descriptor this handler is tied to.
-  ;; FIXME: Should be based on FD_SETSIZE
   (descriptor 0)
   ;; Function to call.
-  (function nil :type function))
+  (function nil :type function)
+  ;; Only call when the descriptor becomes ready (epoll only).
+  (edge-triggered nil))
 
 
 (defvar *descriptor-handlers* nil
@@ -70,21 +89,243 @@
     #+clos-streams
     (stream (gray::stream-file-descriptor stream-or-fd direction))))
 
+(defun check-direction (direction)
+  (unless (member direction '(:input :output))
+    (error 'simple-type-error
+           :format-control "Invalid direction ~S, must be either :INPUT or :OUTPUT."
+           :format-arguments (list direction)
+           :datum direction
+           :expected-type '(member :input :output))))
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; Event loops
+;;
+;; An event loop owns an epoll descriptor. Every descriptor with handlers
+;; is registered once, for the union of its handlers' directions. Timers
+;; are timerfds and EVENT-LOOP-WAKEUP writes to an eventfd, so they are
+;; served like any other descriptor.
+
+(defstruct (ext:event-loop
+            (:constructor %make-event-loop (epoll-fd wakeup-fd))
+            (:predicate ext:event-loop-p)
+            (:copier nil))
+  epoll-fd
+  wakeup-fd
+  ;; Descriptor -> list of the handlers on it.
+  (descriptors (make-hash-table))
+  ;; Timers that have not fired or been removed yet.
+  (timers nil)
+  (lock (mp:make-lock :name 'event-loop))
+  (running nil))
+
+(defstruct (timer
+             (:constructor make-timer (descriptor function))
+             (:copier nil))
+  descriptor
+  function
+  ;; The loop's handler for the timerfd, or NIL once the timer is removed.
+  (handler nil))
+
+(defun check-fd-result (result errno what)
+  (when (minusp result)
+    (error "~A failed, errno ~A" what errno))
+  result)
+
+(defun update-registration (event-loop fd old-handlers new-handlers)
+  (let ((epoll-fd (event-loop-epoll-fd event-loop)))
+    (if (null new-handlers)
+        ;; Fails harmlessly if FD was already closed, since closing a
+        ;; descriptor removes it from the epoll set.
+        (ll-epoll-ctl epoll-fd +epoll-ctl-del+ fd nil nil nil)
+        (multiple-value-call #'check-fd-result
+          (ll-epoll-ctl epoll-fd
+                        (if old-handlers +epoll-ctl-mod+ +epoll-ctl-add+)
+                        fd
+                        (find :input new-handlers :key #'handler-direction)
+                        (find :output new-handlers :key #'handler-direction)
+                        (some #'handler-edge-triggered new-handlers))
+          "epoll_ctl"))))
+
+(defun add-handler (event-loop handler)
+  (mp:with-lock ((event-loop-lock event-loop))
+    (let* ((fd (handler-descriptor handler))
+           (old (gethash fd (event-loop-descriptors event-loop)))
+           (new (cons handler old)))
+      (update-registration event-loop fd old new)
+      (setf (gethash fd (event-loop-descriptors event-loop)) new)))
+  handler)
+
+(defun remove-handler (event-loop handler)
+  (mp:with-lock ((event-loop-lock event-loop))
+    (let* ((fd (handler-descriptor handler))
+           (old (gethash fd (event-loop-descriptors event-loop)))
+           (new (remove handler old)))
+      (when (member handler old)
+        (update-registration event-loop fd old new)
+        (if new
+            (setf (gethash fd (event-loop-descriptors event-loop)) new)
+            (remhash fd (event-loop-descriptors event-loop))))))
+  nil)
+
+(defun ext:make-event-loop ()
+  "Return a new event loop. Event loops use epoll, so they are only
+available on Linux."
+  (unless (ll-epoll-supported-p)
+    (error "Event loops need epoll, which is not available on this platform."))
+  (let* ((epoll-fd (multiple-value-call #'check-fd-result
+                     (ll-epoll-create) "epoll_create"))
+         (wakeup-fd (multiple-value-call #'check-fd-result
+                      (ll-eventfd-create) "eventfd"))
+         (event-loop (%make-event-loop epoll-fd wakeup-fd)))
+    (add-handler event-loop
+                 (make-handler wakeup-fd :input
+                               (lambda (fd) (ll-fd-read-counter fd))))
+    event-loop))
+
+(defun ext:event-loop-add-fd (event-loop stream-or-fd direction function
+                              &key edge-triggered)
+  "Arrange for EVENT-LOOP to call FUNCTION with the descriptor whenever the
+fd designated by STREAM-OR-FD is usable. DIRECTION should be either :INPUT or
+:OUTPUT. If EDGE-TRIGGERED is true, FUNCTION is only called when the fd
+becomes usable, so it must read or write until the fd would block; this
+applies to every handler on the same fd. The value returned should be passed
+to EXT:EVENT-LOOP-REMOVE-FD when it is no longer needed."
+  (check-direction direction)
+  (add-handler event-loop
+               (make-handler (coerce-to-descriptor stream-or-fd direction)
+                             direction function edge-triggered)))
+
+(defun ext:event-loop-remove-fd (event-loop handler)
+  "Stop EVENT-LOOP calling HANDLER, as returned by EXT:EVENT-LOOP-ADD-FD."
+  (remove-handler event-loop handler))
+
+(defun ext:event-loop-add-timer (event-loop seconds function &key repeat)
+  "Arrange for EVENT-LOOP to call FUNCTION with no arguments after SECONDS,
+and then every REPEAT seconds if REPEAT is given. The value returned may be
+passed to EXT:EVENT-LOOP-REMOVE-TIMER."
+  (let* ((fd (multiple-value-call #'check-fd-result
+               (ll-timerfd-create) "timerfd_create"))
+         (timer (make-timer fd function)))
+    (multiple-value-call #'check-fd-result
+      (ll-timerfd-settime fd (float seconds 1d0) (float (or repeat 0) 1d0))
+      "timerfd_settime")
+    (setf (timer-handler timer)
+          (add-handler event-loop
+                       (make-handler fd :input
+                                     (lambda (fd)
+                                       (when (plusp (ll-fd-read-counter fd))
+                                         (unless repeat
+                                           (ext:event-loop-remove-timer event-loop timer))
+                                         (funcall function))))))
+    (mp:with-lock ((event-loop-lock event-loop))
+      (push timer (event-loop-timers event-loop)))
+    timer))
+
+(defun ext:event-loop-remove-timer (event-loop timer)
+  "Cancel TIMER, as returned by EXT:EVENT-LOOP-ADD-TIMER. Removing a timer
+that has already fired or been removed does nothing."
+  (let ((handler (timer-handler timer)))
+    (when (and handler
+               (eq (mp:cas (timer-handler timer) handler nil) handler))
+      (remove-handler event-loop handler)
+      (mp:with-lock ((event-loop-lock event-loop))
+        (setf (event-loop-timers event-loop)
+              (delete timer (event-loop-timers event-loop))))
+      (ll-close-fd (timer-descriptor timer))))
+  nil)
+
+(defun ext:event-loop-wakeup (event-loop)
+  "Make a thread waiting in EXT:EVENT-LOOP-RUN-ONCE on EVENT-LOOP return.
+May be called from any thread."
+  (ll-eventfd-signal (event-loop-wakeup-fd event-loop))
+  nil)
+
+(defun handler-ready-p (handler flags)
+  (logtest flags (logior +epollerr+
+                         (ecase (handler-direction handler)
+                           (:input +epollin+)
+                           (:output +epollout+)))))
+
+(defun ext:event-loop-run-once (event-loop &optional timeout)
+  "Wait up to TIMEOUT seconds, or until something happens if TIMEOUT is NIL,
+for fds in EVENT-LOOP to become usable, and call their handlers. Return T if
+something happened and NIL otherwise."
+  (multiple-value-bind (count errno events)
+      (ll-epoll-wait (event-loop-epoll-fd event-loop) 256
+                     (if timeout (float timeout 1d0) -1d0))
+    (cond ((zerop count) nil)
+          ((minusp count)
+           (if (= errno +eintr+)
+               ;; suppress EINTR
+               nil
+               (error "Error during epoll_wait retval:~A errno:~A" count errno)))
+          (t
+           (dotimes (i count t)
+             (let ((fd (svref events (* 2 i)))
+                   (flags (svref events (1+ (* 2 i)))))
+               ;; Look the handlers up afresh: an earlier handler may have
+               ;; removed some.
+               (dolist (handler (mp:with-lock ((event-loop-lock event-loop))
+                                  (gethash fd (event-loop-descriptors event-loop))))
+                 (when (handler-ready-p handler flags)
+                   (funcall (handler-function handler) fd)))))))))
+
+(defun ext:event-loop-run (event-loop)
+  "Serve events on EVENT-LOOP until EXT:EVENT-LOOP-STOP is called."
+  (setf (event-loop-running event-loop) t)
+  (loop while (event-loop-running event-loop)
+        do (ext:event-loop-run-once event-loop)))
+
+(defun ext:event-loop-stop (event-loop)
+  "Make EXT:EVENT-LOOP-RUN on EVENT-LOOP return. May be called from any
+thread."
+  (setf (event-loop-running event-loop) nil)
+  (ext:event-loop-wakeup event-loop))
+
+(defun ext:close-event-loop (event-loop)
+  "Release the descriptors EVENT-LOOP uses, including those of its timers.
+Descriptors added with EXT:EVENT-LOOP-ADD-FD are not closed."
+  (dolist (timer (mp:with-lock ((event-loop-lock event-loop))
+                   (copy-list (event-loop-timers event-loop))))
+    (ext:event-loop-remove-timer event-loop timer))
+  (ll-close-fd (event-loop-wakeup-fd event-loop))
+  (ll-close-fd (event-loop-epoll-fd event-loop))
+  nil)
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; Handlers for SERVE-EVENT
+
+(defvar *event-loop* nil
+  "The event loop SERVE-EVENT waits on, where epoll is available.")
+
+(defvar *event-loop-lock* (mp:make-lock :name 'serve-event))
+
+(defun default-event-loop ()
+  (or *event-loop*
+      (mp:with-lock (*event-loop-lock*)
+        (or *event-loop*
+            (setf *event-loop* (ext:make-event-loop))))))
+
+;;; The epoll descriptor means nothing in a process started from a
+;;; snapshot, so forget the loop when saving and make a fresh one on demand.
+(defun forget-event-loop-on-save ()
+  (setf *event-loop* nil))
+
+(eval-when (:load-toplevel :execute)
+  (cmp:register-save-hook 'forget-event-loop-on-save))
+
 ;;; Add a new handler to *descriptor-handlers*.
 (defun add-fd-handler (stream-or-fd direction function)
   "Arrange to call FUNCTION whenever the fd designated by STREAM-OR-FD
   is usable. DIRECTION should be either :INPUT or :OUTPUT. The value
   returned should be passed to SYSTEM:REMOVE-FD-HANDLER when it is no
   longer needed."
-  (unless (member direction '(:input :output))
-    (error 'simple-type-error
-           :format-control "Invalid direction ~S, must be either :INPUT or :OUTPUT."
-           :format-arguments (list direction)
-           :datum direction
-           :expected-type '(member :input :output)))
+  (check-direction direction)
   (let ((handler (make-handler (coerce-to-descriptor stream-or-fd direction)
                                direction
                                function)))
+    (when (ll-epoll-supported-p)
+      (add-handler (default-event-loop) handler))
     (push handler *descriptor-handlers*)
     handler))
 
@@ -92,6 +333,8 @@
 (defun remove-fd-handler (handler)
   ;;  #!+sb-doc
   "Removes HANDLER from the list of active handlers."
+  (when (ll-epoll-supported-p)
+    (remove-handler (default-event-loop) handler))
   (setf *descriptor-handlers*
         (delete handler *descriptor-handlers*)))
 
@@ -129,7 +372,11 @@
    time (in seconds) and then return, otherwise it will wait until something
    happens. Server returns T if something happened and NIL otherwise. Timeout
    0 means polling without waiting."
+  (if (ll-epoll-supported-p)
+      (ext:event-loop-run-once (default-event-loop) seconds)
+      (select-event seconds)))
 
+(defun select-event (seconds)
   ;; fd_set is an opaque typedef, so we can't declare it locally.
   ;; However we can fine out its size and allocate a char array of
   ;; the same size which can be used in its place.
@@ -579,6 +579,284 @@ also known as unix-domain sockets."))
 (defmethod ext::stream-fd ((socket socket))
   (socket-file-descriptor socket))
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;
+;;; BUFFERED SOCKET STREAMS
+;;;
+;;; A binary stream over a socket with its own buffers, for servers that
+;;; would otherwise make a system call per write. Output is gathered:
+;;; small writes are copied into the output buffer, while large octet
+;;; vectors are queued as they are and go out together with the buffer in
+;;; one writev(2), so they must not be modified until the stream is next
+;;; flushed. SOCKET-SEND-FILE sends files with sendfile(2).
+;;;
+;;; The socket may be in non-blocking mode. When a read or write would
+;;; block, the stream calls *SOCKET-WAIT-FUNCTION*, which by default
+;;; polls the descriptor. An event loop can bind it to serve other
+;;; events in the meantime.
+;;;
+
+(export '(buffered-socket-stream socket-make-buffered-stream
+          socket-send-file socket-receive-batch socket-send-batch
+          *socket-wait-function*))
+
+(defvar *socket-wait-function*
+  (lambda (fd direction)
+    (ll-socket-wait fd (eq direction :output) -1d0))
+  "Function called with a descriptor and :INPUT or :OUTPUT when a buffered
+socket stream would block. It should return when the descriptor may be
+ready.")
+
+;;; Octet vectors at least this long are written without being copied.
+(defconstant +gather-threshold+ 4096)
+
+(defun errno-error (errno where)
+  (error (condition-for-errno errno) :errno errno :syscall where))
+
+(defclass buffered-socket-stream (gray:fundamental-binary-input-stream
+                                  gray:fundamental-binary-output-stream)
+  ((socket :initarg :socket :reader buffered-socket-stream-socket)
+   (fd :initarg :fd)
+   (input-buffer :initarg :input-buffer)
+   (input-start :initform 0)
+   (input-end :initform 0)
+   (output-buffer :initarg :output-buffer)
+   (output-end :initform 0)
+   ;; The output buffer's contents up to here are already in PENDING.
+   (output-queued :initform 0)
+   ;; Output queued since the last flush, oldest first, as
+   ;; (vector start . end). The output buffer's contents are among them.
+   (pending :initform nil)))
+
+(defun socket-make-buffered-stream (socket &key (buffer-size 65536))
+  "Return a BUFFERED-SOCKET-STREAM reading and writing octets on SOCKET.
+Closing the stream closes SOCKET."
+  (flet ((make-buffer ()
+           (sys:make-static-vector (upgraded-array-element-type '(unsigned-byte 8))
+                                   buffer-size)))
+    (make-instance 'buffered-socket-stream
+                   :socket socket
+                   :fd (socket-file-descriptor socket)
+                   :input-buffer (make-buffer)
+                   :output-buffer (make-buffer))))
+
+(defun wait-for-socket (fd direction)
+  (funcall *socket-wait-function* fd direction))
+
+(defun fill-input-buffer (stream)
+  "Read into STREAM's empty input buffer. Return NIL at end of file."
+  (with-slots (fd input-buffer input-start input-end) stream
+    (loop
+      (multiple-value-bind (count errno)
+          (ll-socket-read fd input-buffer 0 (length input-buffer))
+        (cond ((plusp count)
+               (setf input-start 0 input-end count)
+               (return t))
+              ((zerop count) (return nil))
+              ((= errno +eagain+) (wait-for-socket fd :input))
+              ((/= errno +eintr+) (errno-error errno "read")))))))
+
+(defmethod gray:stream-element-type ((stream buffered-socket-stream))
+  '(unsigned-byte 8))
+
+(defmethod gray::stream-file-descriptor ((stream buffered-socket-stream) &optional direction)
+  (declare (ignore direction))
+  (slot-value stream 'fd))
+
+(defmethod gray:stream-read-byte ((stream buffered-socket-stream))
+  (with-slots (input-buffer input-start input-end) stream
+    (if (or (< input-start input-end) (fill-input-buffer stream))
+        (prog1 (aref input-buffer input-start)
+          (incf input-start))
+        :eof)))
+
+(defmethod gray:stream-listen ((stream buffered-socket-stream))
+  (with-slots (fd input-start input-end) stream
+    (or (< input-start input-end)
+        (and (plusp (ll-socket-wait fd nil 0d0))
+             (fill-input-buffer stream)))))
+
+(defmethod gray:stream-read-sequence ((stream buffered-socket-stream) sequence
+                                      &optional (start 0) end)
+  (with-slots (fd input-buffer input-start input-end) stream
+    (let ((end (or end (length sequence))))
+      ;; Drain the buffer first.
+      (let ((count (min (- end start) (- input-end input-start))))
+        (replace sequence input-buffer :start1 start :end1 (+ start count)
+                                       :start2 input-start)
+        (incf input-start count)
+        (incf start count))
+      (loop while (< start end)
+            do (if (and (typep sequence '(simple-array (unsigned-byte 8) (*)))
+                        (>= (- end start) (length input-buffer)))
+                   ;; A large read goes straight into SEQUENCE.
+                   (multiple-value-bind (count errno)
+                       (ll-socket-read fd sequence start end)
+                     (cond ((plusp count) (incf start count))
+                           ((zerop count) (return))
+                           ((= errno +eagain+) (wait-for-socket fd :input))
+                           ((/= errno +eintr+) (errno-error errno "read"))))
+                   (if (fill-input-buffer stream)
+                       (let ((count (min (- end start) (- input-end input-start))))
+                         (replace sequence input-buffer :start1 start :end1 (+ start count)
+                                                        :start2 input-start)
+                         (incf input-start count)
+                         (incf start count))
+                       (return))))
+      start)))
+
+(defun queue-output-buffer (stream)
+  "Queue the unqueued part of STREAM's output buffer."
+  (with-slots (output-buffer output-end output-queued pending) stream
+    (let ((last (first pending)))
+      (if (and last (eq (car last) output-buffer))
+          (setf (cddr last) output-end)
+          (when (> output-end output-queued)
+            (push (list* output-buffer output-queued output-end) pending))))
+    (setf output-queued output-end)))
+
+(defun flush-output (stream)
+  "Write everything queued on STREAM, with as few writev calls as possible."
+  (queue-output-buffer stream)
+  (with-slots (fd output-end output-queued pending) stream
+    (let ((queue (reverse pending)))
+      (loop while queue
+            do (multiple-value-bind (count errno)
+                   (ll-socket-writev fd (mapcar #'car queue)
+                                     (mapcar #'cadr queue) (mapcar #'cddr queue))
+                 (cond ((>= count 0)
+                        ;; Drop what was written.
+                        (loop while (and queue
+                                         (>= count (- (cddr (first queue))
+                                                      (cadr (first queue)))))
+                              do (decf count (- (cddr (first queue)) (cadr (first queue))))
+                                 (pop queue))
+                        (when queue
+                          (incf (cadr (first queue)) count)))
+                       ((= errno +eagain+) (wait-for-socket fd :output))
+                       ((/= errno +eintr+) (errno-error errno "writev")))))
+      (setf pending nil output-end 0 output-queued 0))))
+
+(defun output-room (stream)
+  (with-slots (output-buffer output-end) stream
+    (when (= output-end (length output-buffer))
+      (flush-output stream))
+    (- (length output-buffer) output-end)))
+
+(defmethod gray:stream-write-byte ((stream buffered-socket-stream) integer)
+  (output-room stream)
+  (with-slots (output-buffer output-end) stream
+    (setf (aref output-buffer output-end) integer)
+    (incf output-end))
+  integer)
+
+(defmethod gray:stream-write-sequence ((stream buffered-socket-stream) sequence
+                                       &optional (start 0) end)
+  (let ((end (or end (length sequence))))
+    (with-slots (output-buffer output-end pending) stream
+      (if (and (typep sequence '(simple-array (unsigned-byte 8) (*)))
+               (>= (- end start) +gather-threshold+))
+          ;; Queue it uncopied. Whatever follows goes into the buffer
+          ;; after it, so record the buffer's contents first.
+          (progn
+            (queue-output-buffer stream)
+            (push (list* sequence start end) pending)
+            (when (> (length pending) 64)
+              (flush-output stream)))
+          (loop while (< start end)
+                do (let ((count (min (output-room stream) (- end start))))
+                     (replace output-buffer sequence :start1 output-end
+                                                     :start2 start :end2 (+ start count))
+                     (incf output-end count)
+                     (incf start count))))))
+  sequence)
+
+(defmethod gray:stream-force-output ((stream buffered-socket-stream))
+  (flush-output stream)
+  nil)
+
+(defmethod gray:stream-finish-output ((stream buffered-socket-stream))
+  (flush-output stream)
+  nil)
+
+(defmethod gray:stream-clear-input ((stream buffered-socket-stream))
+  (with-slots (input-start input-end) stream
+    (setf input-start 0 input-end 0))
+  nil)
+
+(defmethod gray:close ((stream buffered-socket-stream) &key abort)
+  (when (gray:open-stream-p stream)
+    (unwind-protect
+         (unless abort (flush-output stream))
+      (setf (gray:open-stream-p stream) nil)
+      (socket-close (buffered-socket-stream-socket stream))))
+  t)
+
+(defun socket-send-file (socket-or-stream file &key (start 0) end)
+  "Send the octets of FILE from START to END over SOCKET-OR-STREAM with
+sendfile(2), so they never pass through Lisp. FILE may be a pathname, a file
+stream or a file descriptor. A BUFFERED-SOCKET-STREAM is flushed first.
+Return the number of octets sent."
+  (etypecase file
+    ((or pathname string)
+     (with-open-file (stream file :element-type '(unsigned-byte 8))
+       (socket-send-file socket-or-stream (ext:file-stream-file-descriptor stream)
+                         :start start :end (or end (file-length stream)))))
+    (file-stream
+     (socket-send-file socket-or-stream (ext:file-stream-file-descriptor file)
+                       :start start :end (or end (file-length file))))
+    (integer
+     (let ((fd (etypecase socket-or-stream
+                 (socket (socket-file-descriptor socket-or-stream))
+                 (buffered-socket-stream
+                  (flush-output socket-or-stream)
+                  (slot-value socket-or-stream 'fd))))
+           (offset start))
+       (unless end
+         (error "SOCKET-SEND-FILE needs END when FILE is a descriptor."))
+       (loop while (< offset end)
+             do (multiple-value-bind (count errno)
+                    (ll-socket-sendfile fd file offset (- end offset))
+                  (cond ((plusp count) (incf offset count))
+                        ((zerop count) (return))
+                        ((= errno +eagain+) (wait-for-socket fd :output))
+                        ((/= errno +eintr+) (errno-error errno "sendfile")))))
+       (- offset start)))))
+
+(defun socket-receive-batch (socket buffers &key dontwait)
+  "Receive up to one datagram into each octet vector in BUFFERS, with as few
+system calls as possible (recvmmsg(2) where available). Waits for the first
+datagram unless DONTWAIT is true. Return the number received, and vectors of
+the length, remote host and remote port of each."
+  (multiple-value-bind (count errno lengths hosts ports)
+      (ll-socket-receive-batch (socket-file-descriptor socket)
+                               (coerce buffers 'simple-vector) dontwait)
+    (cond ((>= count 0) (values count lengths hosts ports))
+          ((member errno (list +eagain+ +eintr+)) (values 0 #() #() #()))
+          (t (errno-error errno "recvmmsg")))))
+
+(defun socket-send-batch (socket buffers &key lengths address dontwait nosignal)
+  "Send each octet vector in BUFFERS as a datagram, with as few system calls
+as possible (sendmmsg(2) where available). LENGTHS, if given, holds the
+number of octets to send from each buffer. ADDRESS is as for SOCKET-SEND;
+without it the socket must be connected. Return the number of datagrams
+sent."
+  (let ((buffers (coerce buffers 'simple-vector)))
+    (multiple-value-bind (count errno)
+        (ll-socket-send-batch (socket-file-descriptor socket) buffers
+                              (if lengths
+                                  (coerce lengths 'simple-vector)
+                                  (map 'simple-vector #'length buffers))
+                              (if address (second address) -1)
+                              (if address (aref (first address) 0) 0)
+                              (if address (aref (first address) 1) 0)
+                              (if address (aref (first address) 2) 0)
+                              (if address (aref (first address) 3) 0)
+                              dontwait nosignal)
+      (cond ((>= count 0) count)
+            ((member errno (list +eagain+ +eintr+)) 0)
+            (t (errno-error errno "sendmmsg"))))))
+
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;
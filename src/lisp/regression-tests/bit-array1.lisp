@@ -124,3 +124,29 @@
             (V2 (MAKE-ARRAY 1 :ELEMENT-TYPE 'BIT :INITIAL-CONTENTS '(1) :FILL-POINTER 0)))
         (BIT-AND v1 v2))
       (#*1))
+
+(test bit-and-unaligned-displaced
+      (let* ((n 300)
+             (basis (make-array (+ n 20) :element-type 'bit))
+             (a1 (make-array n :element-type 'bit :displaced-to basis :displaced-index-offset 3))
+             (a2 (make-array n :element-type 'bit :displaced-to basis :displaced-index-offset 17))
+             (expected (make-array n :element-type 'bit)))
+        (dotimes (i (length basis))
+          (setf (sbit basis i) (if (zerop (mod (* i 7) 3)) 1 0)))
+        (dotimes (i n)
+          (setf (sbit expected i) (logand (bit a1 i) (lognot (bit a2 i)) 1)))
+        (values (equal (bit-andc2 a1 a2) expected)
+                (equal (bit-not a2) (map 'bit-vector (lambda (b) (- 1 b)) a2))
+                (progn (bit-andc2 a1 a2 t) (equal a1 expected))))
+      (t t t))
+
+(test bit-vector-count-position
+      (let* ((basis (make-array 400 :element-type 'bit :initial-element 0))
+             (v (make-array 390 :element-type 'bit :displaced-to basis :displaced-index-offset 5)))
+        (setf (sbit basis 5) 1 (sbit basis 70) 1 (sbit basis 200) 1 (sbit basis 394) 1)
+        (values (count 1 v) (count 0 v :start 10 :end 300)
+                (position 1 v) (position 1 v :start 1) (position 1 v :from-end t)
+                (position 1 v :start 66 :end 195) (position 0 v :start 0)
+                (find 1 v :start 196) (find 1 v :start 66 :end 195)
+                (replace (make-array 6 :element-type 'bit) v :start2 63)))
+      (4 288 0 65 389 nil 1 1 nil #*001000))
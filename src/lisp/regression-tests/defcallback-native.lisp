@@ -34,3 +34,36 @@
                      collect (clasp-ffi:%mem-ref array :int (* i intsize))))
           (clasp-ffi:%foreign-free array)))
       ((1 2 3 4 5 6 7 8 9 10)))
+
+(test foreign-funcall-cached
+      (flet ((labs (n) (clasp-ffi:%foreign-funcall "labs" :long n :long)))
+        (loop for n in '(-3 0 42 -100000)
+              collect (labs n)))
+      ((3 0 42 100000)))
+
+(test foreign-memory-pool-views
+      (clasp-ffi:with-foreign-memory-pool (pool :block-size 4096)
+        (let* ((buffers (clasp-ffi:foreign-pool-alloc-many pool 64 10))
+               (source (make-array 8 :element-type 'double-float
+                                     :initial-contents '(1d0 2d0 3d0 4d0 5d0 6d0 7d0 8d0))))
+          (multiple-value-bind (view view-pointer)
+              (clasp-ffi:foreign-pool-make-vector pool 'double-float 8)
+            ;; C code writing through VIEW-POINTER is seen directly in VIEW.
+            (clasp-ffi:%copy-vector-to-foreign source (first buffers))
+            (clasp-ffi:%foreign-funcall "memcpy" :pointer view-pointer
+                                        :pointer (first buffers) :size 64 :pointer)
+            (let ((back (make-array 4 :element-type 'double-float :initial-element 0d0)))
+              (clasp-ffi:%copy-foreign-to-vector (first buffers) back :offset 32)
+              (list (length buffers)
+                    (coerce view 'list)
+                    (coerce back 'list))))))
+      ((10 (1d0 2d0 3d0 4d0 5d0 6d0 7d0 8d0) (5d0 6d0 7d0 8d0))))
+
+(test-expect-error copy-vector-past-foreign-end
+      (let ((buffer (clasp-ffi:%foreign-alloc 16)))
+        (unwind-protect
+             (clasp-ffi:%copy-vector-to-foreign
+              (make-array 4 :element-type 'double-float :initial-element 0d0)
+              buffer :offset 8)
+          (clasp-ffi:%foreign-free buffer)))
+      :description "Copying past the end of sized foreign memory is an error")
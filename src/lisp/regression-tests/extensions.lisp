@@ -33,3 +33,144 @@
         (output (read-line stream)))
    (close stream)
    (string= output "hello world")))
+
+(defun serialize-round-trip (object)
+  (ext:deserialize-from-octets (ext:serialize-to-octets object)))
+
+(test-true serialize-round-trip-atoms
+           (let ((objects (list 0 -1 most-positive-fixnum most-negative-fixnum
+                                (expt 7 100) (- (expt 3 200)) 22/7 #c(1 2) #c(1.5d0 -2d0)
+                                1.5f0 -2.25d0 #\a (code-char 955)
+                                nil t :keyword 'car "base" (string (code-char 955)) (make-symbol "GENSYM"))))
+             (loop for object in objects
+                   for copy = (serialize-round-trip object)
+                   always (if (and (symbolp object) (null (symbol-package object)))
+                              (string= (symbol-name object) (symbol-name copy))
+                              (equal object copy)))))
+
+(test-true serialize-round-trip-specialized-arrays
+           (let ((arrays (list (make-array 5 :element-type 'bit :initial-contents '(1 0 1 1 0))
+                               (make-array 3 :element-type '(signed-byte 4) :initial-contents '(-8 7 -1))
+                               (make-array 4 :element-type '(unsigned-byte 16) :initial-contents '(0 1 65535 300))
+                               (make-array 2 :element-type 'double-float :initial-contents '(1d0 -0.5d0))
+                               (make-array '(2 3) :element-type 'single-float :initial-element 2.5f0)
+                               (make-array 6 :element-type 'fixnum :initial-contents '(1 2 3 4 5 6)))))
+             (loop for array in arrays
+                   for copy = (serialize-round-trip array)
+                   always (and (equal (array-element-type array) (array-element-type copy))
+                               (equalp array copy)))))
+
+(test serialize-fill-pointer-vector
+      (let ((vector (make-array 10 :fill-pointer 3 :adjustable t :initial-element 'x)))
+        (let ((copy (serialize-round-trip vector)))
+          (values (length copy) (adjustable-array-p copy) (array-has-fill-pointer-p copy))))
+      (3 t t))
+
+(test-true serialize-preserves-sharing-and-cycles
+           (let* ((shared (list 1 2 3))
+                  (circular (list 'a 'b 'c))
+                  (vector (vector shared shared nil)))
+             (setf (cdr (last circular)) circular
+                   (aref vector 2) vector)
+             (destructuring-bind (v c) (serialize-round-trip (list vector circular))
+               (and (eq (aref v 0) (aref v 1))
+                    (eq (aref v 2) v)
+                    (eq (cdddr c) c)
+                    (eq (car c) 'a)))))
+
+(defstruct serialize-test-struct a (b 0 :type fixnum) c)
+
+(test-true serialize-hash-tables-and-structures
+           (let* ((table (make-hash-table :test 'equal))
+                  (struct (make-serialize-test-struct :a "key" :b 42 :c table)))
+             (setf (gethash "key" table) struct
+                   (gethash '(1 2) table) 'list)
+             (let* ((copy (serialize-round-trip struct))
+                    (copied-table (serialize-test-struct-c copy)))
+               (and (serialize-test-struct-p copy)
+                    (= (serialize-test-struct-b copy) 42)
+                    (eq (hash-table-test copied-table) 'equal)
+                    (eq (gethash "key" copied-table) copy)
+                    (eq (gethash (list 1 2) copied-table) 'list)))))
+
+(test serialize-stream-several-objects
+      (let ((file "serialize-test.bin"))
+        (unwind-protect
+             (progn
+               (with-open-file (out file :direction :output :element-type '(unsigned-byte 8)
+                                         :if-exists :supersede :if-does-not-exist :create)
+                 (ext:serialize-object '(1 "two" three) out)
+                 (ext:serialize-object 4.0d0 out))
+               (with-open-file (in file :element-type '(unsigned-byte 8))
+                 (list (ext:deserialize-object in)
+                       (ext:deserialize-object in)
+                       (ext:deserialize-object in nil :eof))))
+          (when (probe-file file)
+            (delete-file file))))
+      (((1 "two" three) 4.0d0 :eof)))
+
+(test-true serialize-stream-large-object
+      ;; Many small fields, so the buffer is flushed from single byte writes.
+      (let ((file "serialize-test-large.bin")
+            (list (loop for i below 100000 collect i)))
+        (unwind-protect
+             (progn
+               (with-open-file (out file :direction :output :element-type '(unsigned-byte 8)
+                                         :if-exists :supersede :if-does-not-exist :create)
+                 (ext:serialize-object list out))
+               (with-open-file (in file :element-type '(unsigned-byte 8))
+                 (equal (ext:deserialize-object in) list)))
+          (when (probe-file file)
+            (delete-file file)))))
+
+(test-expect-error serialize-unsupported-object
+                   (ext:serialize-to-octets #'car))
+
+(test async-io-round-trip
+      (let ((file "async-io-test.bin")
+            (data (make-array 10000 :element-type '(unsigned-byte 8)))
+            (ext:*async-io-chunk-size* 4096))
+        (dotimes (i (length data)) (setf (aref data i) (mod (* i 7) 256)))
+        (unwind-protect
+             (progn
+               (with-open-file (out file :direction :output :element-type '(unsigned-byte 8)
+                                         :if-exists :supersede :if-does-not-exist :create)
+                 (mp:force (ext:async-write-sequence data out)))
+               (with-open-file (in file :element-type '(unsigned-byte 8))
+                 (let ((copy (make-array 12000 :element-type '(unsigned-byte 8)
+                                               :initial-element 0))
+                       (small (make-array 4 :element-type '(unsigned-byte 8))))
+                   (list (mp:force (ext:async-read-sequence copy in))
+                         (equalp data (subseq copy 0 10000))
+                         (mp:force (ext:async-read in small :offset 1 :callback #'1+))
+                         (coerce small 'list)
+                         (file-position in)))))
+          (when (probe-file file)
+            (delete-file file))))
+      ((10000 t 5 (7 14 21 28) 0)))
+
+(test vector-math-kernels
+      (let* ((n 1000)
+             (x (make-array n :element-type 'double-float))
+             (y (make-array n :element-type 'double-float))
+             (r (make-array n :element-type 'double-float))
+             (f (make-array 5 :element-type 'fixnum :initial-contents '(3 -1 4 1 -5)))
+             (ext:*vector-math-parallel-threshold* 100))
+        (dotimes (i n)
+          (setf (aref x i) (float i 1d0) (aref y i) 2d0))
+        (list (aref (ext:vector-add r x y :parallel t) 10)
+              (aref (ext:vector-fma r x y x :start 5 :end 6) 5)
+              (ext:vector-sum x :parallel t)
+              (ext:vector-dot x y :start 1 :end 4)
+              (ext:vector-max x :end 500)
+              (ext:vector-min x :start 20 :parallel t)
+              (ext:vector-min x :start 7 :end 7)
+              (coerce (ext:vector-scale (make-array 5 :element-type 'fixnum) 2 f) 'list)
+              (ext:vector-dot f f)
+              (aref (ext:vector-axpy 3d0 x y) 4)))
+      ((12d0 15d0 499500d0 12d0 499d0 20d0 nil (6 -2 8 2 -10) 52 14d0)))
+
+(test-expect-error vector-math-fixnum-overflow
+                   (let ((f (make-array 2 :element-type 'fixnum
+                                          :initial-element most-positive-fixnum)))
+                     (ext:vector-add (make-array 2 :element-type 'fixnum) f f)))
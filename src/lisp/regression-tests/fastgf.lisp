@@ -5,3 +5,48 @@
 (defmethod fgf-foo ((x symbol)) :symbol)
 (test dispatch-symbol (fgf-foo :yadda) (:symbol))
 (test-expect-error dispatch-no-applicable-method (fgf-foo 1.2) :description "This should not dispatch")
+
+;;; Generic functions called on many classes switch to a hashed cache.
+(defclass fgf-mega-base () ((id :initarg :id :reader fgf-mega-id)))
+(defgeneric fgf-mega (x y))
+(defmethod fgf-mega ((x fgf-mega-base) y) (list (fgf-mega-id x) y))
+(defparameter *fgf-mega-instances*
+  (loop for i below (* 2 clos::*megamorphic-call-history-threshold*)
+        for name = (intern (format nil "FGF-MEGA-~d" i))
+        do (eval `(defclass ,name (fgf-mega-base) ()))
+        collect (make-instance name :id i)))
+(test megamorphic-dispatch
+      (loop for instance in *fgf-mega-instances*
+            for i from 0
+            always (and (equal (fgf-mega instance i) (list i i))
+                        (= (fgf-mega-id instance) i)))
+      (t))
+(test-true megamorphic-dispatch-installed
+           (clos::megamorphic-cache-of #'fgf-mega))
+(defmethod fgf-mega ((x fgf-mega-base) (y integer)) (list :new (fgf-mega-id x) y))
+(test megamorphic-dispatch-invalidated
+      (loop for instance in *fgf-mega-instances*
+            for i from 0
+            always (and (equal (fgf-mega instance i) (list :new i i))
+                        (equal (fgf-mega instance :y) (list i :y))))
+      (t))
+
+;;; Call histories saved by name can satiate a generic function again.
+(defgeneric fgf-persist (x))
+(defmethod fgf-persist ((x integer)) :integer)
+(defmethod fgf-persist ((x symbol)) :symbol)
+(test call-histories-save-load
+      (let ((file "fgf-call-histories.lisp"))
+        (unwind-protect
+             (progn
+               (fgf-persist 1)
+               (fgf-persist 'a)
+               (clos:save-call-histories file :names '(fgf-persist))
+               (clos::erase-generic-function-call-history #'fgf-persist)
+               (list (clos:load-call-histories file :compile nil)
+                     (length (clos::call-history-designators #'fgf-persist))
+                     (fgf-persist 2)
+                     (fgf-persist :b)))
+          (when (probe-file file)
+            (delete-file file))))
+      ((1 2 :integer :symbol)))
@@ -5,3 +5,33 @@
       (with-output-to-string (*standard-output*)
         (compile-file "sys:src;lisp;regression-tests;lowlevel-source.lisp" :verbose nil :print nil))
       (""))
+
+;;; The JIT object cache reuses the object compiled from identical IR.
+(test-true jit-object-cache-hit
+      (let ((directory (format nil "jit-object-cache-test-~d/" (core:getpid)))
+            (old (llvm-sys:jit-object-cache-directory)))
+        (flet ((load-ir ()
+                 (let ((jit (llvm-sys:clasp-jit)))
+                   (let ((dylib (llvm-sys:create-and-register-jitdylib
+                                 jit (symbol-name (gensym "JIT-OBJECT-CACHE-TEST")))))
+                     (llvm-sys:add-irmodule jit dylib
+                                            (llvm-sys:parse-irstring
+                                             "define i64 @jit_object_cache_test(i64 %x) {
+  %y = add i64 %x, 42
+  ret i64 %y
+}
+" (cmp::thread-local-llvm-context) "jit-object-cache-test")
+                                            cmp:*thread-safe-context* 0)
+                     ;; Looking the function up makes the JIT compile it.
+                     (llvm-sys:lookup jit dylib "jit_object_cache_test"))))
+               (hits () (nth-value 0 (llvm-sys:jit-object-cache-statistics))))
+          (unwind-protect
+               (progn
+                 (llvm-sys:set-jit-object-cache-directory directory)
+                 (load-ir)
+                 (let ((hits (hits)))
+                   (load-ir)
+                   (> (hits) hits)))
+            (llvm-sys:prune-jit-object-cache 0)
+            (core:rmdir directory)
+            (llvm-sys:set-jit-object-cache-directory old)))))
@@ -253,3 +253,154 @@
         (spam-processes nthreads (lambda () (mp:atomic-push nil (car place))))
         (car place))
       ((nil nil nil nil nil nil nil)))
+
+(test future-values
+      (multiple-value-list (mp:force (mp:future (values 1 2 3))))
+      ((1 2 3)))
+
+(test future-nested
+      (labels ((fib (n)
+                 (if (< n 10)
+                     (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))
+                     (let ((a (mp:future (fib (- n 1))))
+                           (b (fib (- n 2))))
+                       (+ (mp:force a) b)))))
+        (fib 20))
+      (6765))
+
+(test-expect-error future-error
+                   (mp:force (mp:future (error "Failed in a future"))))
+
+(test pmap-vector
+      (mp:pmap 'vector #'+ (loop for i below 1000 collect i) #(1 2 3))
+      (#(1 3 5)))
+
+(test pmap-list
+      (equal (mp:pmap 'list #'1+ (loop for i below 1000 collect i))
+             (loop for i from 1 to 1000 collect i))
+      (t))
+
+(test preduce
+      (list (mp:preduce #'+ (loop for i from 1 to 10000 collect i))
+            (mp:preduce #'+ #() :initial-value 7)
+            (mp:preduce #'max #(3 1 4 1 5 9 2 6) :key #'-))
+      ((50005000 7 -1)))
+
+(test channel-fifo
+      (let ((channel (mp:make-channel :capacity 4)))
+        (list (mp:channel-send channel 1)
+              (mp:channel-send channel 2)
+              (mp:channel-count channel)
+              (mp:channel-receive channel)
+              (mp:channel-receive channel)
+              (multiple-value-list (mp:channel-receive channel :timeout 0))))
+      ((t t 2 1 2 (nil nil))))
+
+(test channel-bounded-full
+      (let ((channel (mp:make-channel :capacity 2)))
+        (list (mp:channel-send channel :a :timeout 0)
+              (mp:channel-send channel :b :timeout 0)
+              (mp:channel-send channel :c :timeout 0)
+              (mp:channel-capacity channel)))
+      ((t t nil 2)))
+
+(test channel-producers-consumers
+      (let* ((channel (mp:make-channel :capacity 8))
+             (results (mp:make-channel))
+             (nthreads 4) (per-thread 1000)
+             (consumers
+               (loop repeat nthreads
+                     collect (mp:process-run-function
+                              'consumer
+                              (lambda ()
+                                (loop for n = (mp:channel-receive channel)
+                                      until (eq n :done)
+                                      sum n into total
+                                      finally (mp:channel-send results total))))))
+             (producers
+               (loop repeat nthreads
+                     collect (mp:process-run-function
+                              'producer
+                              (lambda ()
+                                (loop for i from 1 to per-thread
+                                      do (mp:channel-send channel i)))))))
+        (mapc #'mp:process-join producers)
+        (loop repeat nthreads do (mp:channel-send channel :done))
+        (mapc #'mp:process-join consumers)
+        (loop repeat nthreads sum (mp:channel-receive results)))
+      (2002000))
+
+(test channel-select
+      (let ((a (mp:make-channel)) (b (mp:make-channel)))
+        (mp:channel-send b :from-b)
+        (multiple-value-bind (object channel) (mp:channel-select (list a b) :timeout 1)
+          (list object (eq channel b)
+                (multiple-value-list (mp:channel-select (list a b) :timeout 0)))))
+      ((:from-b t (nil nil))))
+
+(test lock-under-contention
+      (let* ((lock (mp:make-lock :name 'contended-lock))
+             (counter 0)
+             (threads
+               (loop repeat 4
+                     collect (mp:process-run-function
+                              'contender
+                              (lambda ()
+                                (loop repeat 10000
+                                      do (mp:with-lock (lock) (incf counter))))))))
+        (mapc #'mp:process-join threads)
+        counter)
+      (40000))
+
+(test lock-contention-counters
+      ;; The contender finds the lock held well past its spin, so it blocks
+      ;; exactly once.
+      (let ((lock (mp:make-lock :name "ZCONTND")))
+        (mp:lock-contention-statistics :reset t)
+        (mp:get-lock lock)
+        (let ((contender (mp:process-run-function 'contender
+                                                  (lambda () (mp:with-lock (lock) t)))))
+          (sleep 0.5)
+          (mp:giveup-lock lock)
+          (mp:process-join contender))
+        (list (mp:lock-contention-count lock)
+              (cdr (assoc "ZCONTND" (mp:lock-contention-statistics) :test #'string=))))
+      ((1 1)))
+
+(test package-lock-readers-and-writers
+      (let* ((package (make-package (gensym "BIG-READER") :use nil))
+             (writers
+               (loop for w below 2
+                     collect (let ((w w))
+                               (mp:process-run-function
+                                'interner
+                                (lambda ()
+                                  (loop for i below 500
+                                        do (intern (format nil "S~d-~d" w i) package)))))))
+             (readers
+               (loop repeat 4
+                     collect (mp:process-run-function
+                              'finder
+                              (lambda ()
+                                (loop repeat 2000
+                                      do (find-symbol "S0-0" package)))))))
+        (mapc #'mp:process-join writers)
+        (mapc #'mp:process-join readers)
+        (prog1 (loop for w below 2
+                     sum (loop for i below 500
+                               count (find-symbol (format nil "S~d-~d" w i) package)))
+          (delete-package package)))
+      (1000))
+
+(test psort-matches-sort
+      (let ((mp:*psort-threshold* 1000)
+            (doubles (make-array 50000 :element-type 'double-float))
+            (pairs (make-array 20000)))
+        (dotimes (i 50000)
+          (setf (aref doubles i) (float (mod (* i 7919) 50021) 1d0)))
+        (dotimes (i 20000)
+          (setf (aref pairs i) (cons (mod (* i 37) 101) i)))
+        (list (equalp (mp:psort (copy-seq doubles) #'<) (sort doubles #'<))
+              (equalp (mp:psort (copy-seq pairs) #'< :key #'car :stable t)
+                      (stable-sort pairs #'< :key #'car))))
+      ((t t)))
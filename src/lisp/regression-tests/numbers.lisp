@@ -760,3 +760,44 @@
                  (declare (fixnum integer-factor))
                  (the fixnum (* integer-factor end))))
              13)))
+
+(test double-fast-paths
+      (let ((d 1.5d0) (f 2))
+        (list (funcall '+ d f) (funcall '- f d) (funcall '* d d) (funcall '/ d f)))
+      ((3.5d0 0.5d0 2.25d0 0.75d0)))
+
+(test double-complex-fast-paths
+      (let ((a #c(1d0 2d0)) (b #c(3d0 -1d0)))
+        (list (funcall '+ a b) (funcall '- a b) (funcall '* a b) (funcall '/ #c(5d0 5d0) b)))
+      ((#c(4d0 1d0) #c(-2d0 3d0) #c(5d0 5d0) #c(1d0 2d0))))
+
+(test-true huge-bignum-multiply
+      ;; Large enough that core__next_mul splits the product across threads.
+      (let* ((a (1- (expt 7 200000)))
+             (b (1+ (expt 3 400000)))
+             (p (* a b)))
+        (and (= (mod p 1000000007)
+                (mod (* (mod a 1000000007) (mod b 1000000007)) 1000000007))
+             (= (floor p b) a))))
+
+(test-true huge-bignum-multiply-threads
+      ;; Unbalanced operands are split differently from balanced ones;
+      ;; both must agree with the product made on one thread.
+      (let* ((a (1- (expt 7 200000)))
+             (b (1+ (expt 3 1200000)))
+             (parallel (list (* a b) (* b (1+ a))))
+             (old (core:set-bignum-multiply-threads 1)))
+        (unwind-protect
+             (equal parallel (list (* a b) (* b (1+ a))))
+          (core:set-bignum-multiply-threads old))))
+
+(test huge-bignum-isqrt
+      (let ((n (expt 10 20001)))
+        (list (= (isqrt (* n n)) n) (= (isqrt (1- (* n n))) (1- n))))
+      ((t t)))
+
+(test huge-bignum-parse-integer
+      (let ((n (1- (expt 10 50000))))
+        (list (= (parse-integer (prin1-to-string n)) n)
+              (= (parse-integer (format nil "-~36r" n) :radix 36) (- n))))
+      ((t t)))
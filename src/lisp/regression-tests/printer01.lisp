@@ -567,3 +567,78 @@ BBBBCCCC**DDDD"))
 (test format-parameters-colon-at-08
       (format nil "a~4@:A" nil)
       ("a  ()"))
+
+(test print-float-shortest-01
+      (let ((*read-default-float-format* 'single-float))
+        (list (prin1-to-string 0.1) (prin1-to-string 1.5) (prin1-to-string 0.1d0)
+              (prin1-to-string 123.456d0) (prin1-to-string -0.0d0)))
+      (("0.1" "1.5" "0.1d0" "123.456d0" "-0.0d0")))
+
+(test-true print-float-shortest-round-trip
+           (let ((*read-default-float-format* 'double-float))
+             (loop repeat 10000
+                   for x = (* (- (random 2d0) 1d0)
+                              (expt 10d0 (- (random 600) 300)))
+                   always (= x (read-from-string (prin1-to-string x))))))
+
+
+(test print-integer-direct-01
+      (list (write-to-string 12345 :base 10 :radix t :pretty nil)
+            (write-to-string -255 :base 16 :radix t :pretty nil)
+            (write-to-string 35 :base 36 :radix t :pretty nil)
+            (write-to-string most-negative-fixnum :base 2 :pretty nil)
+            (write-to-string (expt 10 30) :base 10 :radix t :pretty nil)
+            (write-to-string 2/3 :base 7 :radix t :pretty nil))
+      (("12345." "#x-FF" "#36rZ"
+        "-10000000000000000000000000000000000000000000000000000000000000"
+        "1000000000000000000000000000000." "#7r2/3")))
+
+(test-true print-integer-huge-bignum
+           (let ((n (- (expt 7 200000))))
+             (= n (read-from-string (prin1-to-string n)))))
+
+(test format-cache-simple-directives
+      (let ((control (concatenate 'string "~A=~S " "~D~%~{<~A ~D>~}")))
+        (list (format nil control :x "y" 10 '(a 1 b 2))
+              (format nil (copy-seq control) 'p #\q 20 nil)))
+      (("X=\"y\" 10
+<A 1><B 2>" "P=#\\q 20
+")))
+
+(test format-cache-mutated-control-string
+      (let ((control (copy-seq "~A!")))
+        (list (format nil control 1)
+              (progn (setf (char control 2) #\?)
+                     (format nil control 1))))
+      (("1!" "1?")))
+
+(test format-cache-interpreted-directives
+      (let ((control (copy-seq "~{~A~^, ~}")))
+        (list (format nil control '(1 2 3)) (apply #'format nil control '((a b)))))
+      (("1, 2, 3" "A, B")))
+
+(test format-cache-iteration-without-arguments
+      ;; A body that consumes nothing isn't compiled; the interpreter runs it.
+      (list (format nil (copy-seq "~{-~}") nil)
+            (format nil (copy-seq "~1{-~}") '(1 2)))
+      (("" "-")))
+
+(test-expect-error format-cache-missing-argument
+                   (format nil (copy-seq "~A ~D") 1)
+                   :type format-error)
+
+(test pprint-dispatch-atom-fast-path
+      (let ((*print-pprint-dispatch* (copy-pprint-dispatch nil))
+            (*print-pretty* t))
+        (list (write-to-string '(1 "two" #\3 4.0d0))
+              (progn
+                (set-pprint-dispatch 'integer
+                                     (lambda (stream n) (format stream "<~D>" (* 2 n))))
+                (write-to-string '(1 "two" #\3 4.0d0)))
+              (nth-value 1 (pprint-dispatch 17 (copy-pprint-dispatch nil)))))
+      (("(1 \"two\" #\\3 4.0d0)" "(<2> \"two\" #\\3 4.0d0)" nil)))
+
+(test print-nested-ugly
+      (let ((*print-pretty* nil) (*print-level* 3) (*print-length* 3))
+        (write-to-string '(1 (2 (3 (4))) #(a b c d) "s" 1.5 x)))
+      ("(1 (2 (3 #)) #(A B C ...) ...)"))
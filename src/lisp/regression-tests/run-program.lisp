@@ -97,3 +97,14 @@ Return the result of the body and the results of external-process-wait."
                 (return (values (zerop (length (get-output-stream-string output-stream)))
                                 (zerop (length (get-output-stream-string error-stream))))))))))
   (nil nil))
+
+(test-expect-error run-program-missing-program
+                   (ext:run-program "/nonexistent/clasp-no-such-program" nil
+                                    :input nil :output nil :error nil)
+                   :description "posix_spawn failing to find the program is an error")
+
+(test-expect-error run-program-missing-program-environ
+                   (ext:run-program "/nonexistent/clasp-no-such-program" nil
+                                    :input nil :output nil :error nil
+                                    :environ '("CLASP_TEST=1"))
+                   :description "the explicit environment path also reports a missing program")
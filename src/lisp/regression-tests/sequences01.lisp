@@ -448,6 +448,30 @@
                    (funcall #'(lambda (x) (stable-sort x #'<)) #'position)
                    :type type-error)
 
+(test sort-specialized-vectors
+      (let ((doubles (make-array 10000 :element-type 'double-float))
+            (bytes (make-array 10000 :element-type '(unsigned-byte 8)))
+            (fixnums (make-array 10000 :element-type 'fixnum)))
+        (dotimes (i 10000)
+          (setf (aref doubles i) (float (- (mod (* i 7919) 10007) 5000) 1d0)
+                (aref bytes i) (mod (* i 31) 256)
+                (aref fixnums i) (- (mod (* i 7919) 10007) 5000)))
+        (list (every #'<= (sort doubles #'<) (subseq doubles 1))
+              (every #'>= (sort bytes #'>) (subseq bytes 1))
+              (every #'<= (stable-sort fixnums #'<) (subseq fixnums 1))
+              (sort (copy-seq "sorting") #'char<)
+              (sort (vector "pear" "apple" "fig") #'string>)))
+      ((t t t "ginorst" #("pear" "fig" "apple"))))
+
+(test stable-sort-vector-galloping
+      ;; Long runs with many equal keys exercise the galloping merges.
+      (let* ((items (loop for i below 3000
+                          collect (cons (if (< (mod i 600) 300) (floor i 7) (- (floor i 11)))
+                                        i)))
+             (sorted (stable-sort (coerce items 'vector) #'< :key #'car)))
+        (equalp sorted (coerce (stable-sort (copy-list items) #'< :key #'car) 'vector)))
+      (t))
+
 (test nreverse-bit-vector.2-a (nreverse (copy-seq #*0011)) (#*1100))
 
 (test nreverse-bit-vector.2-b (NREVERSE (COPY-SEQ #*0001101101)) (#*1011011000))
@@ -0,0 +1,78 @@
+(in-package #:clasp-tests)
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (require :serve-event))
+
+;;; Event loops use epoll and timerfd, so these only run on Linux.
+
+(defmacro with-event-loop ((name) &body body)
+  `(let ((,name (ext:make-event-loop)))
+     (unwind-protect (progn ,@body)
+       (ext:close-event-loop ,name))))
+
+#+linux
+(test event-loop-timer
+      (with-event-loop (event-loop)
+        (let ((fired 0))
+          (ext:event-loop-add-timer event-loop 0.01 (lambda () (incf fired)))
+          (list (ext:event-loop-run-once event-loop 5)
+                fired
+                ;; A one-shot timer removes itself once it fires.
+                (ext:event-loop-run-once event-loop 0.05)
+                fired)))
+      ((t 1 nil 1)))
+
+#+linux
+(test event-loop-repeating-timer
+      (with-event-loop (event-loop)
+        (let* ((fired 0)
+               (timer (ext:event-loop-add-timer event-loop 0.01 (lambda () (incf fired))
+                                                :repeat 0.01)))
+          (loop until (>= fired 3)
+                do (ext:event-loop-run-once event-loop 5))
+          (ext:event-loop-remove-timer event-loop timer)
+          (list fired (ext:event-loop-run-once event-loop 0.05))))
+      ((3 nil)))
+
+#+linux
+(test event-loop-huge-timeout
+      ;; The timeout is clamped rather than overflowing the int epoll takes.
+      (with-event-loop (event-loop)
+        (ext:event-loop-add-timer event-loop 0.01 (lambda ()))
+        (ext:event-loop-run-once event-loop 1d30))
+      (t))
+
+#+linux
+(test event-loop-wakeup
+      (with-event-loop (event-loop)
+        (let ((waker (mp:process-run-function
+                      nil (lambda () (sleep 0.1) (ext:event-loop-wakeup event-loop)))))
+          (prog1 (ext:event-loop-run-once event-loop 10)
+            (mp:process-join waker))))
+      (t))
+
+#+linux
+(test event-loop-fd-handler
+      (call-with-tcp-pair
+       (lambda (client server)
+         (with-event-loop (event-loop)
+           (let* ((fd (sb-bsd-sockets:socket-file-descriptor server))
+                  (calls 0)
+                  (handler (ext:event-loop-add-fd event-loop fd :input
+                                                  (lambda (ready) (declare (ignore ready))
+                                                    (incf calls)))))
+             (list (ext:event-loop-run-once event-loop 0)
+                   (progn (sb-bsd-sockets:socket-send client
+                                                      (make-array 1 :element-type '(unsigned-byte 8)
+                                                                    :initial-element 7)
+                                                      nil)
+                          (ext:event-loop-run-once event-loop 5))
+                   calls
+                   (progn (ext:event-loop-remove-fd event-loop handler)
+                          (ext:event-loop-run-once event-loop 0))
+                   calls)))))
+      ((nil t 1 nil 1)))
+
+(test serve-event-timeout
+      (serve-event:serve-event 0)
+      (nil))
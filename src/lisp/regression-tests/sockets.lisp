@@ -0,0 +1,105 @@
+(in-package #:clasp-tests)
+
+;;; Buffered socket streams, sendfile and batched datagrams, over loopback.
+;;; Everything fits in the kernel's socket buffers, so one thread can write
+;;; a whole message before reading it.
+
+(defun call-with-tcp-pair (function)
+  (let ((listener (make-instance 'sb-bsd-sockets:inet-socket :type :stream :protocol :tcp))
+        (client (make-instance 'sb-bsd-sockets:inet-socket :type :stream :protocol :tcp))
+        (server nil))
+    (unwind-protect
+         (progn
+           (sb-bsd-sockets:socket-bind listener #(127 0 0 1) 0)
+           (sb-bsd-sockets:socket-listen listener 1)
+           (sb-bsd-sockets:socket-connect client #(127 0 0 1)
+                                          (nth-value 1 (sb-bsd-sockets:socket-name listener)))
+           (setf server (sb-bsd-sockets:socket-accept listener))
+           (funcall function client server))
+      (sb-bsd-sockets:socket-close client)
+      (when server (sb-bsd-sockets:socket-close server))
+      (sb-bsd-sockets:socket-close listener))))
+
+(defun test-octets (n)
+  (let ((octets (make-array n :element-type '(unsigned-byte 8))))
+    (dotimes (i n octets)
+      (setf (aref octets i) (mod (* i 7) 251)))))
+
+(test-true buffered-socket-stream-round-trip
+      ;; Small writes are copied into the buffer and the large one is
+      ;; queued uncopied; the large read bypasses the small input buffer.
+      (call-with-tcp-pair
+       (lambda (client server)
+         (let ((out (sb-bsd-sockets:socket-make-buffered-stream client :buffer-size 1024))
+               (in (sb-bsd-sockets:socket-make-buffered-stream server :buffer-size 1024))
+               (large (test-octets 20000))
+               (received (make-array 20002 :element-type '(unsigned-byte 8))))
+           (write-byte 1 out)
+           (write-sequence large out)
+           (write-byte 2 out)
+           (finish-output out)
+           (and (= (read-sequence received in) 20002)
+                (= (aref received 0) 1)
+                (equalp (subseq received 1 20001) large)
+                (= (aref received 20001) 2))))))
+
+(test-expect-error socket-read-bad-region
+      (call-with-tcp-pair
+       (lambda (client server)
+         (declare (ignore server))
+         (sb-bsd-sockets::ll-socket-read (sb-bsd-sockets:socket-file-descriptor client)
+                                         (make-array 16 :element-type '(unsigned-byte 8))
+                                         10 5)))
+      :description "START after END must not become a huge read")
+
+(test-expect-error socket-read-past-end
+      (call-with-tcp-pair
+       (lambda (client server)
+         (declare (ignore server))
+         (sb-bsd-sockets::ll-socket-read (sb-bsd-sockets:socket-file-descriptor client)
+                                         (make-array 16 :element-type '(unsigned-byte 8))
+                                         0 17)))
+      :description "END past the buffer's length is an error")
+
+(test-true socket-send-file
+      (let ((file "socket-send-file-test.bin")
+            (octets (test-octets 10000)))
+        (unwind-protect
+             (progn
+               (with-open-file (stream file :direction :output :if-exists :supersede
+                                            :element-type '(unsigned-byte 8))
+                 (write-sequence octets stream))
+               (call-with-tcp-pair
+                (lambda (client server)
+                  (let ((in (sb-bsd-sockets:socket-make-buffered-stream server))
+                        (received (make-array 9000 :element-type '(unsigned-byte 8))))
+                    (and (= (sb-bsd-sockets:socket-send-file client file :start 1000) 9000)
+                         (= (read-sequence received in) 9000)
+                         (equalp received (subseq octets 1000)))))))
+          (when (probe-file file)
+            (delete-file file)))))
+
+(test-true socket-batched-datagrams
+      (let ((sender (make-instance 'sb-bsd-sockets:inet-socket :type :datagram :protocol :udp))
+            (receiver (make-instance 'sb-bsd-sockets:inet-socket :type :datagram :protocol :udp)))
+        (unwind-protect
+             (progn
+               (sb-bsd-sockets:socket-bind sender #(127 0 0 1) 0)
+               (sb-bsd-sockets:socket-bind receiver #(127 0 0 1) 0)
+               (let ((port (nth-value 1 (sb-bsd-sockets:socket-name receiver)))
+                     (datagrams (list (test-octets 10) (test-octets 100) (test-octets 1000)))
+                     (buffers (loop repeat 4
+                                    collect (make-array 2000 :element-type '(unsigned-byte 8)))))
+                 (and (= (sb-bsd-sockets:socket-send-batch sender datagrams
+                                                           :address (list #(127 0 0 1) port))
+                         3)
+                      ;; Loopback delivers all three before the send returns.
+                      (multiple-value-bind (count lengths)
+                          (sb-bsd-sockets:socket-receive-batch receiver buffers)
+                        (and (= count 3)
+                             (equalp lengths #(10 100 1000))
+                             (every (lambda (buffer datagram)
+                                      (equalp (subseq buffer 0 (length datagram)) datagram))
+                                    buffers datagrams))))))
+          (sb-bsd-sockets:socket-close sender)
+          (sb-bsd-sockets:socket-close receiver))))
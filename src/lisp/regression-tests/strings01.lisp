@@ -87,3 +87,27 @@
            (equal
             (type-of "zażółć gęślą jaźń")
             '(SIMPLE-ARRAY CHARACTER (17))))
+
+(test string-search-two-way
+      (let ((haystack (concatenate 'string (make-string 300 :initial-element #\a)
+                                   "abaabaab" (make-string 50 :initial-element #\b)
+                                   "Needle"))
+            (wide (concatenate 'string "x" (string (code-char 955)) "yNEEDLE")))
+        (list (search "abaabaab" haystack)
+              (search "aab" haystack :start2 302)
+              (search "needle" haystack)
+              (search "needle" haystack :test #'char-equal)
+              (search "" haystack :start2 5)
+              (search "needle" wide :test #'char-equal)
+              (search (string (code-char 955)) wide)
+              (search "bb" "ab")))
+      ((300 302 nil 358 5 3 1 nil)))
+
+(test string-position-char
+      (let ((s (make-array 12 :element-type 'base-char :displaced-to (coerce "xxabcABCabcx" 'simple-base-string)
+                              :displaced-index-offset 0)))
+        (list (position #\b s) (position #\b s :from-end t) (position #\B s)
+              (position #\B s :test #'char-equal :start 5) (find #\C s :test #'char-equal)
+              (position #\z s) (position (code-char 955) s)
+              (string-equal "abcDEF" "ABCdef") (string-equal "abc" "abcd")))
+      ((3 9 6 6 #\c nil nil t nil)))
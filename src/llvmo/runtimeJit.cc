@@ -7,14 +7,24 @@
 
 //#include <llvm/Support/system_error.h>
 #include <dlfcn.h>
+#include <utime.h>
+#include <algorithm>
 #include <iomanip>
 #include <string>
+#include <vector>
 #include <llvm/ExecutionEngine/Orc/DebuggerSupportPlugin.h>
 #include <llvm/ExecutionEngine/Orc/TargetProcess/JITLoaderGDB.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ADT/StringExtras.h>
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/cons.h>
 #include <clasp/core/mpPackage.h>
+#include <clasp/core/pathname.h>
 #include <clasp/llvmo/code.h>
 #include <clasp/gctools/snapshotSaveLoad.h>
 #include <clasp/llvmo/jit.h>
@@ -676,6 +686,209 @@ class ClaspPlugin : public llvm::orc::ObjectLinkingLayer::Plugin {
 
 namespace llvmo {
 
+/*! A content-addressed cache of the object files that the JIT compiles.
+ *  The key is a SHA1 of the module bitcode and the target description, so
+ *  an entry is reused only for IR that is identical to what produced it.
+ *  Entries are files <key>.o in one directory that any number of clasp
+ *  processes can share - they are written to a unique temporary file and
+ *  renamed into place, so readers never see a partial object.
+ *  The directory comes from CLASP_JIT_OBJECT_CACHE and can be changed with
+ *  llvm-sys:set-jit-object-cache-directory; with no directory the cache
+ *  does nothing.
+ *  The entries are kept under a size limit, CLASP_JIT_OBJECT_CACHE_LIMIT
+ *  megabytes (default 1024). A hit touches its entry, and once a store takes
+ *  the cache over the limit the least recently used entries are removed
+ *  until it is down to three quarters of it.
+ */
+class ClaspObjectCache : public llvm::ObjectCache {
+public:
+  std::string _Directory;
+  std::string _TargetKey;
+  mp::Mutex _DirectoryMutex;
+  std::atomic<size_t> _Hits;
+  std::atomic<size_t> _Misses;
+  std::atomic<size_t> _Stores;
+  std::atomic<size_t> _Limit;
+  // The size of the entries as of the last prune, plus what has been stored since.
+  std::atomic<size_t> _Bytes;
+  std::atomic<bool> _Pruning;
+  ClaspObjectCache() : _DirectoryMutex(JITOBJCA_NAMEWORD), _Hits(0), _Misses(0), _Stores(0),
+                       _Limit((size_t)1024 * 1024 * 1024), _Bytes(0), _Pruning(false) {
+    const char* limit = getenv("CLASP_JIT_OBJECT_CACHE_LIMIT");
+    if (limit) this->_Limit = (size_t)strtoull(limit, NULL, 10) * 1024 * 1024;
+    const char* dir = getenv("CLASP_JIT_OBJECT_CACHE");
+    if (dir) this->setDirectory(dir);
+  };
+  std::string directory() {
+    mp::RAIIReadWriteLock<mp::Mutex> safe_lock(this->_DirectoryMutex);
+    return this->_Directory;
+  }
+  void setDirectory(const std::string& dir) {
+    if (dir != "") {
+      std::error_code ec = llvm::sys::fs::create_directories(dir);
+      if (ec) {
+        SIMPLE_ERROR("Could not create the JIT object cache directory {} - {}", dir, ec.message());
+      }
+    }
+    {
+      mp::RAIIReadWriteLock<mp::Mutex> safe_lock(this->_DirectoryMutex);
+      this->_Directory = dir;
+    }
+    // Measures the directory, and trims one left over a larger limit.
+    this->prune(this->_Limit);
+  }
+  /*! Remove the least recently used entries until the rest take at most
+      maxBytes, and return how many were removed. */
+  size_t prune(size_t maxBytes) {
+    std::string dir = this->directory();
+    if (dir == "") return 0;
+    struct Entry {
+      std::string path;
+      uint64_t size;
+      llvm::sys::TimePoint<> used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+      if (llvm::sys::path::extension(it->path()) != ".o") continue;
+      auto status = it->status();
+      if (!status) continue;
+      entries.push_back({it->path(), status->getSize(), status->getLastModificationTime()});
+      total += status->getSize();
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    size_t removed = 0;
+    for (auto& entry : entries) {
+      if (total <= maxBytes) break;
+      if (!llvm::sys::fs::remove(entry.path)) {
+        total -= entry.size;
+        ++removed;
+      }
+    }
+    this->_Bytes = total;
+    return removed;
+  }
+  std::string entryPath(const std::string& dir, const llvm::Module* M, bool reuseKey) {
+    // SimpleCompiler calls getObject and then notifyObjectCompiled for the same module on
+    // the compiling thread - remember the key between them so the bitcode is hashed once.
+    static thread_local const llvm::Module* keyModule = NULL;
+    static thread_local std::string key;
+    if (!reuseKey || M != keyModule) {
+      llvm::SmallString<0> bitcode;
+      llvm::raw_svector_ostream os(bitcode);
+      llvm::WriteBitcodeToFile(*M, os);
+      llvm::SHA1 hasher;
+      hasher.update(this->_TargetKey);
+      hasher.update(llvm::StringRef(bitcode.data(), bitcode.size()));
+      key = llvm::toHex(hasher.final(), true);
+    }
+    keyModule = reuseKey ? NULL : M;
+    return dir + "/" + key + ".o";
+  }
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* M) override {
+    std::string dir = this->directory();
+    if (dir == "") return nullptr;
+    std::string path = this->entryPath(dir, M, false);
+    auto cached = llvm::MemoryBuffer::getFile(path, false, false);
+    if (!cached) {
+      this->_Misses++;
+      return nullptr;
+    }
+    this->_Hits++;
+    // Mark the entry as recently used, for prune.
+    utime(path.c_str(), NULL);
+    // ClaspReturnObjectBuffer finds the ObjectFile_O by the name SimpleCompiler would have given the buffer
+    return llvm::MemoryBuffer::getMemBufferCopy((*cached)->getBuffer(), M->getModuleIdentifier() + "-jitted-objectbuffer");
+  }
+  void notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef obj) override {
+    std::string dir = this->directory();
+    if (dir == "") return;
+    std::string path = this->entryPath(dir, M, true);
+    int fd;
+    llvm::SmallString<256> tempPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tempPath)) return;
+    {
+      llvm::raw_fd_ostream out(fd, true);
+      out.write(obj.getBufferStart(), obj.getBufferSize());
+      out.close();
+      if (out.has_error()) {
+        out.clear_error();
+        llvm::sys::fs::remove(tempPath);
+        return;
+      }
+    }
+    if (llvm::sys::fs::rename(tempPath, path)) {
+      llvm::sys::fs::remove(tempPath);
+      return;
+    }
+    this->_Stores++;
+    if ((this->_Bytes += obj.getBufferSize()) > this->_Limit && !this->_Pruning.exchange(true)) {
+      this->prune(this->_Limit / 4 * 3);
+      this->_Pruning = false;
+    }
+  }
+};
+
+ClaspObjectCache* global_object_cache = NULL;
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Return the directory of the JIT object cache, or NIL if the cache is off.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp llvm_sys__jit_object_cache_directory() {
+  if (!global_object_cache) return nil<core::T_O>();
+  std::string dir = global_object_cache->directory();
+  if (dir == "") return nil<core::T_O>();
+  return core::SimpleBaseString_O::make(dir);
+}
+
+CL_LAMBDA(directory);
+CL_DOCSTRING(R"dx(Keep the object files the JIT compiles in DIRECTORY, creating it if needed, and
+reuse them when the same LLVM IR is compiled again - in this or any other process
+sharing the directory. NIL turns the cache off. Returns DIRECTORY.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp llvm_sys__set_jit_object_cache_directory(core::T_sp directory) {
+  if (!global_object_cache) SIMPLE_ERROR("The JIT has not been created yet");
+  if (directory.nilp()) {
+    global_object_cache->setDirectory("");
+  } else {
+    global_object_cache->setDirectory(gc::As<core::String_sp>(core::cl__namestring(directory))->get_std_string());
+  }
+  return directory;
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Return the number of JIT object cache hits, misses and objects stored, as three values.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv llvm_sys__jit_object_cache_statistics() {
+  if (!global_object_cache) return Values(core::clasp_make_fixnum(0), core::clasp_make_fixnum(0), core::clasp_make_fixnum(0));
+  return Values(core::clasp_make_fixnum(global_object_cache->_Hits.load()),
+                core::clasp_make_fixnum(global_object_cache->_Misses.load()),
+                core::clasp_make_fixnum(global_object_cache->_Stores.load()));
+}
+
+CL_LAMBDA(bytes);
+CL_DOCSTRING(R"dx(Keep the JIT object cache under BYTES, removing least recently used entries now if
+it is over. Returns the previous limit.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t llvm_sys__set_jit_object_cache_limit(size_t bytes) {
+  if (!global_object_cache) SIMPLE_ERROR("The JIT has not been created yet");
+  size_t previous = global_object_cache->_Limit.exchange(bytes);
+  global_object_cache->prune(bytes);
+  return previous;
+}
+
+CL_LAMBDA(&optional max-bytes);
+CL_DOCSTRING(R"dx(Remove the least recently used entries of the JIT object cache until the rest
+take at most MAX-BYTES, by default the cache's limit. 0 empties the cache.
+Returns the number of entries removed.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t llvm_sys__prune_jit_object_cache(core::T_sp max_bytes) {
+  if (!global_object_cache) return 0;
+  return global_object_cache->prune(max_bytes.nilp() ? global_object_cache->_Limit.load()
+                                                     : core::clasp_to_size_t(max_bytes));
+}
+
 /*! Call this after fork() to create a thread-pool for lljit
  */
 CL_DEFUN void llvm_sys__create_lljit_thread_pool() {
@@ -709,12 +922,26 @@ ClaspJIT_O::ClaspJIT_O(bool loading, JITDylib_O* mainJITDylib) {
   JTMB.setOptions(to);
   JTMB.setCodeModel(CodeModel::Small);
   JTMB.setRelocationModel(Reloc::Model::PIC_);
+  if (!global_object_cache) global_object_cache = new ClaspObjectCache();
+  {
+    // Everything besides the IR that decides what code comes out
+    stringstream key;
+    key << LLVM_VERSION_STRING << " " << JTMB.getTargetTriple().str() << " " << JTMB.getCPU() << " "
+        << JTMB.getFeatures().getString() << " " << (int)*JTMB.getCodeModel() << " " << (int)*JTMB.getRelocationModel() << " "
+        << (int)JTMB.getCodeGenOptLevel();
+    global_object_cache->_TargetKey = key.str();
+  }
   auto TPC = ExitOnErr(orc::SelfExecutorProcessControl::Create(std::make_shared<orc::SymbolStringPool>()));
   auto J = ExitOnErr(
       LLJITBuilder()
       .setExecutionSession(std::make_unique<ExecutionSession>(std::move(TPC)))
       .setNumCompileThreads(0)  // <<<<<<< In May 2021 a path will open to use multicores for LLJIT.
       .setJITTargetMachineBuilder(std::move(JTMB))
+      .setCompileFunctionCreator([](JITTargetMachineBuilder JTMB) -> Expected<std::unique_ptr<IRCompileLayer::IRCompiler>> {
+        auto TM = JTMB.createTargetMachine();
+        if (!TM) return TM.takeError();
+        return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM), global_object_cache);
+      })
       .setObjectLinkingLayerCreator([this,&ExitOnErr](ExecutionSession &ES, const Triple &TT) {
         auto ObjLinkingLayer = std::make_unique<ObjectLinkingLayer>(ES, std::make_unique<ClaspAllocator>());
         ObjLinkingLayer->addPlugin(std::make_unique<EHFrameRegistrationPlugin>(ES,std::make_unique<jitlink::InProcessEHFrameRegistrar>()));
@@ -26,12 +26,20 @@ THE SOFTWARE.
 /* -^- */
 
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
 #include <sys/select.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
 #include <clasp/core/fli.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/serveEvent/serveEventPackage.h>
+#include <clasp/core/array.h>
 #include <clasp/core/wrappers.h>
 
 namespace serveEvent {
@@ -45,6 +53,9 @@ CL_DEFUN void serve_event_internal__ll_fd_zero(clasp_ffi::ForeignData_sp fdset)
 
 DOCGROUP(clasp);
 CL_DEFUN void serve_event_internal__ll_fd_set(int fd, clasp_ffi::ForeignData_sp fdset) {
+  if (fd < 0 || fd >= FD_SETSIZE) {
+    SIMPLE_ERROR("File descriptor {} cannot be used with select(), which is limited to {} descriptors", fd, FD_SETSIZE);
+  }
  FD_SET(fd, fdset->data<fd_set *>());
 }
 
@@ -76,9 +87,130 @@ CL_DEFUN core::Integer_mv serve_event_internal__ll_serveEventWithTimeout(clasp_f
   return Values(Integer_O::create(selectRet), Integer_O::create((gc::Fixnum)errno));
 }
 
+//
+// epoll(7), with timerfd and eventfd so that timers and cross-thread
+// wakeups are descriptors in the same set. Each function returns the
+// system call's result and errno, like the select() wrappers above.
+//
+
+DOCGROUP(clasp);
+CL_DEFUN bool serve_event_internal__ll_epoll_supported_p() {
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef __linux__
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_epoll_create() {
+  gc::Fixnum ret = epoll_create1(EPOLL_CLOEXEC);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
+CL_LAMBDA(epfd op fd input output edge-triggered);
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_epoll_ctl(int epfd, int op, int fd, bool input, bool output, bool edge_triggered) {
+  struct epoll_event event;
+  event.events = (input ? EPOLLIN | EPOLLRDHUP : 0) | (output ? EPOLLOUT : 0) | (edge_triggered ? EPOLLET : 0);
+  event.data.fd = fd;
+  gc::Fixnum ret = epoll_ctl(epfd, op, fd, &event);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
+CL_LAMBDA(epfd max-events seconds);
+CL_DOCSTRING(R"dx(Wait up to SECONDS (forever if negative) for events on EPFD. Return the number of events, errno, and a simple-vector holding the descriptor and event flags of each event in turn.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv serve_event_internal__ll_epoll_wait(int epfd, size_t max_events, double seconds) {
+  int timeout_ms = -1;
+  if (seconds >= 0.0) {
+    // Clamp before the cast: a huge (or NaN) timeout would overflow an int.
+    double ms = ceil(seconds * 1000.0);
+    timeout_ms = (ms < (double)INT_MAX) ? (int)ms : INT_MAX;
+  }
+  std::vector<struct epoll_event> events(max_events > 0 ? max_events : 1);
+  int count = epoll_wait(epfd, events.data(), events.size(), timeout_ms);
+  gc::Fixnum err = errno;
+  SimpleVector_sp result = SimpleVector_O::make(count > 0 ? 2 * count : 0);
+  for (int i = 0; i < count; ++i) {
+    (*result)[2 * i] = make_fixnum(events[i].data.fd);
+    (*result)[2 * i + 1] = make_fixnum(events[i].events);
+  }
+  return Values(Integer_O::create((gc::Fixnum)count), Integer_O::create(err), result);
+}
+
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_timerfd_create() {
+  gc::Fixnum ret = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
+CL_LAMBDA(fd seconds interval);
+CL_DOCSTRING(R"dx(Arm the timerfd FD to expire after SECONDS, and then every INTERVAL seconds unless INTERVAL is zero.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_timerfd_settime(int fd, double seconds, double interval) {
+  if (seconds < 0.0 || interval < 0.0) {
+    SIMPLE_ERROR("Illegal timer {} seconds, interval {} seconds", seconds, interval);
+  }
+  // An all-zero it_value disarms the timer, so round up to a nanosecond.
+  if (seconds < 1e-9)
+    seconds = 1e-9;
+  struct itimerspec spec;
+  spec.it_value.tv_sec = (time_t)seconds;
+  spec.it_value.tv_nsec = (long)((seconds - floor(seconds)) * 1e9);
+  spec.it_interval.tv_sec = (time_t)interval;
+  spec.it_interval.tv_nsec = (long)((interval - floor(interval)) * 1e9);
+  gc::Fixnum ret = timerfd_settime(fd, 0, &spec, NULL);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_eventfd_create() {
+  gc::Fixnum ret = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_eventfd_signal(int fd) {
+  uint64_t one = 1;
+  gc::Fixnum ret = write(fd, &one, sizeof(one));
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+#endif
+
+CL_DOCSTRING(R"dx(Read the 8-byte counter of an eventfd or timerfd, resetting it. Return the counter, or -1 if nothing was pending.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_sp serve_event_internal__ll_fd_read_counter(int fd) {
+  uint64_t counter;
+  if (read(fd, &counter, sizeof(counter)) != sizeof(counter))
+    return Integer_O::create((gc::Fixnum)-1);
+  return Integer_O::create(counter);
+}
+
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_close_fd(int fd) {
+  gc::Fixnum ret = close(fd);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+}
+
 void initialize_serveEvent_globals() {
   SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EINTR_PLUS_);
   _sym__PLUS_EINTR_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EINTR));
+#ifdef __linux__
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLL_CTL_ADD_PLUS_);
+  _sym__PLUS_EPOLL_CTL_ADD_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EPOLL_CTL_ADD));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLL_CTL_MOD_PLUS_);
+  _sym__PLUS_EPOLL_CTL_MOD_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EPOLL_CTL_MOD));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLL_CTL_DEL_PLUS_);
+  _sym__PLUS_EPOLL_CTL_DEL_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EPOLL_CTL_DEL));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLLIN_PLUS_);
+  _sym__PLUS_EPOLLIN_PLUS_->defconstant(Integer_O::create((gc::Fixnum)(EPOLLIN | EPOLLRDHUP)));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLLOUT_PLUS_);
+  _sym__PLUS_EPOLLOUT_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EPOLLOUT));
+  SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EPOLLERR_PLUS_);
+  _sym__PLUS_EPOLLERR_PLUS_->defconstant(Integer_O::create((gc::Fixnum)(EPOLLERR | EPOLLHUP)));
+#endif
 };
 
 
@@ -88,5 +220,17 @@ void initialize_serveEvent_globals() {
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_fdset_size);
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventNoTimeout);
   SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventWithTimeout);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_supported_p);
+#ifdef __linux__
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_create);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_ctl);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_wait);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_timerfd_create);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_timerfd_settime);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_eventfd_create);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_eventfd_signal);
+#endif
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_fd_read_counter);
+  SYMBOL_EXPORT_SC_(ServeEventPkg, ll_close_fd);
 
 };
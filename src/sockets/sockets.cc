@@ -36,6 +36,12 @@ THE SOFTWARE.
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <limits.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #ifndef MSG_CONFIRM
 #define MSG_CONFIRM 0
 #endif
@@ -90,6 +96,17 @@ safe_buffer_pointer(core::T_sp x, uint size) {
   return address;
 }
 
+// The four octets of an IPv4 address, as MAKE-INET-ADDRESS returns them.
+static core::SimpleVector_sp inet_address_vector(const struct sockaddr_in *name) {
+  uint32_t ip = ntohl(name->sin_addr.s_addr);
+  core::SimpleVector_sp vector = core::SimpleVector_O::make(4);
+  (*vector)[0] = core::make_fixnum(ip >> 24);
+  (*vector)[1] = core::make_fixnum((ip >> 16) & 0xFF);
+  (*vector)[2] = core::make_fixnum((ip >> 8) & 0xFF);
+  (*vector)[3] = core::make_fixnum(ip & 0xFF);
+  return vector;
+}
+
 static void fill_inet_sockaddr(struct sockaddr_in *sockaddr, int port,
                                int a1, int a2, int a3, int a4) {
   bzero(sockaddr, sizeof(struct sockaddr_in));
@@ -274,14 +291,7 @@ CL_DEFUN core::T_mv sockets_internal__ll_socketReceive(int fd,       // #0
   unlikely_if (len == -1)
     return Values(core::make_fixnum(-1),core::make_fixnum(errno));
   else {
-    uint32_t ip = ntohl(name.sin_addr.s_addr);
-    uint16_t port = ntohs(name.sin_port);
-    core::Vector_sp vector = gc::As<core::Vector_sp>(core::eval::funcall(cl::_sym_makeArray, core::make_fixnum(4)));
-    vector->rowMajorAset(0,core::make_fixnum(ip >> 24));
-    vector->rowMajorAset(1,core::make_fixnum((ip >> 16) & 0xFF));
-    vector->rowMajorAset(2,core::make_fixnum((ip >> 8) & 0xFF));
-    vector->rowMajorAset(3,core::make_fixnum(ip & 0xFF));
-    return Values(core::make_fixnum(len), core::make_fixnum(errno), vector, core::make_fixnum(port));
+    return Values(core::make_fixnum(len), core::make_fixnum(errno), inet_address_vector(&name), core::make_fixnum(ntohs(name.sin_port)));
   }
 }
 
@@ -875,6 +885,207 @@ CL_DEFUN int sockets_internal__do_select(core::T_sp to_secs,
                 (to_secs.fixnump()) ? &tv : NULL);
 }
 
+//
+// Batched and zero-copy I/O for the buffered socket streams.
+//
+
+// The address of octet START of BUFFER, after checking that
+// START <= END <= the length of BUFFER.
+static char *buffer_region_pointer(core::T_sp buffer, size_t start, size_t end) {
+  size_t length = gc::As<core::Vector_sp>(buffer)->length();
+  if (start > end || end > length)
+    SIMPLE_ERROR("The region {} to {} is not within the socket buffer {} of length {}", start, end, _rep_(buffer), length);
+  return REINTERPRET_CAST(char *, safe_buffer_pointer(buffer, end)) + start;
+}
+
+CL_LAMBDA(fd buffer start end);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Read into BUFFER between START and END. Return the byte count, or -1, and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketRead(int fd, core::T_sp buffer, size_t start, size_t end) {
+  char *address = buffer_region_pointer(buffer, start, end);
+  clasp_disable_interrupts();
+  ssize_t len = read(fd, address, end - start);
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len), core::make_fixnum(errno));
+}
+
+CL_LAMBDA(fd buffers starts ends);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Write the given regions of BUFFERS with a single writev(2). Return the byte count, or -1, and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketWritev(int fd, core::List_sp buffers, core::List_sp starts, core::List_sp ends) {
+  struct iovec iov[IOV_MAX];
+  int count = 0;
+  for (; buffers.consp() && count < IOV_MAX; buffers = CONS_CDR(buffers), starts = CONS_CDR(starts), ends = CONS_CDR(ends)) {
+    size_t start = core::clasp_to_size_t(CONS_CAR(starts));
+    size_t end = core::clasp_to_size_t(CONS_CAR(ends));
+    char *address = buffer_region_pointer(CONS_CAR(buffers), start, end);
+    if (end == start)
+      continue;
+    iov[count].iov_base = address;
+    iov[count].iov_len = end - start;
+    ++count;
+  }
+  clasp_disable_interrupts();
+  ssize_t len = writev(fd, iov, count);
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len), core::make_fixnum(errno));
+}
+
+CL_LAMBDA(out-fd in-fd offset count);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Send COUNT bytes of the file IN-FD from OFFSET to the socket OUT-FD without copying them through Lisp. Return the byte count, or -1, and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketSendfile(int out_fd, int in_fd, size_t offset, size_t count) {
+  ssize_t len;
+  clasp_disable_interrupts();
+#if defined(__linux__)
+  off_t off = offset;
+  len = sendfile(out_fd, in_fd, &off, count);
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+  off_t sent = count;
+#if defined(__APPLE__)
+  int ret = sendfile(in_fd, out_fd, offset, &sent, NULL, 0);
+#else
+  int ret = sendfile(in_fd, out_fd, offset, count, NULL, &sent, 0);
+#endif
+  // A partial send on a non-blocking socket fails with EAGAIN but still
+  // reports what it sent.
+  len = (ret == 0 || sent > 0) ? (ssize_t)sent : -1;
+#else
+  char buffer[65536];
+  len = pread(in_fd, buffer, std::min(count, sizeof(buffer)), offset);
+  if (len > 0)
+    len = write(out_fd, buffer, len);
+#endif
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(len), core::make_fixnum(errno));
+}
+
+CL_LAMBDA(fd output timeout);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Wait up to TIMEOUT seconds (forever if negative) until FD is readable, or writable if OUTPUT is true. Return poll(2)'s result and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketWait(int fd, bool output, double timeout) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = output ? POLLOUT : POLLIN;
+  pfd.revents = 0;
+  // Clamp before converting, since a huge timeout would overflow the int.
+  int timeout_ms = -1;
+  if (timeout >= 0.0) {
+    double ms = ceil(timeout * 1000.0);
+    timeout_ms = (ms < (double)INT_MAX) ? (int)ms : INT_MAX;
+  }
+  int ret = poll(&pfd, 1, timeout_ms);
+  return Values(core::make_fixnum(ret), core::make_fixnum(errno));
+}
+
+// Datagrams per recvmmsg/sendmmsg call.
+#define SOCKET_BATCH_MAX 256
+
+CL_LAMBDA(fd buffers dontwait);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Receive up to one datagram into each of BUFFERS. Return the number received, or -1, errno, and simple-vectors of the lengths, hosts and ports of the datagrams.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketReceiveBatch(int fd, core::SimpleVector_sp buffers, bool dontwait) {
+  size_t n = std::min(buffers->length(), (size_t)SOCKET_BATCH_MAX);
+  struct sockaddr_in names[SOCKET_BATCH_MAX];
+  struct iovec iov[SOCKET_BATCH_MAX];
+  for (size_t i = 0; i < n; ++i) {
+    core::Vector_sp buffer = gc::As<core::Vector_sp>((*buffers)[i]);
+    iov[i].iov_len = buffer->length();
+    iov[i].iov_base = safe_buffer_pointer(buffer, iov[i].iov_len);
+  }
+  int count;
+  clasp_disable_interrupts();
+#if defined(__linux__)
+  struct mmsghdr msgs[SOCKET_BATCH_MAX];
+  memset(msgs, 0, sizeof(struct mmsghdr) * n);
+  for (size_t i = 0; i < n; ++i) {
+    msgs[i].msg_hdr.msg_name = &names[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  count = recvmmsg(fd, msgs, n, dontwait ? MSG_DONTWAIT : MSG_WAITFORONE, NULL);
+#else
+  ssize_t lengths_[SOCKET_BATCH_MAX];
+  for (count = 0; count < (int)n; ++count) {
+    socklen_t addr_len = sizeof(struct sockaddr_in);
+    // Only the first receive may block.
+    int flags = (dontwait || count > 0) ? MSG_DONTWAIT : 0;
+    lengths_[count] = recvfrom(fd, iov[count].iov_base, iov[count].iov_len, flags, (struct sockaddr *)&names[count], &addr_len);
+    if (lengths_[count] < 0)
+      break;
+  }
+  if (count == 0)
+    count = -1;
+#endif
+  gc::Fixnum err = errno;
+  clasp_enable_interrupts();
+  if (count < 0)
+    return Values(core::make_fixnum(-1), core::make_fixnum(err), nil<core::T_O>(), nil<core::T_O>(), nil<core::T_O>());
+  core::SimpleVector_sp lengths = core::SimpleVector_O::make(count);
+  core::SimpleVector_sp hosts = core::SimpleVector_O::make(count);
+  core::SimpleVector_sp ports = core::SimpleVector_O::make(count);
+  for (int i = 0; i < count; ++i) {
+#if defined(__linux__)
+    (*lengths)[i] = core::make_fixnum(msgs[i].msg_len);
+#else
+    (*lengths)[i] = core::make_fixnum(lengths_[i]);
+#endif
+    (*hosts)[i] = inet_address_vector(&names[i]);
+    (*ports)[i] = core::make_fixnum(ntohs(names[i].sin_port));
+  }
+  return Values(core::make_fixnum(count), core::make_fixnum(err), lengths, hosts, ports);
+}
+
+CL_LAMBDA(fd buffers lengths port ip0 ip1 ip2 ip3 dontwait nosignal);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Send each of BUFFERS as a datagram, the first LENGTHS[i] bytes of each, to the given address, or to the connected peer if PORT is negative. Return the number sent, or -1, and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv sockets_internal__ll_socketSendBatch(int fd, core::SimpleVector_sp buffers, core::SimpleVector_sp lengths,
+                                                          int port, int ip0, int ip1, int ip2, int ip3, bool dontwait, bool nosignal) {
+  size_t n = std::min(buffers->length(), (size_t)SOCKET_BATCH_MAX);
+  struct sockaddr_in sockaddr;
+  struct sockaddr_in *address = NULL;
+  if (port >= 0) {
+    fill_inet_sockaddr(&sockaddr, port, ip0, ip1, ip2, ip3);
+    address = &sockaddr;
+  }
+  struct iovec iov[SOCKET_BATCH_MAX];
+  for (size_t i = 0; i < n; ++i) {
+    iov[i].iov_len = core::clasp_to_size_t((*lengths)[i]);
+    iov[i].iov_base = safe_buffer_pointer((*buffers)[i], iov[i].iov_len);
+  }
+  int flags = (dontwait ? MSG_DONTWAIT : 0) | (nosignal ? MSG_NOSIGNAL : 0);
+  int count;
+  clasp_disable_interrupts();
+#if defined(__linux__)
+  struct mmsghdr msgs[SOCKET_BATCH_MAX];
+  memset(msgs, 0, sizeof(struct mmsghdr) * n);
+  for (size_t i = 0; i < n; ++i) {
+    msgs[i].msg_hdr.msg_name = address;
+    msgs[i].msg_hdr.msg_namelen = address ? sizeof(struct sockaddr_in) : 0;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  count = sendmmsg(fd, msgs, n, flags);
+#else
+  for (count = 0; count < (int)n; ++count) {
+    if (sendto(fd, iov[count].iov_base, iov[count].iov_len, flags, (struct sockaddr *)address,
+               address ? sizeof(struct sockaddr_in) : 0) < 0)
+      break;
+  }
+  if (count == 0 && n > 0)
+    count = -1;
+#endif
+  gc::Fixnum err = errno;
+  clasp_enable_interrupts();
+  return Values(core::make_fixnum(count), core::make_fixnum(err));
+}
 
 void initialize_sockets_globals() {
   SYMBOL_EXPORT_SC_(SocketsPkg, _PLUS_af_inet_PLUS_);
@@ -1004,4 +1215,10 @@ void initialize_sockets_globals() {
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_setSockoptBool);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_setSockoptTimeval);
   SYMBOL_EXPORT_SC_(SocketsPkg, ll_setSockoptLinger);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketRead);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketWritev);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendfile);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketWait);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketReceiveBatch);
+  SYMBOL_EXPORT_SC_(SocketsPkg, ll_socketSendBatch);
 };
@@ -0,0 +1,51 @@
+;;;; bignum-multiply-benchmark.lisp -- time huge bignum products by thread count.
+;;;
+;;; In a running clasp:
+;;;   (load "tools/bignum-multiply-benchmark.lisp")
+;;;   (bignum-multiply-benchmark:run)
+;;;
+;;; Each case multiplies two bignums of the given sizes on one thread and
+;;; with the default thread count, and prints the milliseconds per product
+;;; of each and the speedup.
+
+(defpackage #:bignum-multiply-benchmark
+  (:use #:cl)
+  (:export #:run))
+
+(in-package #:bignum-multiply-benchmark)
+
+(defmacro timing (n form)
+  "Evaluate FORM N times and return the milliseconds per evaluation."
+  (let ((start (gensym)) (i (gensym)))
+    `(let ((,start (get-internal-real-time)))
+       (dotimes (,i ,n) ,form)
+       (/ (* (- (get-internal-real-time) ,start)
+             (/ 1000 internal-time-units-per-second))
+          (float ,n 1d0)))))
+
+(defun random-bignum (bits)
+  (logior (ash 1 (1- bits)) (random (ash 1 (1- bits)))))
+
+(defun time-product (a b threads n)
+  (let ((old (core:set-bignum-multiply-threads threads)))
+    (unwind-protect (timing n (* a b))
+      (core:set-bignum-multiply-threads old))))
+
+(defun report (name serial parallel)
+  (format t "~&~30a ~10,2f ms ~10,2f ms ~8,2fx~%" name serial parallel
+          (if (zerop parallel) 0 (/ serial parallel))))
+
+(defun run (&key (n 5) (threads 0))
+  "THREADS is the parallel thread count, 0 for the default."
+  (format t "~&~30a ~13a ~13a ~9a~%" "bits" "1 thread" "parallel" "speedup")
+  (dolist (sizes '((600000 600000) (2000000 2000000) (8000000 8000000)
+                   (8000000 1000000) (32000000 1000000)))
+    (destructuring-bind (lbits rbits) sizes
+      (let ((a (random-bignum lbits)) (b (random-bignum rbits)))
+        (report (format nil "~d x ~d" lbits rbits)
+                (time-product a b 1 n)
+                (time-product a b threads n)))))
+  (let ((a (random-bignum 8000000)))
+    (report "8000000 squared (serial)"
+            (time-product a a 1 n)
+            (time-product a a threads n))))
@@ -0,0 +1,74 @@
+;;;; clbind-call-benchmark.lisp -- time clbind calls against Lisp calls.
+;;;
+;;; In a running clasp:
+;;;   (load "tools/clbind-call-benchmark.lisp")
+;;;   (clbind-call-benchmark:run)
+;;;
+;;; Each case calls a small function N times, through clbind and as an
+;;; ordinary compiled Lisp function doing the same work, and prints the
+;;; nanoseconds per call of each and their ratio.
+
+(defpackage #:clbind-call-benchmark
+  (:use #:cl)
+  (:export #:run))
+
+(in-package #:clbind-call-benchmark)
+
+(clbind:expose-call-benchmark)
+
+(defstruct lisp-vector (x 0d0 :type double-float) (y 0d0 :type double-float) (z 0d0 :type double-float))
+
+(defstruct (lisp-particle (:include lisp-vector)) (mass 0d0 :type double-float))
+
+(defun lisp-add-doubles (a b) (+ a b))
+(defun lisp-add-fixnums (a b) (+ a b))
+
+(defun lisp-dot (a b)
+  (+ (* (lisp-vector-x a) (lisp-vector-x b))
+     (* (lisp-vector-y a) (lisp-vector-y b))
+     (* (lisp-vector-z a) (lisp-vector-z b))))
+
+(defun lisp-scale (v factor)
+  (setf (lisp-vector-x v) (* (lisp-vector-x v) factor)
+        (lisp-vector-y v) (* (lisp-vector-y v) factor)
+        (lisp-vector-z v) (* (lisp-vector-z v) factor))
+  nil)
+
+(defmacro timing (n form)
+  "Evaluate FORM N times and return the nanoseconds per evaluation."
+  (let ((start (gensym)) (i (gensym)))
+    `(let ((,start (get-internal-real-time)))
+       (dotimes (,i ,n) ,form)
+       (/ (* (- (get-internal-real-time) ,start)
+             (/ 1000000000 internal-time-units-per-second))
+          (float ,n 1d0)))))
+
+(defun report (name clbind lisp)
+  (format t "~&~30a ~10,1f ns ~10,1f ns ~8,2fx~%" name clbind lisp
+          (if (zerop lisp) 0 (/ clbind lisp))))
+
+(defun run (&key (n 10000000))
+  (let ((cv (clbind-benchmark::make-benchmark-vector 1d0 2d0 3d0))
+        (cp (clbind-benchmark::make-benchmark-particle 1d0 2d0 3d0 4d0))
+        (lv (make-lisp-vector :x 1d0 :y 2d0 :z 3d0))
+        (lp (make-lisp-particle :x 1d0 :y 2d0 :z 3d0 :mass 4d0)))
+    (format t "~&~30a ~13a ~13a ~9a~%" "case" "clbind" "lisp" "ratio")
+    (report "function (double double)"
+            (timing n (clbind-benchmark::add-doubles 1d0 2d0))
+            (timing n (lisp-add-doubles 1d0 2d0)))
+    (report "function (fixnum fixnum)"
+            (timing n (clbind-benchmark::add-fixnums 1 2))
+            (timing n (lisp-add-fixnums 1 2)))
+    (report "method dot"
+            (timing n (clbind-benchmark::dot cv cv))
+            (timing n (lisp-dot lv lv)))
+    (report "method scale"
+            (timing n (clbind-benchmark::scale cv 1d0))
+            (timing n (lisp-scale lv 1d0)))
+    (report "base class method on subclass"
+            (timing n (clbind-benchmark::dot cp cv))
+            (timing n (lisp-dot lp lv)))
+    (report "subclass method"
+            (timing n (clbind-benchmark::momentum cp))
+            (timing n (* (lisp-particle-mass lp) (lisp-vector-x lp)))))
+  (values))